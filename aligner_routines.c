@@ -0,0 +1,160 @@
+/************************ REENTRANT ALIGNER ROUTINES ************************
+ * An alignment API whose state all lives in handles the caller owns:
+ *   SW_Aligner   the scoring parameters and the scratch space of the
+ *                kernels (the profile of the last query and its DP
+ *                columns, an arena for the rest), reused from one
+ *                alignment to the next,
+ *   Primer_Pool  a pool of primers and their reverse complements,
+ *                replacing pool[] and interaction_matrix,
+ * and, for the duplex DP, a Thermo_Context (see swnn.h) per reaction
+ * condition.
+ * Nothing here reads or writes a global, so any number of threads can
+ * align at once as long as each uses its own SW_Aligner. A Primer_Pool
+ * can be shared once it's no longer being added to.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+
+/* create_aligner: an aligner scoring with score_param */
+SW_Aligner *create_aligner(Score_Param score_param)
+{
+    SW_Aligner *aligner = allocate(sizeof(SW_Aligner));
+    aligner->score_param = score_param;
+    aligner->query = NULL;
+    aligner->profile = NULL;
+    aligner->arena = create_arena(0);
+    return aligner;
+}
+
+void free_aligner(SW_Aligner *aligner)
+{
+#ifdef __SSE2__
+    if (aligner->profile != NULL)
+    {
+        free_query_profile(aligner->profile);
+    }
+#endif
+    free(aligner->query);
+    free_arena(aligner->arena);
+    free(aligner);
+}
+
+/* aligner_score:
+ * swalign(ref, query, aligner->score_param), with the kernel
+ * swinc_kernels() binds. Where that's the striped kernel the
+ * profile of query is kept, aligning the same query to many
+ * refs in a row builds it once, and a new query is built into
+ * the storage of the last. */
+float aligner_score(SW_Aligner *aligner, char *ref, char *query)
+{
+    const Swinc_Kernels *kernels = swinc_kernels();
+#ifdef __SSE2__
+    if (kernels->swalign != swalign_striped)
+    {
+        return kernels->swalign(ref, query, aligner->score_param);
+    }
+    if (aligner->query == NULL || strcmp(aligner->query, query) != 0)
+    {// rebuilt in the storage of the last profile
+        aligner->profile = build_query_profile(aligner->profile, query,
+                                               aligner->score_param);
+        free(aligner->query);
+        aligner->query = allocate(strlen(query) +1);
+        strcpy(aligner->query, query);
+    }
+    return swalign_profile(ref, aligner->profile);
+#else
+    return kernels->swalign(ref, query, aligner->score_param);
+#endif
+}
+
+/* aligner_align:
+ * align_packed(ref, query, aligner->score_param) with the traceback
+ * in the arena of aligner. The path lives until the next call. */
+SW_Alignment aligner_align(SW_Aligner *aligner, char *ref, char *query)
+{
+    arena_reset(aligner->arena);
+    return align_packed_arena(ref, query, aligner->score_param,
+                              aligner->arena);
+}
+
+
+/* create_primer_pool: an empty pool */
+Primer_Pool *create_primer_pool(void)
+{
+    Primer_Pool *primer_pool = allocate(sizeof(Primer_Pool));
+    primer_pool->num_primer = 0;
+    primer_pool->capacity = 64;
+    primer_pool->primers = allocate(sizeof(char *) * primer_pool->capacity);
+    primer_pool->rc_primers = allocate(sizeof(char *) * primer_pool->capacity);
+    return primer_pool;
+}
+
+/* add_primer:
+ * append a copy of primer to the pool, together with its
+ * reverse complement (the query of its duplexes).
+ * Return the index of the primer in the pool. */
+int add_primer(Primer_Pool *primer_pool, char *primer)
+{
+    if (primer_pool->num_primer == primer_pool->capacity)
+    {
+        primer_pool->capacity *= 2;
+        primer_pool->primers = realloc(primer_pool->primers,
+                                       sizeof(char *) * primer_pool->capacity);
+        primer_pool->rc_primers = realloc(primer_pool->rc_primers,
+                                          sizeof(char *) * primer_pool->capacity);
+        if (primer_pool->primers == NULL || primer_pool->rc_primers == NULL)
+        {
+            error_handle(ERROR_MEM_ALLOC);
+            exit(ERROR_MEM_ALLOC);
+        }
+    }
+    int index = primer_pool->num_primer++;
+    primer_pool->primers[index] = allocate(strlen(primer) +1);
+    strcpy(primer_pool->primers[index], primer);
+    primer_pool->rc_primers[index] = rev_complement(primer, KMER_SIZE);
+    return index;
+}
+
+void free_primer_pool(Primer_Pool *primer_pool)
+{
+    int i;
+    for (i = 0; i < primer_pool->num_primer; i++)
+    {
+        free(primer_pool->primers[i]);
+        free(primer_pool->rc_primers[i]);
+    }
+    free(primer_pool->primers);
+    free(primer_pool->rc_primers);
+    free(primer_pool);
+}
+
+/* align_primer_pool:
+ * align_pool() on primer_pool with the parameters of aligner,
+ * writing interaction_matrix[i][j] into matrix[i * num_primer + j].
+ * matrix holds num_primer^2 floats and belongs to the caller.
+ * All the scratch space is in the arena of aligner: once it has
+ * seen a row of the pool, nothing goes to the heap. */
+void align_primer_pool(SW_Aligner *aligner, Primer_Pool *primer_pool,
+                       float *matrix)
+{
+    int num_primer = primer_pool->num_primer;
+    char **refs;
+    int i, j;
+    for (i = 0; i < num_primer; i++)
+    {
+        arena_reset(aligner->arena);
+        refs = arena_alloc(aligner->arena, sizeof(char *) * (num_primer +1));
+        for (j = 0; j < num_primer; j++)
+        {
+            refs[j] = primer_pool->primers[i];
+        }
+        swalign_batch_arena(refs, primer_pool->rc_primers, num_primer,
+                            aligner->score_param,
+                            matrix + (size_t) i * num_primer, aligner->arena);
+        matrix[(size_t) i * num_primer + i] = 0.0;
+    }
+}
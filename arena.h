@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* A scratch allocator for the memory of one alignment at a time
+ * (DP matrices, reverse complements, encoded sequences, traceback
+ * buffers), shared by swinc and swnn.
+ * Allocations are carved from a single block and never freed one
+ * by one: arena_reset() gives them all back at once. When the block
+ * runs out, allocations overflow into blocks of their own, and the
+ * next reset replaces everything with one block at least as big as
+ * the high water mark. Once an arena has seen its largest alignment it
+ * doesn't go to the heap anymore; num_heap_alloc counts the times
+ * it did. An arena belongs to one thread. */
+#define ARENA_ALIGNMENT 16
+#define ARENA_DEFAULT_SIZE 65536
+
+typedef struct Arena_Overflow {
+    struct Arena_Overflow *next;
+} Arena_Overflow;
+
+typedef struct {
+    char *memory;
+    size_t size;
+    size_t used;
+    size_t high_water;
+    Arena_Overflow *overflow;
+    long num_heap_alloc;
+} Arena;
+
+Arena *create_arena(size_t size);
+void free_arena(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+char *arena_strdup(Arena *arena, const char *string);
+
+#endif /* ARENA_H */
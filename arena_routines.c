@@ -0,0 +1,116 @@
+/************************** ARENA ROUTINES *********************************
+ * A bump allocator reset between alignments (see arena.h).
+ * arena_alloc() is a rounding and an addition as long as the block
+ * holds; an overflow block starts with its Arena_Overflow link and
+ * the memory handed out follows it, ARENA_ALIGNMENT bytes in.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "instrument.h"
+
+#define ALIGN_UP(size) \
+    (((size) + ARENA_ALIGNMENT -1) & ~((size_t) ARENA_ALIGNMENT -1))
+
+static void *allocate(Arena *arena, size_t size);
+
+
+/* create_arena: an arena starting with a block of size bytes
+ * (ARENA_DEFAULT_SIZE if 0) */
+Arena *create_arena(size_t size)
+{
+    Arena *arena = malloc(sizeof(Arena));
+    if (arena == NULL)
+    {
+        fprintf(stderr, "arena: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    arena->num_heap_alloc = 0;
+    arena->size = ALIGN_UP((size > 0) ? size : ARENA_DEFAULT_SIZE);
+    arena->memory = allocate(arena, arena->size);
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->overflow = NULL;
+    return arena;
+}
+
+void free_arena(Arena *arena)
+{
+    arena_reset(arena);
+    free(arena->memory);
+    free(arena);
+}
+
+
+/* arena_alloc:
+ * size bytes aligned to ARENA_ALIGNMENT, valid until the
+ * next arena_reset() */
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = ALIGN_UP(size);
+    void *memory;
+    if (arena->used + size <= arena->size)
+    {
+        memory = arena->memory + arena->used;
+    }else
+    {// overflow, the block grows at the next reset
+        Arena_Overflow *overflow = allocate(arena, ARENA_ALIGNMENT + size);
+        overflow->next = arena->overflow;
+        arena->overflow = overflow;
+        memory = (char *) overflow + ARENA_ALIGNMENT;
+    }
+    arena->used += size;
+    if (arena->used > arena->high_water)
+    {
+        arena->high_water = arena->used;
+    }
+    return memory;
+}
+
+/* arena_reset:
+ * give back everything allocated since the last reset. If
+ * anything overflowed, the block is replaced by one that
+ * holds the high water mark, at least twice the size of the
+ * old one so that a slowly rising mark isn't chased. */
+void arena_reset(Arena *arena)
+{
+    Arena_Overflow *overflow;
+    if (arena->overflow != NULL)
+    {
+        while ((overflow = arena->overflow) != NULL)
+        {
+            arena->overflow = overflow->next;
+            free(overflow);
+        }
+        free(arena->memory);
+        arena->size = (arena->high_water > 2 * arena->size) ?
+                      arena->high_water : 2 * arena->size;
+        arena->memory = allocate(arena, arena->size);
+    }
+    arena->used = 0;
+}
+
+/* arena_strdup: a copy of string in the arena */
+char *arena_strdup(Arena *arena, const char *string)
+{
+    size_t len = strlen(string);
+    char *copy = arena_alloc(arena, len +1);
+    memcpy(copy, string, len +1);
+    return copy;
+}
+
+
+static void *allocate(Arena *arena, size_t size)
+{
+    void *memory = malloc(size);
+    if (memory == NULL)
+    {
+        fprintf(stderr, "arena: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    arena->num_heap_alloc++;
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 1);
+    return memory;
+}
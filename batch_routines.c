@@ -0,0 +1,880 @@
+/************************ BATCHED SW ROUTINES *******************************
+ * Score-only swinc alignment of many independent (ref, query) pairs
+ * at once, one pair per vector lane (inter-sequence vectorisation).
+ *
+ * Primers are at most MAX_SEQ_LEN long and the queries of a pool
+ * alignment at most KMER_SIZE, too short for the striped kernel to
+ * fill its lanes. Instead, BATCH_LANES pairs walk the same DP matrix
+ * in lockstep, every lane doing exactly the additions and comparisons
+ * of fill_matrix() for its own pair, so the scores are identical.
+ *
+ * Pairs are bucketed by length before being put into lanes so that
+ * the lanes of a batch have (nearly) the same matrix dimension and
+ * little work is spent on padding. Cells outside a lane's own matrix
+ * are computed but never considered for the best score; since a cell
+ * only depends on its top and left neighbours, they never leak into
+ * the real cells either.
+ *
+ * swalign_batch_arena() runs the kernel bound to the instruction set
+ * level (see swinc_kernels()): BATCH_LANES pairs in SSE registers,
+ * BATCH_LANES_AVX2 or BATCH_LANES_AVX512 in the wider ones, or one
+ * pair at a time. The wider kernels are built with target attributes.
+ * All the kernels take their rows from an arena rather than the stack,
+ * allocated once for the largest matrix of the pairs.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "swinc.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef SIMD_WIDE_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef struct {
+    int index;
+    int ref_len;
+    int query_len;
+} Batch_Pair;
+
+#ifdef __SSE2__
+/* the rows of align_lanes() and align_lanes_symmetric(), BATCH_LANES
+ * values per cell (the masks and reverse records of the latter only) */
+typedef struct {
+    float (*ref_bases)[BATCH_LANES];
+    float (*query_bases)[BATCH_LANES];
+    float (*col_valid)[BATCH_LANES];
+    float (*row_valid)[BATCH_LANES];
+    int (*col_last)[BATCH_LANES];
+    int (*col_inside)[BATCH_LANES];
+    int (*row_last)[BATCH_LANES];
+    int (*row_inside)[BATCH_LANES];
+    float (*m_row)[BATCH_LANES];
+    float (*i_row)[BATCH_LANES];
+    float (*h_row)[BATCH_LANES];
+    float (*rm_row)[BATCH_LANES];
+    float (*ri_row)[BATCH_LANES];
+    float (*rie_row)[BATCH_LANES];
+    float (*rh_row)[BATCH_LANES];
+} Sse_Rows;
+
+static int compare_pair_len(const void *pair1, const void *pair2);
+static void bucket_pairs(char **refs, char **queries, int num_pair,
+                         Batch_Pair *pairs);
+static void allocate_sse_rows(Arena *arena, Batch_Pair *pairs, int num_pair,
+                              int symmetric, Sse_Rows *rows);
+static void align_lanes(char **refs, char **queries,
+                        Batch_Pair *pairs, int num_lane,
+                        Score_Param score_param, Sse_Rows *rows,
+                        float *scores);
+static void align_lanes_symmetric(char **refs, char **queries,
+                                  Batch_Pair *pairs, int num_lane,
+                                  Score_Param score_param, Sse_Rows *rows,
+                                  float *scores, float *reverse_scores);
+#endif
+#ifdef SIMD_WIDE_KERNELS
+#define WIDE_ALIGNMENT 64 // bytes of a zmm register
+
+/* the rows of a wide kernel, width floats per cell */
+typedef struct {
+    int width;
+    float *ref_bases;
+    float *query_bases;
+    float *col_valid;
+    float *row_valid;
+    float *m_row;
+    float *i_row;
+    float *h_row;
+} Lane_Rows;
+
+static void swalign_batch_wide(char **refs, char **queries, int num_pair,
+                               Score_Param score_param, float *scores,
+                               Arena *arena, int width);
+static void layout_lanes(char **refs, char **queries, Batch_Pair *pairs,
+                         int num_lane, int nrow, int ncol, Lane_Rows *rows);
+static void align_lanes_avx2(Batch_Pair *pairs, int num_lane, int nrow, int ncol,
+                             Score_Param score_param, Lane_Rows *rows,
+                             float *scores);
+static void align_lanes_avx512(Batch_Pair *pairs, int num_lane, int nrow, int ncol,
+                               Score_Param score_param, Lane_Rows *rows,
+                               float *scores);
+static float *aligned_floats(Arena *arena, size_t num_float);
+#endif
+
+
+/* swalign_batch:
+ * compute swalign(refs[k], queries[k], score_param) for all k < num_pair
+ * and write the result into scores[k]. */
+void swalign_batch(char **refs, char **queries, int num_pair,
+                   Score_Param score_param, float *scores)
+{
+    Arena *arena = create_arena(sizeof(Batch_Pair) * (num_pair +1));
+    swalign_batch_arena(refs, queries, num_pair, score_param, scores, arena);
+    free_arena(arena);
+}
+
+/* swalign_batch_arena:
+ * swalign_batch() taking its scratch space from arena. A caller
+ * resetting the arena between batches doesn't go to the heap
+ * once it has seen its largest batch. */
+void swalign_batch_arena(char **refs, char **queries, int num_pair,
+                         Score_Param score_param, float *scores,
+                         Arena *arena)
+{
+    swinc_kernels()->swalign_batch(refs, queries, num_pair, score_param,
+                                   scores, arena);
+}
+
+/* swalign_batch_scalar: the batch kernel of the scalar level */
+void swalign_batch_scalar(char **refs, char **queries, int num_pair,
+                          Score_Param score_param, float *scores,
+                          Arena *arena)
+{
+    (void) arena; // swalign_linear() needs no scratch space
+    register int k;
+    for (k = 0; k < num_pair; k++)
+    {
+        scores[k] = swalign_linear(refs[k], queries[k], score_param).score;
+    }
+}
+
+#ifdef __SSE2__
+/* swalign_batch_sse: the batch kernel of the sse2 level */
+void swalign_batch_sse(char **refs, char **queries, int num_pair,
+                       Score_Param score_param, float *scores,
+                       Arena *arena)
+{
+    register int k;
+    Sse_Rows rows;
+    Batch_Pair *pairs = arena_alloc(arena, sizeof(Batch_Pair) * (num_pair +1));
+    bucket_pairs(refs, queries, num_pair, pairs);
+    allocate_sse_rows(arena, pairs, num_pair, 0, &rows);
+    for (k = 0; k < num_pair; k += BATCH_LANES)
+    {
+        align_lanes(refs, queries, pairs + k,
+                    (num_pair - k < BATCH_LANES) ? num_pair - k : BATCH_LANES,
+                    score_param, &rows, scores);
+    }
+}
+#endif
+
+#ifdef SIMD_WIDE_KERNELS
+/* swalign_batch_avx2: the batch kernel of the avx2 level */
+void swalign_batch_avx2(char **refs, char **queries, int num_pair,
+                        Score_Param score_param, float *scores,
+                        Arena *arena)
+{
+    swalign_batch_wide(refs, queries, num_pair, score_param, scores,
+                       arena, BATCH_LANES_AVX2);
+}
+
+/* swalign_batch_avx512: the batch kernel of the avx512 level */
+void swalign_batch_avx512(char **refs, char **queries, int num_pair,
+                          Score_Param score_param, float *scores,
+                          Arena *arena)
+{
+    swalign_batch_wide(refs, queries, num_pair, score_param, scores,
+                       arena, BATCH_LANES_AVX512);
+}
+#endif
+
+
+/* swalign_batch_symmetric:
+ * as swalign_batch(), and also write into reverse_scores[k] the score
+ * of the opposite orientation of the duplex, i.e.
+ *     swalign(rc(queries[k]), rc(refs[k]), score_param)
+ * where rc is the full reverse complement. The sequences must be made
+ * of A, C, G and T only, so that comparing complements is the same as
+ * comparing bases.
+ *
+ * Reverse complementing both sequences of an alignment and swapping
+ * their roles gives an alignment of the opposite orientation, with
+ * the same substitutions and the same gap runs (insert and delete are
+ * scored alike). What changes is the frame: a swinc alignment starts
+ * in a null entry (first row or column) and ends anywhere, so the
+ * opposite orientation is the best path of this sw_matrix that starts
+ * anywhere and ends on entering the last row or column. Its first gap
+ * run follows a match (opened) while its last one is the run the
+ * swinc alignment starts with: max(gap_extension, gap_open), as for
+ * a null entry, then extended. Those records are carried along in the
+ * same sweep as the forward ones, so the scores agree with a direct
+ * alignment up to the order of the float additions (exactly, for
+ * scores such as the default ones). */
+void swalign_batch_symmetric(char **refs, char **queries, int num_pair,
+                             Score_Param score_param,
+                             float *scores, float *reverse_scores)
+{
+    Arena *arena = create_arena(sizeof(Batch_Pair) * (num_pair +1));
+    swalign_batch_symmetric_arena(refs, queries, num_pair, score_param,
+                                  scores, reverse_scores, arena);
+    free_arena(arena);
+}
+
+/* swalign_batch_symmetric_arena:
+ * swalign_batch_symmetric() taking its scratch space from arena,
+ * as swalign_batch_arena() */
+void swalign_batch_symmetric_arena(char **refs, char **queries, int num_pair,
+                                   Score_Param score_param,
+                                   float *scores, float *reverse_scores,
+                                   Arena *arena)
+{
+    register int k;
+#ifdef __SSE2__
+    Sse_Rows rows;
+    Batch_Pair *pairs = arena_alloc(arena, sizeof(Batch_Pair) * (num_pair +1));
+    bucket_pairs(refs, queries, num_pair, pairs);
+    allocate_sse_rows(arena, pairs, num_pair, 1, &rows);
+    for (k = 0; k < num_pair; k += BATCH_LANES)
+    {
+        align_lanes_symmetric(refs, queries, pairs + k,
+                              (num_pair - k < BATCH_LANES) ? num_pair - k : BATCH_LANES,
+                              score_param, &rows, scores, reverse_scores);
+    }
+#else
+    char *rc_ref, *rc_query;
+    for (k = 0; k < num_pair; k++)
+    {
+        scores[k] = swalign(refs[k], queries[k], score_param);
+        rc_ref = rev_complement(refs[k], strlen(refs[k]));
+        rc_query = rev_complement(queries[k], strlen(queries[k]));
+        reverse_scores[k] = swalign(rc_query, rc_ref, score_param);
+        free(rc_ref);
+        free(rc_query);
+    }
+#endif
+}
+
+
+#ifdef __SSE2__
+/* bucket_pairs:
+ * write into pairs the lengths of the pairs, sorted so that
+ * neighbours in the list can share a batch (length bucketing). */
+static void bucket_pairs(char **refs, char **queries, int num_pair,
+                         Batch_Pair *pairs)
+{
+    register int k;
+    for (k = 0; k < num_pair; k++)
+    {
+        pairs[k].index = k;
+        pairs[k].ref_len = strlen(refs[k]);
+        pairs[k].query_len = strlen(queries[k]);
+    }
+    qsort(pairs, num_pair, sizeof(Batch_Pair), compare_pair_len);
+}
+
+
+/* compare_pair_len: order pairs by query length then ref length */
+static int compare_pair_len(const void *pair1, const void *pair2)
+{
+    const Batch_Pair *first = pair1;
+    const Batch_Pair *second = pair2;
+    if (first->query_len != second->query_len)
+    {
+        return first->query_len - second->query_len;
+    }
+    if (first->ref_len != second->ref_len)
+    {
+        return first->ref_len - second->ref_len;
+    }
+    return first->index - second->index;
+}
+
+
+/* allocate_sse_rows:
+ * the rows of the largest matrix of pairs from arena (aligned to
+ * ARENA_ALIGNMENT, enough for SSE loads), with the masks and reverse
+ * records of align_lanes_symmetric() if symmetric. */
+static void allocate_sse_rows(Arena *arena, Batch_Pair *pairs, int num_pair,
+                              int symmetric, Sse_Rows *rows)
+{
+    int max_nrow = 0, max_ncol = 0;
+    register int k;
+    for (k = 0; k < num_pair; k++)
+    {
+        max_nrow = (pairs[k].query_len > max_nrow) ? pairs[k].query_len : max_nrow;
+        max_ncol = (pairs[k].ref_len > max_ncol) ? pairs[k].ref_len : max_ncol;
+    }
+    size_t row_size = sizeof(float) * BATCH_LANES * (max_nrow +1);
+    size_t col_size = sizeof(float) * BATCH_LANES * (max_ncol +1);
+    memset(rows, 0, sizeof(Sse_Rows));
+    rows->ref_bases = arena_alloc(arena, col_size);
+    rows->query_bases = arena_alloc(arena, row_size);
+    rows->col_valid = arena_alloc(arena, col_size);
+    rows->row_valid = arena_alloc(arena, row_size);
+    rows->m_row = arena_alloc(arena, col_size);
+    rows->i_row = arena_alloc(arena, col_size);
+    rows->h_row = arena_alloc(arena, col_size);
+    if (symmetric)
+    {
+        rows->col_last = arena_alloc(arena, col_size);
+        rows->col_inside = arena_alloc(arena, col_size);
+        rows->row_last = arena_alloc(arena, row_size);
+        rows->row_inside = arena_alloc(arena, row_size);
+        rows->rm_row = arena_alloc(arena, col_size);
+        rows->ri_row = arena_alloc(arena, col_size);
+        rows->rie_row = arena_alloc(arena, col_size);
+        rows->rh_row = arena_alloc(arena, col_size);
+    }
+}
+
+
+/* align_lanes:
+ * run the DP of up to BATCH_LANES pairs in lockstep, row by row.
+ * Only one row of M, I and H is kept, D is carried along the row. */
+static void align_lanes(char **refs, char **queries,
+                        Batch_Pair *pairs, int num_lane,
+                        Score_Param score_param, Sse_Rows *rows,
+                        float *scores)
+{
+    INSTRUMENT_START(fill_timer);
+    int nrow = 0, ncol = 0;
+    int lane;
+    register int row, col;
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        nrow = (pairs[lane].query_len > nrow) ? pairs[lane].query_len : nrow;
+        ncol = (pairs[lane].ref_len > ncol) ? pairs[lane].ref_len : ncol;
+    }
+    nrow++;
+    ncol++;
+    // bases as floats so that lanes can be compared in one go,
+    // padding of ref and query use different values and never match.
+    // The validity masks are 0 in valid cells and -INFINITY elsewhere.
+    float (*ref_bases)[BATCH_LANES] = rows->ref_bases;
+    float (*query_bases)[BATCH_LANES] = rows->query_bases;
+    float (*col_valid)[BATCH_LANES] = rows->col_valid;
+    float (*row_valid)[BATCH_LANES] = rows->row_valid;
+    float (*m_row)[BATCH_LANES] = rows->m_row;
+    float (*i_row)[BATCH_LANES] = rows->i_row;
+    float (*h_row)[BATCH_LANES] = rows->h_row;
+    for (lane = 0; lane < BATCH_LANES; lane++)
+    {
+        char *ref = (lane < num_lane) ? refs[pairs[lane].index] : "";
+        char *query = (lane < num_lane) ? queries[pairs[lane].index] : "";
+        int ref_len = (lane < num_lane) ? pairs[lane].ref_len : 0;
+        int query_len = (lane < num_lane) ? pairs[lane].query_len : 0;
+        for (col = 1; col < ncol; col++)
+        {
+            ref_bases[col][lane] = (col <= ref_len) ?
+                                   (unsigned char) ref[col -1] : -1.0;
+            col_valid[col][lane] = (col <= ref_len) ? 0.0 : -INFINITY;
+        }
+        for (row = 1; row < nrow; row++)
+        {
+            query_bases[row][lane] = (row <= query_len) ?
+                                     (unsigned char) query[row -1] : -2.0;
+            row_valid[row][lane] = (row <= query_len) ? 0.0 : -INFINITY;
+        }
+    }
+    // the first row is null entries
+    for (col = 0; col < ncol; col++)
+    {
+        _mm_store_ps(m_row[col], _mm_setzero_ps());
+        _mm_store_ps(i_row[col], _mm_setzero_ps());
+        _mm_store_ps(h_row[col], _mm_setzero_ps());
+    }
+
+    const __m128 v_match = _mm_set1_ps(score_param.match_score);
+    const __m128 v_mismatch = _mm_set1_ps(score_param.mismatch_penalty);
+    const __m128 v_gap_open = _mm_set1_ps(score_param.gap_open_penalty);
+    const __m128 v_gap_extension = _mm_set1_ps(score_param.gap_extension_penalty);
+    __m128 v_best = _mm_setzero_ps();
+    __m128 v_query, v_valid, v_equal, v_diag, v_up_h;
+    __m128 v_m, v_i, v_d, v_h, v_left_m, v_left_d;
+    for (row = 1; row < nrow; row++)
+    {
+        v_query = _mm_load_ps(query_bases[row]);
+        v_valid = _mm_load_ps(row_valid[row]);
+        // the first column is null entries
+        v_diag = _mm_setzero_ps();
+        v_left_m = _mm_setzero_ps();
+        v_left_d = _mm_setzero_ps();
+        for (col = 1; col < ncol; col++)
+        {
+            v_equal = _mm_cmpeq_ps(_mm_load_ps(ref_bases[col]), v_query);
+            v_m = _mm_add_ps(v_diag, _mm_or_ps(_mm_and_ps(v_equal, v_match),
+                                               _mm_andnot_ps(v_equal, v_mismatch)));
+            v_i = _mm_max_ps(_mm_add_ps(_mm_load_ps(i_row[col]), v_gap_extension),
+                             _mm_add_ps(_mm_load_ps(m_row[col]), v_gap_open));
+            v_d = _mm_max_ps(_mm_add_ps(v_left_d, v_gap_extension),
+                             _mm_add_ps(v_left_m, v_gap_open));
+            v_h = _mm_max_ps(_mm_max_ps(v_m, v_i), v_d);
+            v_up_h = _mm_load_ps(h_row[col]);
+            _mm_store_ps(m_row[col], v_m);
+            _mm_store_ps(i_row[col], v_i);
+            _mm_store_ps(h_row[col], v_h);
+            v_best = _mm_max_ps(v_best,
+                                _mm_add_ps(_mm_add_ps(v_h, v_valid),
+                                           _mm_load_ps(col_valid[col])));
+            v_diag = v_up_h;
+            v_left_m = v_m;
+            v_left_d = v_d;
+        }
+    }
+
+    float best[BATCH_LANES] __attribute__((aligned(16)));
+    _mm_store_ps(best, v_best);
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        scores[pairs[lane].index] = best[lane];
+        INSTRUMENT_COUNT(COUNTER_CELLS, (long long) pairs[lane].ref_len * pairs[lane].query_len);
+    }
+    // the cells are the lanes' own, not the padding
+    INSTRUMENT_ALIGNMENT(fill_timer, num_lane, 0);
+}
+
+
+/* select_lanes: lanes of if_true where mask is set, of if_false elsewhere */
+static __m128 select_lanes(__m128 mask, __m128 if_true, __m128 if_false)
+{
+    return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+}
+
+/* align_lanes_symmetric:
+ * align_lanes() together with the records of the opposite orientation
+ * (see swalign_batch_symmetric()). With m = query_len, n = ref_len:
+ *   RM[row][col] = max(0, RH[row-1][col-1]) + match or mismatch
+ *   RI[row][col] = max(RI[row-1][col] + gap_extension,
+ *                      max(0, RM[row-1][col]) + gap_open)
+ *   RD[row][col] = max(RD[row][col-1] + gap_extension,
+ *                      max(0, RM[row][col-1]) + gap_open)
+ * and RIe, RDe the same but opening at max(gap_open, gap_extension);
+ * RH = max(RM, RI, RD), the 0 being a path starting there.
+ * The first row and column hold the delete and insert runs a path
+ * may start with. These records are kept while row < m and col < n
+ * only; the reverse score is the best of RM on entering row m or col n,
+ * RIe on entering row m from above and RDe on entering col n from the
+ * left. */
+static void align_lanes_symmetric(char **refs, char **queries,
+                                  Batch_Pair *pairs, int num_lane,
+                                  Score_Param score_param, Sse_Rows *rows,
+                                  float *scores, float *reverse_scores)
+{
+    INSTRUMENT_START(fill_timer);
+    int nrow = 0, ncol = 0;
+    int lane;
+    register int row, col;
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        nrow = (pairs[lane].query_len > nrow) ? pairs[lane].query_len : nrow;
+        ncol = (pairs[lane].ref_len > ncol) ? pairs[lane].ref_len : ncol;
+    }
+    nrow++;
+    ncol++;
+    // as in align_lanes(), plus masks (all bits set, or 0) telling
+    // whether a row or col is the last one of the lane, or before it.
+    float (*ref_bases)[BATCH_LANES] = rows->ref_bases;
+    float (*query_bases)[BATCH_LANES] = rows->query_bases;
+    float (*col_valid)[BATCH_LANES] = rows->col_valid;
+    float (*row_valid)[BATCH_LANES] = rows->row_valid;
+    int (*col_last)[BATCH_LANES] = rows->col_last;
+    int (*col_inside)[BATCH_LANES] = rows->col_inside;
+    int (*row_last)[BATCH_LANES] = rows->row_last;
+    int (*row_inside)[BATCH_LANES] = rows->row_inside;
+    float (*m_row)[BATCH_LANES] = rows->m_row;
+    float (*i_row)[BATCH_LANES] = rows->i_row;
+    float (*h_row)[BATCH_LANES] = rows->h_row;
+    float (*rm_row)[BATCH_LANES] = rows->rm_row;
+    float (*ri_row)[BATCH_LANES] = rows->ri_row;
+    float (*rie_row)[BATCH_LANES] = rows->rie_row;
+    float (*rh_row)[BATCH_LANES] = rows->rh_row;
+    for (lane = 0; lane < BATCH_LANES; lane++)
+    {
+        char *ref = (lane < num_lane) ? refs[pairs[lane].index] : "";
+        char *query = (lane < num_lane) ? queries[pairs[lane].index] : "";
+        int ref_len = (lane < num_lane) ? pairs[lane].ref_len : 0;
+        int query_len = (lane < num_lane) ? pairs[lane].query_len : 0;
+        for (col = 0; col < ncol; col++)
+        {
+            ref_bases[col][lane] = (col > 0 && col <= ref_len) ?
+                                   (unsigned char) ref[col -1] : -1.0;
+            col_valid[col][lane] = (col <= ref_len) ? 0.0 : -INFINITY;
+            col_last[col][lane] = (col == ref_len) ? -1 : 0;
+            col_inside[col][lane] = (col < ref_len) ? -1 : 0;
+        }
+        for (row = 0; row < nrow; row++)
+        {
+            query_bases[row][lane] = (row > 0 && row <= query_len) ?
+                                     (unsigned char) query[row -1] : -2.0;
+            row_valid[row][lane] = (row <= query_len) ? 0.0 : -INFINITY;
+            row_last[row][lane] = (row == query_len) ? -1 : 0;
+            row_inside[row][lane] = (row < query_len) ? -1 : 0;
+        }
+    }
+    const __m128 v_zero = _mm_setzero_ps();
+    const __m128 v_neg_inf = _mm_set1_ps(-INFINITY);
+    const __m128 v_match = _mm_set1_ps(score_param.match_score);
+    const __m128 v_mismatch = _mm_set1_ps(score_param.mismatch_penalty);
+    const __m128 v_gap_open = _mm_set1_ps(score_param.gap_open_penalty);
+    const __m128 v_gap_extension = _mm_set1_ps(score_param.gap_extension_penalty);
+    const __m128 v_first_gap = _mm_max_ps(v_gap_open, v_gap_extension);
+    __m128 v_best = _mm_setzero_ps();
+    __m128 v_reverse_best = _mm_setzero_ps();
+    __m128 v_query, v_valid, v_equal, v_substitution, v_diag, v_up_h;
+    __m128 v_m, v_i, v_d, v_h, v_left_m, v_left_d;
+    __m128 v_row_last, v_row_inside, v_col_last, v_col_inside, v_inside;
+    __m128 v_rdiag, v_up_rh, v_up_rm, v_rm, v_ri, v_rie, v_rd, v_rde, v_rh;
+    __m128 v_left_rm, v_left_rd, v_left_rde, v_ending;
+
+    // first row: null entries going forward. Backward, a path may
+    // start with a delete run there (it only pays off when the gap
+    // penalties are positive), as with an insert run in the first column.
+    v_row_last = _mm_load_ps((float *) row_last[0]);
+    v_row_inside = _mm_load_ps((float *) row_inside[0]);
+    v_left_rd = v_left_rde = v_neg_inf;
+    for (col = 0; col < ncol; col++)
+    {
+        _mm_store_ps(m_row[col], _mm_setzero_ps());
+        _mm_store_ps(i_row[col], _mm_setzero_ps());
+        _mm_store_ps(h_row[col], _mm_setzero_ps());
+        _mm_store_ps(rm_row[col], v_neg_inf);
+        _mm_store_ps(ri_row[col], v_neg_inf);
+        _mm_store_ps(rie_row[col], v_neg_inf);
+        _mm_store_ps(rh_row[col], v_neg_inf);
+        if (col == 0)
+        {
+            continue;
+        }
+        v_rd = _mm_max_ps(_mm_add_ps(v_left_rd, v_gap_extension), v_gap_open);
+        v_rde = _mm_max_ps(_mm_add_ps(v_left_rde, v_gap_extension), v_first_gap);
+        v_col_last = _mm_load_ps((float *) col_last[col]);
+        v_col_inside = _mm_load_ps((float *) col_inside[col]);
+        v_reverse_best = _mm_max_ps(v_reverse_best,
+                                    select_lanes(_mm_and_ps(v_col_last, v_row_inside),
+                                                 v_rde, v_neg_inf));
+        v_inside = _mm_and_ps(v_row_inside, v_col_inside);
+        v_left_rd = select_lanes(v_inside, v_rd, v_neg_inf);
+        v_left_rde = select_lanes(v_inside, v_rde, v_neg_inf);
+        _mm_store_ps(rh_row[col], v_left_rd);
+    }
+
+    for (row = 1; row < nrow; row++)
+    {
+        v_query = _mm_load_ps(query_bases[row]);
+        v_valid = _mm_load_ps(row_valid[row]);
+        v_row_last = _mm_load_ps((float *) row_last[row]);
+        v_row_inside = _mm_load_ps((float *) row_inside[row]);
+        v_diag = _mm_setzero_ps();
+        v_left_m = _mm_setzero_ps();
+        v_left_d = _mm_setzero_ps();
+        // first column backward: insert runs only
+        v_rdiag = _mm_load_ps(rh_row[0]);
+        v_ri = _mm_max_ps(_mm_add_ps(_mm_load_ps(ri_row[0]), v_gap_extension),
+                          v_gap_open);
+        v_rie = _mm_max_ps(_mm_add_ps(_mm_load_ps(rie_row[0]), v_gap_extension),
+                           v_first_gap);
+        v_col_inside = _mm_load_ps((float *) col_inside[0]);
+        v_reverse_best = _mm_max_ps(v_reverse_best,
+                                    select_lanes(_mm_and_ps(v_row_last, v_col_inside),
+                                                 v_rie, v_neg_inf));
+        v_inside = _mm_and_ps(v_row_inside, v_col_inside);
+        v_ri = select_lanes(v_inside, v_ri, v_neg_inf);
+        _mm_store_ps(ri_row[0], v_ri);
+        _mm_store_ps(rie_row[0], select_lanes(v_inside, v_rie, v_neg_inf));
+        _mm_store_ps(rh_row[0], v_ri);
+        v_left_rm = v_left_rd = v_left_rde = v_neg_inf;
+        for (col = 1; col < ncol; col++)
+        {
+            v_equal = _mm_cmpeq_ps(_mm_load_ps(ref_bases[col]), v_query);
+            v_substitution = select_lanes(v_equal, v_match, v_mismatch);
+            v_m = _mm_add_ps(v_diag, v_substitution);
+            v_i = _mm_max_ps(_mm_add_ps(_mm_load_ps(i_row[col]), v_gap_extension),
+                             _mm_add_ps(_mm_load_ps(m_row[col]), v_gap_open));
+            v_d = _mm_max_ps(_mm_add_ps(v_left_d, v_gap_extension),
+                             _mm_add_ps(v_left_m, v_gap_open));
+            v_h = _mm_max_ps(_mm_max_ps(v_m, v_i), v_d);
+            v_up_h = _mm_load_ps(h_row[col]);
+            _mm_store_ps(m_row[col], v_m);
+            _mm_store_ps(i_row[col], v_i);
+            _mm_store_ps(h_row[col], v_h);
+            v_best = _mm_max_ps(v_best,
+                                _mm_add_ps(_mm_add_ps(v_h, v_valid),
+                                           _mm_load_ps(col_valid[col])));
+            v_diag = v_up_h;
+            v_left_m = v_m;
+            v_left_d = v_d;
+
+            // opposite orientation
+            v_up_rh = _mm_load_ps(rh_row[col]);
+            v_up_rm = _mm_max_ps(_mm_load_ps(rm_row[col]), v_zero);
+            v_rm = _mm_add_ps(_mm_max_ps(v_rdiag, v_zero), v_substitution);
+            v_ri = _mm_max_ps(_mm_add_ps(_mm_load_ps(ri_row[col]), v_gap_extension),
+                              _mm_add_ps(v_up_rm, v_gap_open));
+            v_rie = _mm_max_ps(_mm_add_ps(_mm_load_ps(rie_row[col]), v_gap_extension),
+                               _mm_add_ps(v_up_rm, v_first_gap));
+            v_rd = _mm_max_ps(_mm_add_ps(v_left_rd, v_gap_extension),
+                              _mm_add_ps(_mm_max_ps(v_left_rm, v_zero), v_gap_open));
+            v_rde = _mm_max_ps(_mm_add_ps(v_left_rde, v_gap_extension),
+                               _mm_add_ps(_mm_max_ps(v_left_rm, v_zero), v_first_gap));
+            v_col_last = _mm_load_ps((float *) col_last[col]);
+            v_col_inside = _mm_load_ps((float *) col_inside[col]);
+            // ending on entering the last row or column
+            v_ending = select_lanes(_mm_or_ps(_mm_and_ps(v_row_last,
+                                                   _mm_or_ps(v_col_inside, v_col_last)),
+                                        _mm_and_ps(v_col_last, v_row_inside)),
+                              v_rm, v_neg_inf);
+            v_ending = _mm_max_ps(v_ending,
+                                  select_lanes(_mm_and_ps(v_row_last, v_col_inside), v_rie, v_neg_inf));
+            v_ending = _mm_max_ps(v_ending,
+                                  select_lanes(_mm_and_ps(v_col_last, v_row_inside), v_rde, v_neg_inf));
+            v_reverse_best = _mm_max_ps(v_reverse_best, v_ending);
+            // records are only kept strictly inside the last row and column
+            v_inside = _mm_and_ps(v_row_inside, v_col_inside);
+            v_rm = select_lanes(v_inside, v_rm, v_neg_inf);
+            v_ri = select_lanes(v_inside, v_ri, v_neg_inf);
+            v_rie = select_lanes(v_inside, v_rie, v_neg_inf);
+            v_rd = select_lanes(v_inside, v_rd, v_neg_inf);
+            v_rde = select_lanes(v_inside, v_rde, v_neg_inf);
+            v_rh = _mm_max_ps(_mm_max_ps(v_rm, v_ri), v_rd);
+            _mm_store_ps(rm_row[col], v_rm);
+            _mm_store_ps(ri_row[col], v_ri);
+            _mm_store_ps(rie_row[col], v_rie);
+            _mm_store_ps(rh_row[col], v_rh);
+            v_rdiag = v_up_rh;
+            v_left_rm = v_rm;
+            v_left_rd = v_rd;
+            v_left_rde = v_rde;
+        }
+    }
+
+    float best[BATCH_LANES] __attribute__((aligned(16)));
+    float reverse_best[BATCH_LANES] __attribute__((aligned(16)));
+    _mm_store_ps(best, v_best);
+    _mm_store_ps(reverse_best, v_reverse_best);
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        scores[pairs[lane].index] = best[lane];
+        reverse_scores[pairs[lane].index] = reverse_best[lane];
+        INSTRUMENT_COUNT(COUNTER_CELLS, (long long) pairs[lane].ref_len * pairs[lane].query_len);
+    }
+    INSTRUMENT_ALIGNMENT(fill_timer, num_lane, 0);
+}
+#endif /* __SSE2__ */
+
+
+#ifdef SIMD_WIDE_KERNELS
+/* swalign_batch_wide:
+ * the batches of width pairs, the rows allocated once
+ * for the largest matrix of all. */
+static void swalign_batch_wide(char **refs, char **queries, int num_pair,
+                               Score_Param score_param, float *scores,
+                               Arena *arena, int width)
+{
+    Batch_Pair *pairs = arena_alloc(arena, sizeof(Batch_Pair) * (num_pair +1));
+    bucket_pairs(refs, queries, num_pair, pairs);
+    int max_nrow = 0, max_ncol = 0;
+    int k, lane, nrow, ncol, num_lane;
+    for (k = 0; k < num_pair; k++)
+    {
+        max_nrow = (pairs[k].query_len > max_nrow) ? pairs[k].query_len : max_nrow;
+        max_ncol = (pairs[k].ref_len > max_ncol) ? pairs[k].ref_len : max_ncol;
+    }
+    max_nrow++;
+    max_ncol++;
+    Lane_Rows rows;
+    rows.width = width;
+    rows.ref_bases = aligned_floats(arena, (size_t) max_ncol * width);
+    rows.query_bases = aligned_floats(arena, (size_t) max_nrow * width);
+    rows.col_valid = aligned_floats(arena, (size_t) max_ncol * width);
+    rows.row_valid = aligned_floats(arena, (size_t) max_nrow * width);
+    rows.m_row = aligned_floats(arena, (size_t) max_ncol * width);
+    rows.i_row = aligned_floats(arena, (size_t) max_ncol * width);
+    rows.h_row = aligned_floats(arena, (size_t) max_ncol * width);
+
+    for (k = 0; k < num_pair; k += width)
+    {
+        num_lane = (num_pair - k < width) ? num_pair - k : width;
+        nrow = ncol = 0;
+        for (lane = 0; lane < num_lane; lane++)
+        {
+            nrow = (pairs[k + lane].query_len > nrow) ? pairs[k + lane].query_len : nrow;
+            ncol = (pairs[k + lane].ref_len > ncol) ? pairs[k + lane].ref_len : ncol;
+        }
+        nrow++;
+        ncol++;
+        layout_lanes(refs, queries, pairs + k, num_lane, nrow, ncol, &rows);
+        if (width == BATCH_LANES_AVX512)
+        {
+            align_lanes_avx512(pairs + k, num_lane, nrow, ncol, score_param,
+                               &rows, scores);
+        }else
+        {
+            align_lanes_avx2(pairs + k, num_lane, nrow, ncol, score_param,
+                             &rows, scores);
+        }
+    }
+}
+
+/* layout_lanes:
+ * the bases and validity masks of the lanes, as in align_lanes() */
+static void layout_lanes(char **refs, char **queries, Batch_Pair *pairs,
+                         int num_lane, int nrow, int ncol, Lane_Rows *rows)
+{
+    int width = rows->width;
+    int lane;
+    register int row, col;
+    for (lane = 0; lane < width; lane++)
+    {
+        char *ref = (lane < num_lane) ? refs[pairs[lane].index] : "";
+        char *query = (lane < num_lane) ? queries[pairs[lane].index] : "";
+        int ref_len = (lane < num_lane) ? pairs[lane].ref_len : 0;
+        int query_len = (lane < num_lane) ? pairs[lane].query_len : 0;
+        for (col = 1; col < ncol; col++)
+        {
+            rows->ref_bases[col * width + lane] = (col <= ref_len) ?
+                                                  (unsigned char) ref[col -1] : -1.0;
+            rows->col_valid[col * width + lane] = (col <= ref_len) ? 0.0 : -INFINITY;
+        }
+        for (row = 1; row < nrow; row++)
+        {
+            rows->query_bases[row * width + lane] = (row <= query_len) ?
+                                                    (unsigned char) query[row -1] : -2.0;
+            rows->row_valid[row * width + lane] = (row <= query_len) ? 0.0 : -INFINITY;
+        }
+    }
+    // the first row is null entries
+    for (col = 0; col < ncol * width; col++)
+    {
+        rows->m_row[col] = rows->i_row[col] = rows->h_row[col] = 0.0;
+    }
+}
+
+/* align_lanes_avx2:
+ * align_lanes() on BATCH_LANES_AVX2 lanes, rows laid out by layout_lanes() */
+__attribute__((target("avx2")))
+static void align_lanes_avx2(Batch_Pair *pairs, int num_lane, int nrow, int ncol,
+                             Score_Param score_param, Lane_Rows *rows,
+                             float *scores)
+{
+    INSTRUMENT_START(fill_timer);
+    const int width = BATCH_LANES_AVX2;
+    const __m256 v_match = _mm256_set1_ps(score_param.match_score);
+    const __m256 v_mismatch = _mm256_set1_ps(score_param.mismatch_penalty);
+    const __m256 v_gap_open = _mm256_set1_ps(score_param.gap_open_penalty);
+    const __m256 v_gap_extension = _mm256_set1_ps(score_param.gap_extension_penalty);
+    __m256 v_best = _mm256_setzero_ps();
+    __m256 v_query, v_valid, v_equal, v_diag, v_up_h;
+    __m256 v_m, v_i, v_d, v_h, v_left_m, v_left_d;
+    int lane;
+    register int row, col;
+    for (row = 1; row < nrow; row++)
+    {
+        v_query = _mm256_load_ps(rows->query_bases + row * width);
+        v_valid = _mm256_load_ps(rows->row_valid + row * width);
+        // the first column is null entries
+        v_diag = _mm256_setzero_ps();
+        v_left_m = _mm256_setzero_ps();
+        v_left_d = _mm256_setzero_ps();
+        for (col = 1; col < ncol; col++)
+        {
+            v_equal = _mm256_cmp_ps(_mm256_load_ps(rows->ref_bases + col * width),
+                                    v_query, _CMP_EQ_OQ);
+            v_m = _mm256_add_ps(v_diag, _mm256_blendv_ps(v_mismatch, v_match, v_equal));
+            v_i = _mm256_max_ps(_mm256_add_ps(_mm256_load_ps(rows->i_row + col * width),
+                                              v_gap_extension),
+                                _mm256_add_ps(_mm256_load_ps(rows->m_row + col * width),
+                                              v_gap_open));
+            v_d = _mm256_max_ps(_mm256_add_ps(v_left_d, v_gap_extension),
+                                _mm256_add_ps(v_left_m, v_gap_open));
+            v_h = _mm256_max_ps(_mm256_max_ps(v_m, v_i), v_d);
+            v_up_h = _mm256_load_ps(rows->h_row + col * width);
+            _mm256_store_ps(rows->m_row + col * width, v_m);
+            _mm256_store_ps(rows->i_row + col * width, v_i);
+            _mm256_store_ps(rows->h_row + col * width, v_h);
+            v_best = _mm256_max_ps(v_best,
+                                   _mm256_add_ps(_mm256_add_ps(v_h, v_valid),
+                                                 _mm256_load_ps(rows->col_valid + col * width)));
+            v_diag = v_up_h;
+            v_left_m = v_m;
+            v_left_d = v_d;
+        }
+    }
+
+    float best[BATCH_LANES_AVX2] __attribute__((aligned(32)));
+    _mm256_store_ps(best, v_best);
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        scores[pairs[lane].index] = best[lane];
+        INSTRUMENT_COUNT(COUNTER_CELLS, (long long) pairs[lane].ref_len * pairs[lane].query_len);
+    }
+    INSTRUMENT_ALIGNMENT(fill_timer, num_lane, 0);
+}
+
+/* align_lanes_avx512:
+ * align_lanes() on BATCH_LANES_AVX512 lanes, the comparison
+ * of bases going into a mask register */
+__attribute__((target("avx512f")))
+static void align_lanes_avx512(Batch_Pair *pairs, int num_lane, int nrow, int ncol,
+                               Score_Param score_param, Lane_Rows *rows,
+                               float *scores)
+{
+    INSTRUMENT_START(fill_timer);
+    const int width = BATCH_LANES_AVX512;
+    const __m512 v_match = _mm512_set1_ps(score_param.match_score);
+    const __m512 v_mismatch = _mm512_set1_ps(score_param.mismatch_penalty);
+    const __m512 v_gap_open = _mm512_set1_ps(score_param.gap_open_penalty);
+    const __m512 v_gap_extension = _mm512_set1_ps(score_param.gap_extension_penalty);
+    __m512 v_best = _mm512_setzero_ps();
+    __m512 v_query, v_valid, v_diag, v_up_h;
+    __m512 v_m, v_i, v_d, v_h, v_left_m, v_left_d;
+    __mmask16 equal;
+    int lane;
+    register int row, col;
+    for (row = 1; row < nrow; row++)
+    {
+        v_query = _mm512_load_ps(rows->query_bases + row * width);
+        v_valid = _mm512_load_ps(rows->row_valid + row * width);
+        // the first column is null entries
+        v_diag = _mm512_setzero_ps();
+        v_left_m = _mm512_setzero_ps();
+        v_left_d = _mm512_setzero_ps();
+        for (col = 1; col < ncol; col++)
+        {
+            equal = _mm512_cmp_ps_mask(_mm512_load_ps(rows->ref_bases + col * width),
+                                       v_query, _CMP_EQ_OQ);
+            v_m = _mm512_add_ps(v_diag, _mm512_mask_blend_ps(equal, v_mismatch, v_match));
+            v_i = _mm512_max_ps(_mm512_add_ps(_mm512_load_ps(rows->i_row + col * width),
+                                              v_gap_extension),
+                                _mm512_add_ps(_mm512_load_ps(rows->m_row + col * width),
+                                              v_gap_open));
+            v_d = _mm512_max_ps(_mm512_add_ps(v_left_d, v_gap_extension),
+                                _mm512_add_ps(v_left_m, v_gap_open));
+            v_h = _mm512_max_ps(_mm512_max_ps(v_m, v_i), v_d);
+            v_up_h = _mm512_load_ps(rows->h_row + col * width);
+            _mm512_store_ps(rows->m_row + col * width, v_m);
+            _mm512_store_ps(rows->i_row + col * width, v_i);
+            _mm512_store_ps(rows->h_row + col * width, v_h);
+            v_best = _mm512_max_ps(v_best,
+                                   _mm512_add_ps(_mm512_add_ps(v_h, v_valid),
+                                                 _mm512_load_ps(rows->col_valid + col * width)));
+            v_diag = v_up_h;
+            v_left_m = v_m;
+            v_left_d = v_d;
+        }
+    }
+
+    float best[BATCH_LANES_AVX512] __attribute__((aligned(64)));
+    _mm512_store_ps(best, v_best);
+    for (lane = 0; lane < num_lane; lane++)
+    {
+        scores[pairs[lane].index] = best[lane];
+        INSTRUMENT_COUNT(COUNTER_CELLS, (long long) pairs[lane].ref_len * pairs[lane].query_len);
+    }
+    INSTRUMENT_ALIGNMENT(fill_timer, num_lane, 0);
+}
+
+/* aligned_floats:
+ * num_float floats from arena, aligned for the widest vector
+ * loads (the arena only aligns to ARENA_ALIGNMENT) */
+static float *aligned_floats(Arena *arena, size_t num_float)
+{
+    char *memory = arena_alloc(arena, sizeof(float) * num_float + WIDE_ALIGNMENT);
+    size_t misalignment = (size_t) memory % WIDE_ALIGNMENT;
+    return (float *) (memory + ((misalignment > 0) ? WIDE_ALIGNMENT - misalignment : 0));
+}
+#endif /* SIMD_WIDE_KERNELS */
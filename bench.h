@@ -0,0 +1,70 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+/* Benchmarks of the alignment engines.
+ * swinc, swnn and sw are separate programs, each runs the benchmarks
+ * of its own engines when given -b (see run_swinc_benchmarks(),
+ * run_swnn_benchmarks() and sw.c). What they share is here: a seeded
+ * generator of primers and pools, a clock, and a JSON report with a
+ * record per engine and size, for trend tracking across versions. */
+
+/* xorshift64* state, the same seed gives the same sequences
+ * on every machine */
+typedef struct {
+    unsigned long long state;
+} Bench_Rng;
+
+/* the shape of the synthetic primers: lengths in [min_len, max_len],
+ * each base G or C with probability gc_content, and dimer_fraction of
+ * the primers ending in the reverse complement of the 3' end
+ * (DIMER_LEN bases) of another primer of the pool */
+#define DIMER_LEN 8
+typedef struct {
+    int min_len;
+    int max_len;
+    float gc_content;
+    float dimer_fraction;
+} Primer_Shape;
+
+/* one measurement: engine ran num_pair alignments (or duplexes) of
+ * num_cell DP cells in all, in seconds, and left num_pruned pairs
+ * out without aligning them (a prefilter) */
+typedef struct {
+    const char *engine;
+    const char *unit;       // "pairs" or "duplexes"
+    int seq_len;
+    int pool_size;          // 0 if not a pool alignment
+    long num_pair;
+    double num_cell;
+    double seconds;
+    long num_pruned;
+} Bench_Result;
+
+typedef struct {
+    FILE *outfile;
+    int num_result;
+} Bench_Json;
+
+/* the sizes run unless told otherwise */
+#define BENCH_SEED 20240601ULL
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_NUM_LEN 4
+#define BENCH_NUM_POOL_SIZE 3
+extern const int BENCH_SEQ_LENS[BENCH_NUM_LEN];
+extern const int BENCH_POOL_SIZES[BENCH_NUM_POOL_SIZE];
+
+void seed_bench_rng(Bench_Rng *rng, unsigned long long seed);
+unsigned long long bench_rand(Bench_Rng *rng);
+void make_bench_primer(Bench_Rng *rng, int len, float gc_content, char *primer);
+char **make_bench_pool(Bench_Rng *rng, int num_primer, Primer_Shape shape);
+void free_bench_pool(char **pool, int num_primer);
+double bench_seconds(void);
+void reset_peak_rss(void);
+long peak_rss_kb(void);
+void begin_bench_json(Bench_Json *json, FILE *outfile, const char *program);
+void add_bench_result(Bench_Json *json, Bench_Result result);
+void end_bench_json(Bench_Json *json);
+
+#endif /* BENCH_H */
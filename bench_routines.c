@@ -0,0 +1,230 @@
+/************************** BENCHMARK ROUTINES *****************************
+ * The generator, clock and JSON report shared by the benchmarks of
+ * swinc, swnn and sw (see bench.h).
+ *
+ * A report is a JSON object:
+ *   {"program": "swinc", "seed": ..., "simd": "avx2", "results": [
+ *     {"engine": "swalign_batch", "seq_len": 20, "pool_size": 0,
+ *      "pairs": ..., "cells": ..., "seconds": ...,
+ *      "gcups": ..., "pairs_per_second": ..., "peak_rss_kb": ...},
+ *     ...]}
+ * duplex engines report "duplexes" and "duplexes_per_second" instead
+ * of "pairs" and "pairs_per_second". "simd" is the instruction set
+ * level the kernels ran at (see simd.h). "peak_rss_kb" is the peak of
+ * the resident set while the engine ran: reset_peak_rss() before the
+ * run clears the high water mark of the process (Linux clear_refs),
+ * where that isn't possible it is the peak of the process so far.
+ * A line per result also goes to stderr for a human to read.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "bench.h"
+#include "simd.h"
+
+const int BENCH_SEQ_LENS[BENCH_NUM_LEN] = {20, 30, 40, 59};
+const int BENCH_POOL_SIZES[BENCH_NUM_POOL_SIZE] = {128, 512, 2048};
+
+static char complement_base(char base);
+
+
+void seed_bench_rng(Bench_Rng *rng, unsigned long long seed)
+{
+    rng->state = (seed != 0) ? seed : BENCH_SEED; // xorshift can't start at 0
+}
+
+/* bench_rand: the next 64 bit number of the xorshift64* sequence */
+unsigned long long bench_rand(Bench_Rng *rng)
+{
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 2685821657736338717ULL;
+}
+
+/* make_bench_primer:
+ * write a random primer of len bases into primer (len +1 chars) */
+void make_bench_primer(Bench_Rng *rng, int len, float gc_content, char *primer)
+{
+    unsigned long long random;
+    int i;
+    for (i = 0; i < len; i++)
+    {
+        random = bench_rand(rng);
+        if ((random >> 11) * (1.0 / 9007199254740992.0) < gc_content)
+        {
+            primer[i] = (random & 1) ? 'G' : 'C';
+        }else
+        {
+            primer[i] = (random & 1) ? 'A' : 'T';
+        }
+    }
+    primer[len] = '\0';
+}
+
+/* make_bench_pool:
+ * num_primer primers of the given shape, then the dimers seeded.
+ * Release with free_bench_pool(). */
+char **make_bench_pool(Bench_Rng *rng, int num_primer, Primer_Shape shape)
+{
+    char **pool = malloc(sizeof(char *) * (num_primer +1));
+    if (pool == NULL)
+    {
+        fprintf(stderr, "bench: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    int i, j, k, len, partner_len;
+    for (i = 0; i < num_primer; i++)
+    {
+        len = shape.min_len;
+        if (shape.max_len > shape.min_len)
+        {
+            len += bench_rand(rng) % (shape.max_len - shape.min_len +1);
+        }
+        pool[i] = malloc(len +1);
+        if (pool[i] == NULL)
+        {
+            fprintf(stderr, "bench: memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        make_bench_primer(rng, len, shape.gc_content, pool[i]);
+    }
+    // primer i gets the 3' end of primer j reverse complemented
+    int num_dimer = shape.dimer_fraction * num_primer;
+    for (k = 0; k < num_dimer && num_primer > 1; k++)
+    {
+        i = bench_rand(rng) % num_primer;
+        j = (i +1 + bench_rand(rng) % (num_primer -1)) % num_primer;
+        len = strlen(pool[i]);
+        partner_len = strlen(pool[j]);
+        if (len < DIMER_LEN || partner_len < DIMER_LEN)
+        {
+            continue;
+        }
+        int n;
+        for (n = 0; n < DIMER_LEN; n++)
+        {
+            pool[i][len - DIMER_LEN + n] = complement_base(pool[j][partner_len -1 - n]);
+        }
+    }
+    return pool;
+}
+
+void free_bench_pool(char **pool, int num_primer)
+{
+    int i;
+    for (i = 0; i < num_primer; i++)
+    {
+        free(pool[i]);
+    }
+    free(pool);
+}
+
+
+/* bench_seconds: a monotonic clock */
+double bench_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/* reset_peak_rss:
+ * bring the high water mark of the resident set down to the current
+ * resident set, so that peak_rss_kb() measures what runs after */
+void reset_peak_rss(void)
+{
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs != NULL)
+    {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+}
+
+/* peak_rss_kb:
+ * the largest resident set since the last reset_peak_rss(), or of
+ * the process so far where there's no VmHWM to read */
+long peak_rss_kb(void)
+{
+    char line[128];
+    long peak = -1;
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != NULL)
+    {
+        while (fgets(line, sizeof(line), status) != NULL)
+        {
+            if (sscanf(line, "VmHWM: %ld", &peak) == 1)
+            {
+                break;
+            }
+        }
+        fclose(status);
+    }
+    if (peak >= 0)
+    {
+        return peak;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return -1;
+    }
+    return usage.ru_maxrss; // kilobytes on Linux
+}
+
+
+void begin_bench_json(Bench_Json *json, FILE *outfile, const char *program)
+{
+    json->outfile = outfile;
+    json->num_result = 0;
+    fprintf(outfile, "{\"program\": \"%s\", \"seed\": %llu, \"simd\": \"%s\", "
+            "\"results\": [", program, BENCH_SEED, simd_level_name(simd_level()));
+}
+
+/* add_bench_result: a record of result in the report */
+void add_bench_result(Bench_Json *json, Bench_Result result)
+{
+    double seconds = (result.seconds > 0.0) ? result.seconds : 1e-9;
+    double gcups = result.num_cell / seconds * 1e-9;
+    double pair_rate = result.num_pair / seconds;
+    long rss = peak_rss_kb();
+    fprintf(json->outfile,
+            "%s\n  {\"engine\": \"%s\", \"seq_len\": %d, \"pool_size\": %d, "
+            "\"%s\": %ld, \"cells\": %.0f, \"seconds\": %.6f, "
+            "\"pruned\": %ld, \"gcups\": %.6f, \"%s_per_second\": %.2f, "
+            "\"peak_rss_kb\": %ld}",
+            (json->num_result > 0) ? "," : "",
+            result.engine, result.seq_len, result.pool_size,
+            result.unit, result.num_pair, result.num_cell, result.seconds,
+            result.num_pruned, gcups, result.unit, pair_rate, rss);
+    json->num_result++;
+    fprintf(stderr, "%-24s len %3d pool %5d  %10.4f GCUPS  %12.1f %s/s  %8ld kB\n",
+            result.engine, result.seq_len, result.pool_size,
+            gcups, pair_rate, result.unit, rss);
+}
+
+void end_bench_json(Bench_Json *json)
+{
+    fprintf(json->outfile, "\n]}\n");
+    fflush(json->outfile);
+}
+
+
+static char complement_base(char base)
+{
+    switch (base)
+    {
+        case 'A':
+            return 'T';
+        case 'T':
+            return 'A';
+        case 'G':
+            return 'C';
+        default:
+            return 'G';
+    }
+}
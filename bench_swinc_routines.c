@@ -0,0 +1,318 @@
+/************************** SWINC BENCHMARK ROUTINES ***********************
+ * The benchmarks of the swinc engines, run by swinc -b:
+ *   - pair engines (swalign() and the kernels that compute the same
+ *     scores or alignments) on BENCH_NUM_PAIR random pairs of each of
+ *     BENCH_SEQ_LENS,
+ *   - pool engines on synthetic pools of each of BENCH_POOL_SIZES
+ *     primers (18 to 30 bases, 50% GC, a tenth of them seeded with a
+ *     dimer), through pool[] and interaction_matrix where the engine
+ *     uses them.
+ * Each engine is run over its input until BENCH_MIN_SECONDS have gone
+ * by, and reported through add_bench_result(). align_pool_prefiltered()
+ * is credited with the pairs and cells it aligned, the pairs its
+ * prefilter left out are reported apart.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+#include "bench.h"
+
+#define BENCH_NUM_PAIR 256
+
+enum
+{
+    ENGINE_SWALIGN,
+    ENGINE_STRIPED,
+    ENGINE_LINEAR,
+    ENGINE_BATCH,
+    ENGINE_PACKED,
+    ENGINE_LINEAR_SPACE,
+    ENGINE_ALIGNER,
+    NUM_PAIR_ENGINE
+};
+static const char *pair_engine_names[NUM_PAIR_ENGINE] = {
+    "swalign", "swalign_striped", "swalign_linear", "swalign_batch",
+    "align_packed", "align_linear_space", "aligner_score"
+};
+
+enum
+{
+    ENGINE_POOL,
+    ENGINE_POOL_SYMMETRIC,
+    ENGINE_POOL_PARALLEL,
+    ENGINE_POOL_SPARSE,
+    ENGINE_POOL_SUMMARY,
+    ENGINE_POOL_PREFILTERED,
+    NUM_POOL_ENGINE
+};
+static const char *pool_engine_names[NUM_POOL_ENGINE] = {
+    "align_pool", "align_pool_symmetric", "align_pool_parallel",
+    "align_pool_sparse", "summarise_pool", "align_pool_prefiltered"
+};
+
+static void run_pair_engine(int engine, char **refs, char **queries,
+                            int num_pair, Score_Param score_param,
+                            float *scores);
+static long run_pool_engine(int engine, char **primers, int num_primer,
+                            Score_Param score_param, Dimer_Prefilter prefilter,
+                            FILE *null_file, Primer_Summary *summaries);
+static double count_pool_cells(char **primers, int num_primer);
+static double count_prefiltered_cells(char **primers, int num_primer,
+                                      Dimer_Prefilter prefilter);
+
+
+/* run_swinc_benchmarks:
+ * benchmark every engine, align_pool_prefiltered() with prefilter,
+ * report into outfile */
+void run_swinc_benchmarks(FILE *outfile, Dimer_Prefilter prefilter)
+{
+    Score_Param score_param = {DEFAULT_MATCH_SCORE, DEFAULT_MISMATCH_PENALTY,
+                               DEFAULT_GAP_OPEN_PENALTY,
+                               DEFAULT_GAP_EXTENSION_PENALTY};
+    Primer_Shape pool_shape = {18, 30, 0.5, 0.1};
+    Bench_Rng rng;
+    Bench_Json json;
+    Bench_Result result;
+    char **refs = allocate(sizeof(char *) * BENCH_NUM_PAIR);
+    char **queries = allocate(sizeof(char *) * BENCH_NUM_PAIR);
+    float *scores = allocate(sizeof(float) * BENCH_NUM_PAIR);
+    FILE *null_file = fopen("/dev/null", "w");
+    if (null_file == NULL)
+    {
+        fprintf(stderr, "%s error:\nCannot open /dev/null\n", PROGRAM_NAME);
+        exit(EXIT_FAILURE);
+    }
+    int i, k, engine, repeat;
+    double start;
+
+    seed_bench_rng(&rng, BENCH_SEED);
+    begin_bench_json(&json, outfile, PROGRAM_NAME);
+    for (i = 0; i < BENCH_NUM_LEN; i++)
+    {
+        int seq_len = BENCH_SEQ_LENS[i];
+        for (k = 0; k < BENCH_NUM_PAIR; k++)
+        {
+            refs[k] = allocate(seq_len +1);
+            queries[k] = allocate(seq_len +1);
+            make_bench_primer(&rng, seq_len, 0.5, refs[k]);
+            make_bench_primer(&rng, seq_len, 0.5, queries[k]);
+        }
+        for (engine = 0; engine < NUM_PAIR_ENGINE; engine++)
+        {
+            reset_peak_rss();
+            start = bench_seconds();
+            repeat = 0;
+            do
+            {
+                run_pair_engine(engine, refs, queries, BENCH_NUM_PAIR,
+                                score_param, scores);
+                repeat++;
+            } while (bench_seconds() - start < BENCH_MIN_SECONDS);
+            result = (Bench_Result) {pair_engine_names[engine], "pairs",
+                                     seq_len, 0,
+                                     (long) repeat * BENCH_NUM_PAIR,
+                                     (double) repeat * BENCH_NUM_PAIR * seq_len * seq_len,
+                                     bench_seconds() - start, 0};
+            add_bench_result(&json, result);
+        }
+        for (k = 0; k < BENCH_NUM_PAIR; k++)
+        {
+            free(refs[k]);
+            free(queries[k]);
+        }
+    }
+
+    Primer_Summary *summaries = allocate(sizeof(Primer_Summary) *
+                                         BENCH_POOL_SIZES[BENCH_NUM_POOL_SIZE -1]);
+    for (i = 0; i < BENCH_NUM_POOL_SIZE; i++)
+    {
+        int pool_size = BENCH_POOL_SIZES[i];
+        char **primers = make_bench_pool(&rng, pool_size, pool_shape);
+        double num_cell = count_pool_cells(primers, pool_size);
+        double num_prefiltered_cell = count_prefiltered_cells(primers, pool_size,
+                                                              prefilter);
+        long num_pool_pair = (long) pool_size * (pool_size -1);
+        long num_pruned;
+        for (k = 0; k < pool_size; k++)
+        {
+            strcpy(pool[k], primers[k]);
+        }
+        for (engine = 0; engine < NUM_POOL_ENGINE; engine++)
+        {
+            reset_peak_rss();
+            start = bench_seconds();
+            repeat = 0;
+            do
+            {
+                num_pruned = run_pool_engine(engine, primers, pool_size,
+                                             score_param, prefilter,
+                                             null_file, summaries);
+                repeat++;
+            } while (bench_seconds() - start < BENCH_MIN_SECONDS);
+            result = (Bench_Result) {pool_engine_names[engine], "pairs",
+                                     pool_shape.max_len, pool_size,
+                                     repeat * (num_pool_pair - num_pruned),
+                                     repeat * ((engine == ENGINE_POOL_PREFILTERED) ?
+                                               num_prefiltered_cell : num_cell),
+                                     bench_seconds() - start,
+                                     repeat * num_pruned};
+            add_bench_result(&json, result);
+        }
+        free_bench_pool(primers, pool_size);
+    }
+    end_bench_json(&json);
+
+    fclose(null_file);
+    free(summaries);
+    free(refs);
+    free(queries);
+    free(scores);
+}
+
+
+/* run_pair_engine: align queries[k] to refs[k] for all k once */
+static void run_pair_engine(int engine, char **refs, char **queries,
+                            int num_pair, Score_Param score_param,
+                            float *scores)
+{
+    SW_Alignment alignment;
+    int k;
+    if (engine == ENGINE_BATCH)
+    {
+        swalign_batch(refs, queries, num_pair, score_param, scores);
+        return;
+    }
+    if (engine == ENGINE_ALIGNER)
+    {// one query against every ref, its profile built once
+        SW_Aligner *aligner = create_aligner(score_param);
+        for (k = 0; k < num_pair; k++)
+        {
+            scores[k] = aligner_score(aligner, refs[k], queries[0]);
+        }
+        free_aligner(aligner);
+        return;
+    }
+    for (k = 0; k < num_pair; k++)
+    {
+        switch (engine)
+        {
+            case (ENGINE_SWALIGN):
+                scores[k] = swalign(refs[k], queries[k], score_param);
+                break;
+            case (ENGINE_STRIPED):
+#ifdef __SSE2__
+                scores[k] = swalign_striped(refs[k], queries[k], score_param);
+#else
+                scores[k] = swalign(refs[k], queries[k], score_param);
+#endif
+                break;
+            case (ENGINE_LINEAR):
+                scores[k] = swalign_linear(refs[k], queries[k], score_param).score;
+                break;
+            case (ENGINE_PACKED):
+                alignment = align_packed(refs[k], queries[k], score_param);
+                scores[k] = alignment.score;
+                free_alignment(&alignment);
+                break;
+            case (ENGINE_LINEAR_SPACE):
+                alignment = align_linear_space(refs[k], queries[k], score_param);
+                scores[k] = alignment.score;
+                free_alignment(&alignment);
+                break;
+        }
+    }
+}
+
+/* run_pool_engine:
+ * align the pool once, pool[] holds primers. Return the number of
+ * pairs left out unaligned (by align_pool_prefiltered() only) */
+static long run_pool_engine(int engine, char **primers, int num_primer,
+                            Score_Param score_param, Dimer_Prefilter prefilter,
+                            FILE *null_file, Primer_Summary *summaries)
+{
+    Pool_Schedule schedule = {0, 0, 0};
+    Sparse_Filter filter = {1, 1e9};
+    switch (engine)
+    {
+        case (ENGINE_POOL):
+            align_pool(num_primer, score_param);
+            break;
+        case (ENGINE_POOL_SYMMETRIC):
+            align_pool_symmetric(num_primer, score_param);
+            break;
+        case (ENGINE_POOL_PARALLEL):
+            align_pool_parallel(num_primer, score_param, schedule);
+            break;
+        case (ENGINE_POOL_SPARSE):
+            align_pool_sparse(primers, num_primer, score_param, filter, null_file);
+            break;
+        case (ENGINE_POOL_SUMMARY):
+            summarise_pool(primers, num_primer, score_param, 0, summaries);
+            break;
+        case (ENGINE_POOL_PREFILTERED):
+            return align_pool_prefiltered(num_primer, score_param, prefilter);
+    }
+    return 0;
+}
+
+/* count_pool_cells:
+ * the DP cells of a pool alignment, primer i against the
+ * reverse complement (KMER_SIZE bases at most) of j != i */
+static double count_pool_cells(char **primers, int num_primer)
+{
+    double ref_total = 0.0, query_total = 0.0, diagonal = 0.0;
+    int i, len, query_len;
+    for (i = 0; i < num_primer; i++)
+    {
+        len = strlen(primers[i]);
+        query_len = (len < KMER_SIZE) ? len : KMER_SIZE;
+        ref_total += len;
+        query_total += query_len;
+        diagonal += (double) len * query_len;
+    }
+    return ref_total * query_total - diagonal;
+}
+
+/* count_prefiltered_cells:
+ * the cells of count_pool_cells() in the pairs align_pool_prefiltered()
+ * aligns with prefilter: those that pass it, or with a primer too long
+ * to be packed */
+static double count_prefiltered_cells(char **primers, int num_primer,
+                                      Dimer_Prefilter prefilter)
+{
+    Packed_Seq *packed_refs = allocate(sizeof(Packed_Seq) * num_primer);
+    Packed_Seq *packed_queries = allocate(sizeof(Packed_Seq) * num_primer);
+    int *is_packed = allocate(sizeof(int) * num_primer * 2);
+    int *query_lens = allocate(sizeof(int) * num_primer);
+    double num_cell = 0.0;
+    char *query;
+    int i, j;
+    for (j = 0; j < num_primer; j++)
+    {
+        query = rev_complement(primers[j], KMER_SIZE);
+        query_lens[j] = strlen(query);
+        is_packed[j] = pack_sequence(primers[j], &packed_refs[j]);
+        is_packed[num_primer + j] = pack_sequence(query, &packed_queries[j]);
+        free(query);
+    }
+    for (i = 0; i < num_primer; i++)
+    {
+        for (j = 0; j < num_primer; j++)
+        {
+            if (j != i && (!is_packed[i] || !is_packed[num_primer + j] ||
+                           passes_prefilter(dimer_runs(&packed_refs[i],
+                                                       &packed_queries[j]),
+                                            prefilter)))
+            {
+                num_cell += (double) strlen(primers[i]) * query_lens[j];
+            }
+        }
+    }
+    free(packed_refs);
+    free(packed_queries);
+    free(is_packed);
+    free(query_lens);
+    return num_cell;
+}
@@ -0,0 +1,207 @@
+/************************** SWNN BENCHMARK ROUTINES ************************
+ * The benchmarks of the duplex engines, run by swnn -b:
+ *   - complete_duplex_matrix(), complete_duplex_matrix_soa(),
+ *     complete_duplex_matrix_arena() and score_duplex_arena() on
+ *     BENCH_NUM_DUPLEX random duplexes of each of BENCH_SEQ_LENS,
+ *   - a duplex screen of synthetic pools (every primer against every
+ *     other, in one arena) of the smaller BENCH_POOL_SIZES, with full
+ *     matrices, score-only, and pruned at BENCH_DUPLEX_THRESHOLD.
+ * Reported through add_bench_result(), see bench.h.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swnn.h"
+#include "bench.h"
+
+#define BENCH_NUM_DUPLEX 64
+#define BENCH_NUM_DUPLEX_POOL 2 // the screen is quadratic, skip the largest
+#define BENCH_DUPLEX_THRESHOLD -9000.0 // delG of a dimer worth reporting
+
+enum
+{
+    SCREEN_FULL,
+    SCREEN_SCORE,
+    SCREEN_PRUNED,
+    NUM_SCREEN
+};
+
+enum
+{
+    ENGINE_DUPLEX,
+    ENGINE_DUPLEX_SOA,
+    ENGINE_DUPLEX_ARENA,
+    ENGINE_DUPLEX_SCORE,
+    NUM_DUPLEX_ENGINE
+};
+static const char *duplex_engine_names[NUM_DUPLEX_ENGINE] = {
+    "complete_duplex_matrix", "complete_duplex_matrix_soa",
+    "complete_duplex_matrix_arena", "score_duplex_arena"
+};
+static const char *pool_screen_names[NUM_SCREEN] = {
+    "duplex_pool_screen", "duplex_pool_screen_score", "duplex_pool_screen_pruned"
+};
+
+static void run_duplex_engine(int engine, char **refs, char **queries,
+                              int num_duplex, Arena *arena);
+static int screen_pool(char **primers, int num_primer, Arena *arena,
+                       int screen, const Duplex_Bound *bound, float *delGs);
+
+
+/* run_swnn_benchmarks: benchmark the duplex engines, report into outfile */
+void run_swnn_benchmarks(FILE *outfile)
+{
+    Primer_Shape pool_shape = {18, 30, 0.5, 0.1};
+    Bench_Rng rng;
+    Bench_Json json;
+    Bench_Result result;
+    Arena *arena = create_arena(0);
+    char *refs[BENCH_NUM_DUPLEX];
+    char *queries[BENCH_NUM_DUPLEX];
+    int i, k, engine, repeat, screen, num_pruned;
+    double start, num_cell;
+
+    seed_bench_rng(&rng, BENCH_SEED);
+    begin_bench_json(&json, outfile, "swnn");
+    for (i = 0; i < BENCH_NUM_LEN; i++)
+    {
+        int seq_len = BENCH_SEQ_LENS[i];
+        for (k = 0; k < BENCH_NUM_DUPLEX; k++)
+        {
+            refs[k] = malloc(seq_len +1);
+            queries[k] = malloc(seq_len +1);
+            if (refs[k] == NULL || queries[k] == NULL)
+            {
+                fprintf(stderr, "swnn: memory allocation error");
+                exit(EXIT_FAILURE);
+            }
+            make_bench_primer(&rng, seq_len, 0.5, refs[k]);
+            make_bench_primer(&rng, seq_len, 0.5, queries[k]);
+        }
+        for (engine = 0; engine < NUM_DUPLEX_ENGINE; engine++)
+        {
+            reset_peak_rss();
+            start = bench_seconds();
+            repeat = 0;
+            do
+            {
+                run_duplex_engine(engine, refs, queries, BENCH_NUM_DUPLEX, arena);
+                repeat++;
+            } while (bench_seconds() - start < BENCH_MIN_SECONDS);
+            result = (Bench_Result) {duplex_engine_names[engine], "duplexes",
+                                     seq_len, 0,
+                                     (long) repeat * BENCH_NUM_DUPLEX,
+                                     (double) repeat * BENCH_NUM_DUPLEX * seq_len * seq_len,
+                                     bench_seconds() - start, 0};
+            add_bench_result(&json, result);
+        }
+        for (k = 0; k < BENCH_NUM_DUPLEX; k++)
+        {
+            free(refs[k]);
+            free(queries[k]);
+        }
+    }
+
+    for (i = 0; i < BENCH_NUM_POOL_SIZE && i < BENCH_NUM_DUPLEX_POOL; i++)
+    {
+        int pool_size = BENCH_POOL_SIZES[i];
+        char **primers = make_bench_pool(&rng, pool_size, pool_shape);
+        double len_total = 0.0, len_square = 0.0;
+        for (k = 0; k < pool_size; k++)
+        {
+            len_total += strlen(primers[k]);
+            len_square += (double) strlen(primers[k]) * strlen(primers[k]);
+        }
+        num_cell = len_total * len_total - len_square;
+        Duplex_Bound bound;
+        init_duplex_bound(&bound, BENCH_DUPLEX_THRESHOLD, pool_shape.max_len);
+        float *delGs = malloc(sizeof(float) * pool_size * pool_size);
+        if (delGs == NULL)
+        {
+            fprintf(stderr, "swnn: memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        for (screen = 0; screen < NUM_SCREEN; screen++)
+        {
+            reset_peak_rss();
+            start = bench_seconds();
+            repeat = 0;
+            do
+            {
+                num_pruned = screen_pool(primers, pool_size, arena, screen,
+                                         &bound, delGs);
+                repeat++;
+            } while (bench_seconds() - start < BENCH_MIN_SECONDS);
+            result = (Bench_Result) {pool_screen_names[screen], "duplexes",
+                                     pool_shape.max_len, pool_size,
+                                     (long) repeat * pool_size * (pool_size -1),
+                                     repeat * num_cell,
+                                     bench_seconds() - start,
+                                     (long) repeat * num_pruned};
+            add_bench_result(&json, result);
+        }
+        free(delGs);
+        free_bench_pool(primers, pool_size);
+    }
+    end_bench_json(&json);
+    free_arena(arena);
+}
+
+
+/* run_duplex_engine: the duplex of refs[k] and queries[k] for all k once */
+static void run_duplex_engine(int engine, char **refs, char **queries,
+                              int num_duplex, Arena *arena)
+{
+    int k;
+    for (k = 0; k < num_duplex; k++)
+    {
+        switch (engine)
+        {
+            case (ENGINE_DUPLEX):
+                free(complete_duplex_matrix(refs[k], queries[k], NULL));
+                break;
+            case (ENGINE_DUPLEX_SOA):
+                free_duplex_matrix(complete_duplex_matrix_soa(refs[k], queries[k]));
+                break;
+            case (ENGINE_DUPLEX_ARENA):
+                complete_duplex_matrix_arena(refs[k], queries[k], arena);
+                arena_reset(arena);
+                break;
+            case (ENGINE_DUPLEX_SCORE):
+                score_duplex_arena(refs[k], queries[k], arena);
+                arena_reset(arena);
+                break;
+        }
+    }
+}
+
+/* screen_pool:
+ * the duplex of every primer with every other, as screen says:
+ * full matrices, only the lowest delG, or pruned by bound into delGs.
+ * Returns the number of pairs pruned. */
+static int screen_pool(char **primers, int num_primer, Arena *arena,
+                       int screen, const Duplex_Bound *bound, float *delGs)
+{
+    int i, j;
+    if (screen == SCREEN_PRUNED)
+    {
+        return screen_duplex_pool(primers, num_primer, bound, arena, delGs);
+    }
+    for (i = 0; i < num_primer; i++)
+    {
+        for (j = 0; j < num_primer; j++)
+        {
+            if (j != i && screen == SCREEN_SCORE)
+            {
+                score_duplex_arena(primers[i], primers[j], arena);
+                arena_reset(arena);
+            } else if (j != i)
+            {
+                complete_duplex_matrix_arena(primers[i], primers[j], arena);
+                arena_reset(arena);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/************************** DISPATCH ROUTINES ******************************
+ * The swinc kernels bound to the instruction set level of the host
+ * (or the one forced through SIMD_LEVEL_ENV, see simd.h):
+ *
+ *   level    swalign()              swalign_batch_arena()    screen_dimers()
+ *   scalar   swalign_linear()       swalign_batch_scalar()   screen_dimers_scalar()
+ *   sse2     swalign_striped()      swalign_batch_sse()      screen_dimers_scalar()
+ *   avx2     swalign_striped()      swalign_batch_avx2()     screen_dimers_avx2()
+ *   avx512   swalign_striped()      swalign_batch_avx512()   screen_dimers_avx512()
+ *
+ * The striped kernel has 128 bit vectors only: a query as short as a
+ * primer doesn't fill more lanes. Every kernel gives the scores of
+ * fill_matrix(), which stays the reference, and every screen the
+ * passes_prefilter() of dimer_runs().
+ * The table is bound once, under pthread_once(); main() binds it
+ * before any thread is started.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "swinc.h"
+
+static Swinc_Kernels kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void bind_kernels(void);
+static float swalign_linear_score(char *ref, char *query, Score_Param score_param);
+
+
+/* swinc_kernels: the kernels of simd_level(), bound on first use */
+const Swinc_Kernels *swinc_kernels(void)
+{
+    pthread_once(&kernels_once, bind_kernels);
+    return &kernels;
+}
+
+
+static void bind_kernels(void)
+{
+    int level = simd_level();
+    kernels = (Swinc_Kernels) {SIMD_SCALAR, 1, swalign_linear_score,
+                               swalign_batch_scalar, screen_dimers_scalar};
+#ifdef __SSE2__
+    if (level >= SIMD_SSE2)
+    {
+        kernels = (Swinc_Kernels) {SIMD_SSE2, BATCH_LANES, swalign_striped,
+                                   swalign_batch_sse, screen_dimers_scalar};
+    }
+#endif
+#ifdef SIMD_WIDE_KERNELS
+    if (level >= SIMD_AVX2)
+    {
+        kernels.level = SIMD_AVX2;
+        kernels.batch_lanes = BATCH_LANES_AVX2;
+        kernels.swalign_batch = swalign_batch_avx2;
+        kernels.screen_dimers = screen_dimers_avx2;
+    }
+    if (level >= SIMD_AVX512)
+    {
+        kernels.level = SIMD_AVX512;
+        kernels.batch_lanes = BATCH_LANES_AVX512;
+        kernels.swalign_batch = swalign_batch_avx512;
+        kernels.screen_dimers = screen_dimers_avx512;
+    }
+#endif
+}
+
+static float swalign_linear_score(char *ref, char *query, Score_Param score_param)
+{
+    return swalign_linear(ref, query, score_param).score;
+}
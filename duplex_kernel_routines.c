@@ -0,0 +1,257 @@
+/************************ DUPLEX KERNEL ROUTINES ****************************
+ * The duplex DP with all 4 records of an entry made in one pass (a
+ * fused kernel), instead of one score_*() routine per record.
+ *
+ * compute_entry() copies the diagonal entry twice and the left and
+ * upper ones once each, makes 2 or 3 candidate records per decision
+ * in arrays for best_record(), and every nn delG goes through
+ * thermo_context(). Here the records an entry depends on:
+ *   bind and stop         <- bind, top_bulge, bottom_bulge of [row-1][col-1]
+ *   top_bulge             <- bind, bottom_bulge of [row][col-1]
+ *   bottom_bulge          <- bind, bottom_bulge of [row-1][col]
+ * are read in place: the left entry is the one just made, the diagonal
+ * and upper ones are the previous row, so 2 rows of entries are all a
+ * rolling buffer has to hold. Each
+ * candidate is compared as soon as it is made, the nn delG is a load
+ * from the table of the context (fetched once per fill), and the loop
+ * scores that don't depend on the records are computed once too
+ * (Duplex_Constants).
+ *
+ * The cases, the order of the additions and the tie breaks (the first
+ * of equal candidates is kept) are those of the *_continuation()
+ * routines of scoring_routines.c, which remain the reference: the
+ * records are identical.
+ *
+ * The lowest record of the matrix is kept as the entries are made
+ * (keep_lowest_record()), so that nothing searches the matrix after
+ * the fill.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "swnn.h"
+
+/* the delG of the internal nn record of the 4 codes */
+#define DELG_INTERNAL(constants, top5, top3, bottom3, bottom5) \
+    ((constants)->delG_internal[NN_CODE_INDEX(top5, top3, bottom3, bottom5)])
+
+static void fuse_entry(const Duplex_Constants *constants,
+                       unsigned char *ref, unsigned char *query,
+                       int row, int col, const SW_Entry *diag,
+                       const SW_Entry *up, const Decision_Record *left_bind,
+                       const Decision_Record *left_bulge, SW_Entry *entry);
+
+
+/* init_duplex_constants:
+ * what the fused kernel looks up, under the thermo context
+ * of the calling thread. */
+void init_duplex_constants(Duplex_Constants *constants)
+{
+    constants->delG_internal = thermo_context()->delG_internal;
+    constants->bulge_one = bulge_score(1);
+    constants->top_bulge_two = internal_loop_score(2, 0);
+    constants->bottom_bulge_two = internal_loop_score(0, 2);
+}
+
+/* fuse_duplex_row:
+ * fill entries[1, ncol) of row given the entries of row -1 in up_row,
+ * entries[0] holding the first column of row. Both rows may be the
+ * rows of an sw_matrix or a rolling buffer. If lowest isn't NULL,
+ * the entries made are kept in it by keep_lowest_record(). */
+void fuse_duplex_row(const Duplex_Constants *constants,
+                     unsigned char *ref, unsigned char *query,
+                     int row, int ncol, const SW_Entry *up_row,
+                     SW_Entry *entries, Duplex_Hit *lowest)
+{
+    register int col;
+    for (col = 1; col < ncol; col++)
+    {
+        // !! as in score_top_bulge(), the bulge record read is bottom_bulge
+        fuse_entry(constants, ref, query, row, col, &up_row[col -1], &up_row[col],
+                   &entries[col -1].bind, &entries[col -1].bottom_bulge,
+                   &entries[col]);
+        if (lowest != NULL)
+        {
+            keep_lowest_record(&entries[col], row, col, lowest);
+        }
+    }
+}
+
+/* keep_lowest_record:
+ * lowest becomes the bind, top_bulge or bottom_bulge record of
+ * entry (row, col) if lower, the first of equal ones is kept.
+ * Given the entries in row major order, that is the record
+ * find_best_entry_coord() picks: the stop record is one of the
+ * diagonal entry's, already seen, so it is never strictly lower. */
+void keep_lowest_record(const SW_Entry *entry, int row, int col,
+                        Duplex_Hit *lowest)
+{
+    if (entry->bind.delG < lowest->delG)
+    {
+        *lowest = (Duplex_Hit) {entry->bind.delG,
+                                {row, col, entry->bind.current_decision}};
+    }
+    if (entry->top_bulge.delG < lowest->delG)
+    {
+        *lowest = (Duplex_Hit) {entry->top_bulge.delG,
+                                {row, col, entry->top_bulge.current_decision}};
+    }
+    if (entry->bottom_bulge.delG < lowest->delG)
+    {
+        *lowest = (Duplex_Hit) {entry->bottom_bulge.delG,
+                                {row, col, entry->bottom_bulge.current_decision}};
+    }
+}
+
+
+/* fuse_entry:
+ * the 4 records of entry (row, col) from its diagonal, upper
+ * and left neighbours, see bind_continuation(),
+ * stop_continuation(), top_bulge_continuation() and
+ * bottom_bulge_continuation() for the cases. */
+static void fuse_entry(const Duplex_Constants *constants,
+                       unsigned char *ref, unsigned char *query,
+                       int row, int col, const SW_Entry *diag,
+                       const SW_Entry *up, const Decision_Record *left_bind,
+                       const Decision_Record *left_bulge, SW_Entry *entry)
+{
+    const Decision_Record *prev;
+    Decision_Record best, candidate;
+    char current_decision = (IS_COMPLEMENT(query[row], ref[col])) ? MATCH : MISMATCH;
+
+    // bind, from the diagonal bind
+    prev = &diag->bind;
+    best = (Decision_Record) {0, MATCH, current_decision, 0, 0};
+    if (prev->current_decision == MATCH)
+    {
+        best.delG = prev->delG + DELG_INTERNAL(constants, ref[col -1], ref[col],
+                                               query[row -1], query[row]);
+        best.top_loop_len = best.bottom_loop_len = (current_decision == MATCH) ? 0 : 1;
+    } else if (prev->current_decision == MISMATCH)
+    {
+        if (current_decision == MISMATCH)
+        {
+            best.previous_decision = MISMATCH;
+            best.top_loop_len = prev->top_loop_len +1;
+            best.bottom_loop_len = prev->bottom_loop_len +1;
+            best.delG = prev->delG + internal_loop_score(best.top_loop_len,
+                                                         best.bottom_loop_len);
+        } else if (prev->top_loop_len == 1 && prev->bottom_loop_len == 1)
+        {
+            best.previous_decision = MISMATCH;
+            best.delG = prev->delG + DELG_INTERNAL(constants, ref[col -1], ref[col],
+                                                   query[row -1], query[row]);
+        } else if (prev->top_loop_len > 1 || prev->bottom_loop_len > 1)
+        {
+            best.previous_decision = MISMATCH;
+            best.delG = prev->delG;
+        }
+    } else
+    {
+        fprintf(stderr, "Neither MATCH nor MISMATCH at bind record");
+        exit(EXIT_FAILURE);
+    }
+    // from the diagonal top_bulge then bottom_bulge
+    prev = &diag->top_bulge;
+    candidate = (Decision_Record) {prev->delG, TOP_BULGE, current_decision, 0, 0};
+    if (current_decision == MISMATCH)
+    {
+        candidate.top_loop_len = prev->top_loop_len +1;
+        candidate.bottom_loop_len = prev->bottom_loop_len +1;
+        candidate.delG = prev->delG + internal_loop_score(candidate.top_loop_len,
+                                                          candidate.bottom_loop_len);
+    }
+    best = (candidate.delG < best.delG) ? candidate : best;
+    prev = &diag->bottom_bulge;
+    candidate = (Decision_Record) {prev->delG, BOTTOM_BULGE, current_decision, 0, 0};
+    if (current_decision == MISMATCH)
+    {
+        candidate.top_loop_len = prev->top_loop_len +1;
+        candidate.bottom_loop_len = prev->bottom_loop_len +1;
+        candidate.delG = prev->delG + internal_loop_score(candidate.top_loop_len,
+                                                          candidate.bottom_loop_len);
+    }
+    entry->bind = (candidate.delG < best.delG) ? candidate : best;
+
+    // stop, from the diagonal records as they are
+    best = (Decision_Record) {diag->bind.delG, diag->bind.current_decision, STOP, 0, 0};
+    if (diag->top_bulge.delG < best.delG)
+    {
+        best = (Decision_Record) {diag->top_bulge.delG, TOP_BULGE, STOP, 0, 0};
+    }
+    if (diag->bottom_bulge.delG < best.delG)
+    {
+        best = (Decision_Record) {diag->bottom_bulge.delG, BOTTOM_BULGE, STOP, 0, 0};
+    }
+    entry->stop = best;
+
+    // top_bulge, from the left bind then the left bulge
+    prev = left_bind;
+    best = (Decision_Record) {0, MATCH, TOP_BULGE, 0, 0};
+    if (prev->current_decision == MATCH)
+    {
+        best.top_loop_len = 1;
+        best.delG = prev->delG + constants->bulge_one +
+                    DELG_INTERNAL(constants, ref[col -1], ref[col +1],
+                                  query[row], query[row +1]);
+    } else if (prev->current_decision == MISMATCH)
+    {
+        best.previous_decision = MISMATCH;
+        best.top_loop_len = prev->top_loop_len +1;
+        best.bottom_loop_len = prev->bottom_loop_len;
+        best.delG = prev->delG + internal_loop_score(best.top_loop_len,
+                                                     best.bottom_loop_len);
+    }
+    prev = left_bulge;
+    candidate = (Decision_Record) {0, TOP_BULGE, TOP_BULGE, 0, 0};
+    if (prev->bottom_loop_len == 1 && prev->top_loop_len == 0)
+    {
+        candidate.top_loop_len = 2;
+        candidate.delG = prev->delG -
+                         DELG_INTERNAL(constants, ref[col -2], ref[col],
+                                       query[row], query[row +1]) +
+                         constants->top_bulge_two;
+    } else if (prev->top_loop_len > 1 || prev->bottom_loop_len > 0)
+    {
+        candidate.top_loop_len = prev->top_loop_len +1;
+        candidate.bottom_loop_len = prev->bottom_loop_len;
+        candidate.delG = prev->delG + internal_loop_score(candidate.top_loop_len,
+                                                          candidate.bottom_loop_len);
+    }
+    entry->top_bulge = (candidate.delG < best.delG) ? candidate : best;
+
+    // bottom_bulge, from the upper bind then the upper bottom_bulge
+    prev = &up->bind;
+    best = (Decision_Record) {0, MATCH, BOTTOM_BULGE, 0, 0};
+    if (prev->current_decision == MATCH)
+    {
+        best.bottom_loop_len = 1;
+        best.delG = prev->delG + constants->bulge_one +
+                    DELG_INTERNAL(constants, ref[col], ref[col +1],
+                                  query[row -1], query[row +1]);
+    } else if (prev->current_decision == MISMATCH)
+    {
+        best.previous_decision = MISMATCH;
+        best.bottom_loop_len = prev->bottom_loop_len +1;
+        best.top_loop_len = prev->top_loop_len;
+        best.delG = prev->delG + internal_loop_score(best.top_loop_len,
+                                                     best.bottom_loop_len);
+    }
+    prev = &up->bottom_bulge;
+    candidate = (Decision_Record) {0, BOTTOM_BULGE, BOTTOM_BULGE, 0, 0};
+    if (prev->bottom_loop_len == 1 && prev->top_loop_len == 0)
+    {
+        candidate.bottom_loop_len = 2;
+        candidate.delG = prev->delG -
+                         DELG_INTERNAL(constants, ref[col], ref[col +1],
+                                       query[row -2], query[row]) +
+                         constants->bottom_bulge_two;
+    } else if (prev->bottom_loop_len > 1 || prev->top_loop_len > 0)
+    {
+        candidate.bottom_loop_len = prev->bottom_loop_len +1;
+        candidate.top_loop_len = prev->top_loop_len;
+        candidate.delG = prev->delG + internal_loop_score(candidate.top_loop_len,
+                                                          candidate.bottom_loop_len);
+    }
+    entry->bottom_bulge = (candidate.delG < best.delG) ? candidate : best;
+}
@@ -0,0 +1,357 @@
+/************************ DUPLEX MATRIX ROUTINES ****************************
+ * The sw_matrix of the duplex DP in a structure of arrays layout
+ * (see Duplex_Matrix in swnn.h).
+ *
+ * An SW_Entry is 4 Decision_Records of a float, 2 chars and 2 ints,
+ * and the scoring routines copy a whole entry for every neighbour
+ * although each of them reads only 2 or 3 of its records. Here each
+ * field has its own array, a record takes 7 bytes instead of 16, and
+ * the fill loads only the records the continuations depend on:
+ *   bind and stop         <- bind, top_bulge, bottom_bulge of [row-1][col-1]
+ *   top_bulge             <- bind, bottom_bulge of [row][col-1]
+ *   bottom_bulge          <- bind, bottom_bulge of [row-1][col]
+ * The scoring itself is the one of compute_entry(), made by the fused
+ * kernel of duplex_kernel_routines.c on rows of entries that are then
+ * scattered into the arrays; the fill never gathers a record back.
+ * The lowest record of the matrix is kept by the fill (lowest).
+ * The fill is called through duplex_kernels(), bound once.
+ * Sequences longer than MAX_DUPLEX_MATRIX_LEN are refused, their
+ * loop lengths wouldn't fit in a byte (score_duplex() has no limit).
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "swnn.h"
+
+static const char decision_of_code[] = {MATCH, MISMATCH, TOP_BULGE,
+                                        BOTTOM_BULGE, STOP};
+static unsigned char code_of_decision(char decision);
+static void set_duplex_entry(Duplex_Matrix *matrix, int row, int col,
+                             SW_Entry entry);
+static SW_Entry get_duplex_entry(Duplex_Matrix *matrix, int row, int col);
+static void store_duplex_row(Duplex_Matrix *matrix, int row, SW_Entry *entries);
+static void check_duplex_size(int nrow, int ncol);
+static void layout_duplex_matrix(Duplex_Matrix *matrix, int nrow, int ncol,
+                                 float *delG_block, unsigned char *byte_block);
+static void fill_duplex_matrix(Duplex_Matrix *matrix,
+                               unsigned char *ref, unsigned char *query);
+static void bind_duplex_kernels(void);
+
+static Duplex_Kernels kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+
+/* allocate_duplex_matrix:
+ * one block holds all the arrays, field by field and
+ * decision by decision. */
+Duplex_Matrix *allocate_duplex_matrix(int nrow, int ncol)
+{
+    check_duplex_size(nrow, ncol);
+    size_t num_entry = (size_t) nrow * ncol;
+    Duplex_Matrix *matrix = malloc(sizeof(Duplex_Matrix));
+    float *delG_block = malloc(sizeof(float) * num_entry * NUM_DECISION);
+    unsigned char *byte_block = malloc(num_entry * NUM_DECISION * 3);
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 3);
+    if (matrix == NULL || delG_block == NULL || byte_block == NULL)
+    {
+        fprintf(stderr, "swnn: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    layout_duplex_matrix(matrix, nrow, ncol, delG_block, byte_block);
+    return matrix;
+}
+
+/* arena_duplex_matrix:
+ * allocate_duplex_matrix() from arena, the matrix lives
+ * until the arena is reset (no free_duplex_matrix()). */
+Duplex_Matrix *arena_duplex_matrix(Arena *arena, int nrow, int ncol)
+{
+    check_duplex_size(nrow, ncol);
+    size_t num_entry = (size_t) nrow * ncol;
+    Duplex_Matrix *matrix = arena_alloc(arena, sizeof(Duplex_Matrix));
+    float *delG_block = arena_alloc(arena, sizeof(float) * num_entry * NUM_DECISION);
+    unsigned char *byte_block = arena_alloc(arena, num_entry * NUM_DECISION * 3);
+    layout_duplex_matrix(matrix, nrow, ncol, delG_block, byte_block);
+    return matrix;
+}
+
+void free_duplex_matrix(Duplex_Matrix *matrix)
+{
+    free(matrix->delG[0]);
+    free(matrix->top_loop_len[0]);
+    free(matrix);
+}
+
+
+/* get_duplex_record: gather one record from the arrays */
+Decision_Record get_duplex_record(Duplex_Matrix *matrix,
+                                  int row, int col, int decision)
+{
+    size_t index = (size_t) row * matrix->ncol + col;
+    unsigned char codes = matrix->decisions[decision][index];
+    Decision_Record record = {
+        matrix->delG[decision][index],
+        decision_of_code[codes >> DECISION_CODE_BITS],
+        decision_of_code[codes & ((1 << DECISION_CODE_BITS) -1)],
+        matrix->top_loop_len[decision][index],
+        matrix->bottom_loop_len[decision][index]
+    };
+    return record;
+}
+
+/* set_duplex_record: scatter one record into the arrays */
+void set_duplex_record(Duplex_Matrix *matrix,
+                       int row, int col, int decision,
+                       Decision_Record record)
+{
+    size_t index = (size_t) row * matrix->ncol + col;
+    matrix->delG[decision][index] = record.delG;
+    matrix->top_loop_len[decision][index] = record.top_loop_len;
+    matrix->bottom_loop_len[decision][index] = record.bottom_loop_len;
+    matrix->decisions[decision][index] =
+        (code_of_decision(record.previous_decision) << DECISION_CODE_BITS) |
+        code_of_decision(record.current_decision);
+}
+
+
+/* complete_duplex_matrix_soa:
+ * complete_duplex_matrix() with the matrix in the structure of
+ * arrays layout. Reference is on the horizontal, query on the vertical.
+ * Both are encoded once before the fill. */
+Duplex_Matrix *complete_duplex_matrix_soa(char *ref_seq, char *query_seq)
+{
+    Duplex_Matrix *matrix = allocate_duplex_matrix(strlen(query_seq),
+                                                   strlen(ref_seq));
+    unsigned char *ref = encode_sequence(ref_seq);
+    unsigned char *query = encode_sequence(query_seq);
+    duplex_kernels()->fill(matrix, ref, query);
+    free(ref);
+    free(query);
+    return matrix;
+}
+
+/* complete_duplex_matrix_arena:
+ * complete_duplex_matrix_soa() with the matrix and the encoded
+ * sequences allocated from arena. The matrix lives until the
+ * arena is reset; screening many duplexes with one arena reset
+ * in between doesn't go to the heap once the longest is seen. */
+Duplex_Matrix *complete_duplex_matrix_arena(char *ref_seq, char *query_seq,
+                                            Arena *arena)
+{
+    Duplex_Matrix *matrix = arena_duplex_matrix(arena, strlen(query_seq),
+                                                strlen(ref_seq));
+    duplex_kernels()->fill(matrix, arena_encode_sequence(arena, ref_seq),
+                           arena_encode_sequence(arena, query_seq));
+    return matrix;
+}
+
+/* fill_duplex_matrix: the DP of complete_duplex_matrix_soa() */
+static void fill_duplex_matrix(Duplex_Matrix *matrix,
+                               unsigned char *ref, unsigned char *query)
+{
+    INSTRUMENT_START(fill_timer);
+    int nrow = matrix->nrow;
+    int ncol = matrix->ncol;
+    register int row, col;
+
+    // first row and column, considerate of dangling ends
+    set_duplex_entry(matrix, 0, 0, _handle_first_entry(ref[0], query[0]));
+    for (col = 1; col < ncol; col++)
+    {
+        Neighbour nn_config = {ref[col -1], ref[col], CODE_DOT, query[0]};
+        set_duplex_entry(matrix, 0, col, _handle_init_row_col(nn_config));
+    }
+    for (row = 1; row < nrow; row++)
+    {
+        Neighbour nn_config = {CODE_DOT, ref[0], query[row -1], query[row]};
+        set_duplex_entry(matrix, row, 0, _handle_init_row_col(nn_config));
+    }
+
+    // the fused kernel works on a rolling buffer of the previous row
+    // and the row being filled, the arrays are only written to.
+    SW_Entry rows[2][ncol];
+    SW_Entry *up_row = rows[0];
+    SW_Entry *entries = rows[1];
+    SW_Entry *temp;
+    Duplex_Constants constants;
+    Duplex_Hit lowest = {0.0, {0, 0, STOP}};
+    init_duplex_constants(&constants);
+    for (col = 0; col < ncol; col++)
+    {
+        up_row[col] = get_duplex_entry(matrix, 0, col);
+        keep_lowest_record(&up_row[col], 0, col, &lowest);
+    }
+    for (row = 1; row < nrow; row++)
+    {
+        entries[0] = get_duplex_entry(matrix, row, 0);
+        keep_lowest_record(&entries[0], row, 0, &lowest);
+        fuse_duplex_row(&constants, ref, query, row, ncol, up_row, entries, &lowest);
+        store_duplex_row(matrix, row, entries);
+        temp = up_row; up_row = entries; entries = temp;
+    }
+    matrix->lowest = lowest;
+    INSTRUMENT_ALIGNMENT(fill_timer, 1, (long long) nrow * ncol);
+}
+
+
+/* duplex_kernels: the duplex kernel of simd_level(), bound on first use */
+const Duplex_Kernels *duplex_kernels(void)
+{
+    pthread_once(&kernels_once, bind_duplex_kernels);
+    return &kernels;
+}
+
+static void bind_duplex_kernels(void)
+{
+    kernels = (Duplex_Kernels) {simd_level(), fill_duplex_matrix};
+}
+
+
+/* complete_duplex_matrix_at:
+ * complete_duplex_matrix_soa() under the reaction condition of
+ * context, whatever the calling thread had set before. */
+Duplex_Matrix *complete_duplex_matrix_at(char *ref, char *query,
+                                         const Thermo_Context *context)
+{
+    const Thermo_Context *previous_context = GLOBAL_thermo_context;
+    set_thermo_context(context);
+    Duplex_Matrix *matrix = complete_duplex_matrix_soa(ref, query);
+    set_thermo_context(previous_context);
+    return matrix;
+}
+
+
+/* find_best_duplex_coord:
+ * find_best_decision() on a Duplex_Matrix. Only the delG and
+ * decision arrays of the last row and column are read. */
+Coord find_best_duplex_coord(Duplex_Matrix *matrix)
+{
+    int nrow = matrix->nrow;
+    int ncol = matrix->ncol;
+    Coord best_coord = {0, 0, STOP};
+    float lowest_delG = 0.0;
+    register int row, col;
+    int decision;
+    size_t index;
+    // the last column, then the last row: favour the bottom right entries
+    for (col = ncol -1, row = 0; row < nrow -1; row++)
+    {
+        index = (size_t) row * ncol + col;
+        for (decision = DECISION_BIND; decision <= DECISION_BOTTOM_BULGE; decision++)
+        {
+            if (matrix->delG[decision][index] < lowest_delG)
+            {
+                lowest_delG = matrix->delG[decision][index];
+                best_coord = (Coord) {row, col,
+                    decision_of_code[matrix->decisions[decision][index] &
+                                     ((1 << DECISION_CODE_BITS) -1)]};
+            }
+        }
+    }
+    for (col = 0, row = nrow -1; col < ncol; col++)
+    {
+        index = (size_t) row * ncol + col;
+        for (decision = DECISION_BIND; decision <= DECISION_BOTTOM_BULGE; decision++)
+        {
+            if (matrix->delG[decision][index] < lowest_delG)
+            {
+                lowest_delG = matrix->delG[decision][index];
+                best_coord = (Coord) {row, col,
+                    decision_of_code[matrix->decisions[decision][index] &
+                                     ((1 << DECISION_CODE_BITS) -1)]};
+            }
+        }
+    }
+    return best_coord;
+}
+
+
+
+/* set_duplex_entry: scatter all 4 records of an entry, the
+ * stop record of the first row and column is a null record. */
+static void set_duplex_entry(Duplex_Matrix *matrix, int row, int col,
+                             SW_Entry entry)
+{
+    Decision_Record null_stop = {0.0, STOP, STOP, 0, 0};
+    set_duplex_record(matrix, row, col, DECISION_BIND, entry.bind);
+    set_duplex_record(matrix, row, col, DECISION_TOP_BULGE, entry.top_bulge);
+    set_duplex_record(matrix, row, col, DECISION_BOTTOM_BULGE, entry.bottom_bulge);
+    set_duplex_record(matrix, row, col, DECISION_STOP, null_stop);
+}
+
+/* get_duplex_entry: gather all 4 records of an entry */
+static SW_Entry get_duplex_entry(Duplex_Matrix *matrix, int row, int col)
+{
+    SW_Entry entry;
+    entry.bind = get_duplex_record(matrix, row, col, DECISION_BIND);
+    entry.top_bulge = get_duplex_record(matrix, row, col, DECISION_TOP_BULGE);
+    entry.bottom_bulge = get_duplex_record(matrix, row, col, DECISION_BOTTOM_BULGE);
+    entry.stop = get_duplex_record(matrix, row, col, DECISION_STOP);
+    return entry;
+}
+
+/* store_duplex_row: scatter the entries of row from col 1 on */
+static void store_duplex_row(Duplex_Matrix *matrix, int row, SW_Entry *entries)
+{
+    register int col;
+    for (col = 1; col < matrix->ncol; col++)
+    {
+        set_duplex_record(matrix, row, col, DECISION_BIND, entries[col].bind);
+        set_duplex_record(matrix, row, col, DECISION_TOP_BULGE, entries[col].top_bulge);
+        set_duplex_record(matrix, row, col, DECISION_BOTTOM_BULGE, entries[col].bottom_bulge);
+        set_duplex_record(matrix, row, col, DECISION_STOP, entries[col].stop);
+    }
+}
+
+/* check_duplex_size:
+ * a loop length is at most the length of its strand, it has to
+ * fit in the byte of the arrays. */
+static void check_duplex_size(int nrow, int ncol)
+{
+    if (nrow > MAX_DUPLEX_MATRIX_LEN || ncol > MAX_DUPLEX_MATRIX_LEN)
+    {
+        fprintf(stderr, "swnn: duplex of %d x %d bases, a Duplex_Matrix "
+                "takes sequences of at most %d bases\n",
+                ncol, nrow, MAX_DUPLEX_MATRIX_LEN);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static unsigned char code_of_decision(char decision)
+{
+    switch (decision)
+    {
+        case (MATCH):
+            return 0;
+        case (MISMATCH):
+            return 1;
+        case (TOP_BULGE):
+            return 2;
+        case (BOTTOM_BULGE):
+            return 3;
+        default:
+            return 4;
+    }
+}
+
+/* layout_duplex_matrix:
+ * point the arrays of matrix into its 2 blocks, see
+ * allocate_duplex_matrix() */
+static void layout_duplex_matrix(Duplex_Matrix *matrix, int nrow, int ncol,
+                                 float *delG_block, unsigned char *byte_block)
+{
+    size_t num_entry = (size_t) nrow * ncol;
+    matrix->nrow = nrow;
+    matrix->ncol = ncol;
+    matrix->lowest = (Duplex_Hit) {0.0, {0, 0, STOP}};
+    int decision;
+    for (decision = 0; decision < NUM_DECISION; decision++)
+    {
+        matrix->delG[decision] = delG_block + decision * num_entry;
+        matrix->top_loop_len[decision] = byte_block + decision * num_entry;
+        matrix->bottom_loop_len[decision] = byte_block + (NUM_DECISION + decision) * num_entry;
+        matrix->decisions[decision] = byte_block + (2 * NUM_DECISION + decision) * num_entry;
+    }
+}
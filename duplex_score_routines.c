@@ -0,0 +1,401 @@
+/************************ LINEAR MEMORY DUPLEX ROUTINES *********************
+ * Score-only duplex DP that keeps 2 rolling rows of entries instead of
+ * the whole sw_matrix, for screens that only need the lowest delG of
+ * each duplex (primer dimers of a pool).
+ *
+ * find_best_decision() looks at the last column, top down, then at the
+ * last row, left to right. The rows are made in that order, so the
+ * best record is kept as they are: the last entry of every row but the
+ * last, then the whole last row. The rows are filled by the fused
+ * kernel (duplex_kernel_routines.c).
+ *
+ * Memory is O(ref_len), the floors of pruning are O(ref_len * query_len).
+ * The delG and end coordinate are the ones of
+ * find_best_decision() on complete_duplex_matrix().
+ *
+ * Pruning (prune_duplex_arena(), screen_duplex_pool()):
+ * a record is a record of the diagonal, left or upper entry plus one
+ * step: an nn delG of the codes there (with bulge_score(1)), a loop
+ * score, nothing, or a 2 long bulge less an nn delG; which steps a
+ * record can take depends on its kind, not on its delG. Or it starts
+ * over from 0 or from a first column entry. Before the fill, the
+ * lowest the steps from each kind of record of each entry on can add
+ * is made from the last entry up, from the codes of both sequences
+ * (make_entry_floors()). After a row:
+ *   records to come >= a record of the row + its floor
+ *   records started over >= 0 or the lowest first column entry
+ *                           + the lowest floor of the rows after
+ * When all of these, and the lowest record kept so far, are above the
+ * threshold, the duplex can't go below it and the fill stops there.
+ * The bound holds whatever the loop scores: the loop model is sampled
+ * over all the loop lengths the sequences allow.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "swnn.h"
+
+/* how low the records to come can go below a record of an entry,
+ * by kind of record */
+typedef struct
+{
+    float bind_match;
+    float bind_mismatch;
+    float top_bulge;
+    float bottom_bulge_one;     // of a bind: bottom_loop_len 1, top_loop_len 0
+    float bottom_bulge;         // any other
+} Entry_Floor;
+
+static int score_duplex_codes(unsigned char *ref, unsigned char *query,
+                              int nrow, int ncol, SW_Entry *rows,
+                              const Duplex_Bound *bound, Entry_Floor *floors,
+                              Duplex_Hit *best_hit);
+static int make_entry_floors(const Duplex_Bound *bound, unsigned char *ref,
+                             unsigned char *query, int nrow, int ncol,
+                             Entry_Floor *floors, float *restarts);
+static int cannot_cross(const Duplex_Bound *bound, const SW_Entry *entries,
+                        int ncol, const Entry_Floor *floors, float restart);
+static float min_of(float first, float second);
+
+
+/* score_duplex:
+ * the lowest delG of the duplex of ref (horizontal) and query
+ * (vertical) and the entry and decision it ends in. A duplex with
+ * no negative delG is {0.0, {0, 0, STOP}}. */
+Duplex_Hit score_duplex(char *ref_seq, char *query_seq)
+{
+    int nrow = strlen(query_seq);
+    int ncol = strlen(ref_seq);
+    Duplex_Hit best_hit = {0.0, {0, 0, STOP}};
+    SW_Entry *rows = malloc(sizeof(SW_Entry) * 2 * ncol);
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 1);
+    if (rows == NULL)
+    {
+        fprintf(stderr, "swnn: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    unsigned char *ref = encode_sequence(ref_seq);
+    unsigned char *query = encode_sequence(query_seq);
+    score_duplex_codes(ref, query, nrow, ncol, rows, NULL, NULL, &best_hit);
+    free(ref);
+    free(query);
+    free(rows);
+    return best_hit;
+}
+
+/* score_duplex_arena:
+ * score_duplex() with the rows and the encoded sequences
+ * allocated from arena, which the caller resets. */
+Duplex_Hit score_duplex_arena(char *ref_seq, char *query_seq, Arena *arena)
+{
+    int nrow = strlen(query_seq);
+    int ncol = strlen(ref_seq);
+    Duplex_Hit best_hit = {0.0, {0, 0, STOP}};
+    SW_Entry *rows = arena_alloc(arena, sizeof(SW_Entry) * 2 * ncol);
+    score_duplex_codes(arena_encode_sequence(arena, ref_seq),
+                       arena_encode_sequence(arena, query_seq),
+                       nrow, ncol, rows, NULL, NULL, &best_hit);
+    return best_hit;
+}
+
+
+/* init_duplex_bound:
+ * the bound of a screen at threshold (delG) of sequences of at most
+ * max_len bases, under the thermo context of the calling thread,
+ * which the screen should be run under too. */
+void init_duplex_bound(Duplex_Bound *bound, float threshold, int max_len)
+{
+    const Thermo_Context *context = thermo_context();
+    int top_loop_len, bottom_loop_len, code_index;
+
+    bound->threshold = threshold;
+    bound->max_len = max_len;
+    init_duplex_constants(&bound->constants);
+    // a loop grows by 1 a step, it is never longer than both sequences
+    bound->loop_floor = 0.0;
+    for (top_loop_len = 0; top_loop_len <= 2 * max_len; top_loop_len++)
+    {
+        for (bottom_loop_len = 0; bottom_loop_len <= 2 * max_len; bottom_loop_len++)
+        {
+            bound->loop_floor = min_of(bound->loop_floor,
+                                       internal_loop_score(top_loop_len,
+                                                           bottom_loop_len));
+        }
+    }
+    // first column entries: a terminal nn delG and an initiation
+    bound->restart_floor = 0.0;
+    for (code_index = 0; code_index < NUM_NN_CODE; code_index++)
+    {
+        bound->restart_floor = min_of(bound->restart_floor,
+                                      context->delG_terminal[code_index]);
+    }
+    bound->restart_floor += min_of(0.0, min_of(context->delG_init_AT,
+                                               context->delG_init_GC));
+}
+
+/* prune_duplex_arena:
+ * score_duplex_arena() into hit, unless the duplex is found not to
+ * go below bound->threshold before the fill is over: then TRUE is
+ * returned and hit is only the lowest record seen. Sequences longer
+ * than bound->max_len are never pruned. */
+int prune_duplex_arena(char *ref_seq, char *query_seq, const Duplex_Bound *bound,
+                       Arena *arena, Duplex_Hit *hit)
+{
+    int nrow = strlen(query_seq);
+    int ncol = strlen(ref_seq);
+    *hit = (Duplex_Hit) {0.0, {0, 0, STOP}};
+    if (nrow > bound->max_len || ncol > bound->max_len)
+    {
+        bound = NULL;
+    }
+    SW_Entry *rows = arena_alloc(arena, sizeof(SW_Entry) * 2 * ncol);
+    Entry_Floor *floors = arena_alloc(arena, sizeof(Entry_Floor) * nrow * ncol +
+                                      sizeof(float) * nrow);
+    return score_duplex_codes(arena_encode_sequence(arena, ref_seq),
+                              arena_encode_sequence(arena, query_seq),
+                              nrow, ncol, rows, bound, floors, hit);
+}
+
+/* screen_duplex_pool:
+ * the duplex of every primer with every other by prune_duplex_arena(),
+ * delGs[i * num_primer + j] is the lowest delG of primers[i] (ref) with
+ * primers[j] (query), NAN where i == j or the pair was pruned. Returns
+ * the number of pairs pruned. */
+int screen_duplex_pool(char **primers, int num_primer,
+                       const Duplex_Bound *bound, Arena *arena, float *delGs)
+{
+    Duplex_Hit hit;
+    int num_pruned = 0;
+    register int i, j;
+    for (i = 0; i < num_primer; i++)
+    {
+        for (j = 0; j < num_primer; j++)
+        {
+            delGs[i * num_primer + j] = NAN;
+            if (j == i)
+            {
+                continue;
+            }
+            if (prune_duplex_arena(primers[i], primers[j], bound, arena, &hit))
+            {
+                num_pruned++;
+            } else
+            {
+                delGs[i * num_primer + j] = hit.delG;
+            }
+            arena_reset(arena);
+        }
+    }
+    return num_pruned;
+}
+
+
+/* score_duplex_codes:
+ * the work of score_duplex() on encoded sequences into best_hit,
+ * rows holds 2 rows of ncol entries. With a bound, floors holds
+ * nrow * ncol Entry_Floors then nrow floats and TRUE is returned if
+ * the fill was stopped. */
+static int score_duplex_codes(unsigned char *ref, unsigned char *query,
+                              int nrow, int ncol, SW_Entry *rows,
+                              const Duplex_Bound *bound, Entry_Floor *floors,
+                              Duplex_Hit *best_hit)
+{
+    if (nrow < 1 || ncol < 1)
+    {
+        return FALSE;
+    }
+    INSTRUMENT_START(fill_timer);
+    SW_Entry *up_row = rows;
+    SW_Entry *entries = rows + ncol;
+    SW_Entry *temp;
+    Duplex_Constants constants;
+    float *restarts = NULL;
+    int first_floor_row = nrow;
+    register int row, col;
+
+    // first row, considerate of dangling ends
+    up_row[0] = _handle_first_entry(ref[0], query[0]);
+    for (col = 1; col < ncol; col++)
+    {
+        Neighbour nn_config = {ref[col -1], ref[col], CODE_DOT, query[0]};
+        up_row[col] = _handle_init_row_col(nn_config);
+    }
+    init_duplex_constants(&constants);
+    if (bound != NULL)
+    {
+        restarts = (float *) (floors + nrow * ncol);
+        first_floor_row = make_entry_floors(bound, ref, query, nrow, ncol,
+                                            floors, restarts);
+    }
+    for (row = 1; row < nrow; row++)
+    {
+        // the row above is done with: its last entry is in the last column
+        keep_lowest_record(&up_row[ncol -1], row -1, ncol -1, best_hit);
+        if (row -1 >= first_floor_row && best_hit->delG > bound->threshold &&
+            cannot_cross(bound, up_row, ncol, &floors[(row -1) * ncol],
+                         restarts[row -1]))
+        {
+            INSTRUMENT_COUNT(COUNTER_PAIRS_PRUNED, 1);
+            INSTRUMENT_ALIGNMENT(fill_timer, 0, (long long) row * ncol);
+            return TRUE;
+        }
+        Neighbour nn_config = {CODE_DOT, ref[0], query[row -1], query[row]};
+        entries[0] = _handle_init_row_col(nn_config);
+        fuse_duplex_row(&constants, ref, query, row, ncol, up_row, entries, NULL);
+        temp = up_row; up_row = entries; entries = temp;
+    }
+    // then the last row
+    for (col = 0; col < ncol; col++)
+    {
+        keep_lowest_record(&up_row[col], nrow -1, col, best_hit);
+    }
+    INSTRUMENT_ALIGNMENT(fill_timer, 1, (long long) nrow * ncol);
+    return FALSE;
+}
+
+/* make_entry_floors:
+ * floors[row * ncol + col] becomes the lowest the records to come can
+ * go below a record of entry (row, col), by kind of record, and
+ * restarts[row] the lowest a record started over after row can be.
+ * Returns the first row made: above a row whose restarts are at the
+ * threshold or below, the fill can't stop, and no floors are made.
+ * Made from the last entry up by the steps of fuse_entry() out of a
+ * record, to the diagonal, the right and the lower entry:
+ *   bind (match)      an nn delG, bulge_score(1) and an nn delG
+ *   bind (mismatch)   an nn delG, nothing or a loop
+ *   top_bulge         nothing or a loop, to a bind only
+ *   bottom_bulge      nothing or a loop, or, 1 long after a bind, a
+ *                     2 long bulge less an nn delG
+ * The nn delGs are those of the codes of both sequences. The table
+ * and the codes are read into locals: the floors are stored as they
+ * are made, which the compiler can't tell from them. */
+static int make_entry_floors(const Duplex_Bound *bound, unsigned char *ref,
+                             unsigned char *query, int nrow, int ncol,
+                             Entry_Floor *floors, float *restarts)
+{
+    const float *delG_internal = bound->constants.delG_internal;
+    const float bulge_one = bound->constants.bulge_one;
+    const float top_bulge_two = bound->constants.top_bulge_two;
+    const float bottom_bulge_two = bound->constants.bottom_bulge_two;
+    const float loop = bound->loop_floor;
+    const float restart = min_of(0.0, bound->restart_floor);
+    const Entry_Floor *lower = NULL;
+    Entry_Floor floor, right = {0.0, 0.0, 0.0, 0.0, 0.0};
+    float lowest = 0.0, next_bind, to_bind;
+    int up_code, code, down_code, skip_code, ref5, ref3, ref_skip, next_match;
+    register int row, col;
+    for (row = nrow -1; row >= 0; row--)
+    {
+        restarts[row] = restart + lowest;
+        if (restarts[row] <= bound->threshold)
+        {
+            return row +1;
+        }
+        // the query codes of the row and the ones around it
+        up_code = (row >= 1) ? query[row -1] : CODE_INVALID;
+        code = query[row];
+        down_code = query[row +1];
+        skip_code = (row +1 < nrow) ? query[row +2] : CODE_INVALID;
+        for (col = ncol -1; col >= 0; col--)
+        {
+            ref5 = ref[col];
+            ref3 = ref[col +1];
+            floor = (Entry_Floor) {0.0, 0.0, 0.0, 0.0, 0.0};
+            if (lower != NULL && col +1 < ncol)
+            {// to the diagonal bind, a match or a mismatch by the codes
+                next_match = IS_COMPLEMENT(down_code, ref3);
+                next_bind = (next_match) ? lower[col +1].bind_match :
+                                           lower[col +1].bind_mismatch;
+                to_bind = delG_internal[NN_CODE_INDEX(ref5, ref3, code, down_code)];
+                floor.bind_match = min_of(0.0, to_bind + next_bind);
+                to_bind = (next_match) ? min_of(0.0, to_bind) : loop;
+                floor.bind_mismatch = min_of(0.0, to_bind + next_bind);
+                to_bind = (next_match) ? next_bind : loop + next_bind;
+                floor.top_bulge = min_of(0.0, to_bind);
+                floor.bottom_bulge_one = floor.bottom_bulge = floor.top_bulge;
+            }
+            if (col +1 < ncol)
+            {// to the right top_bulge
+                ref_skip = ref[col +2];
+                floor.bind_match =
+                    min_of(floor.bind_match, bulge_one + right.top_bulge +
+                           delG_internal[NN_CODE_INDEX(ref5, ref_skip, code, down_code)]);
+                floor.bind_mismatch = min_of(floor.bind_mismatch, loop + right.top_bulge);
+                floor.bottom_bulge = min_of(floor.bottom_bulge, loop + right.top_bulge);
+                // the first column makes no bottom_bulge of a bind
+                if (col >= 1)
+                {
+                    floor.bottom_bulge_one =
+                        min_of(floor.bottom_bulge_one, top_bulge_two + right.top_bulge -
+                               delG_internal[NN_CODE_INDEX(ref[col -1], ref3,
+                                                           code, down_code)]);
+                }
+            }
+            if (lower != NULL)
+            {// to the lower bottom_bulge
+                floor.bind_match =
+                    min_of(floor.bind_match, bulge_one + lower[col].bottom_bulge_one +
+                           delG_internal[NN_CODE_INDEX(ref5, ref3, code, skip_code)]);
+                floor.bind_mismatch = min_of(floor.bind_mismatch,
+                                             loop + lower[col].bottom_bulge);
+                floor.bottom_bulge = min_of(floor.bottom_bulge,
+                                            loop + lower[col].bottom_bulge);
+                // nor does the first row
+                if (row >= 1)
+                {
+                    floor.bottom_bulge_one =
+                        min_of(floor.bottom_bulge_one, bottom_bulge_two +
+                               lower[col].bottom_bulge -
+                               delG_internal[NN_CODE_INDEX(ref5, ref3,
+                                                           up_code, down_code)]);
+                }
+            }
+            floors[row * ncol + col] = right = floor;
+            lowest = min_of(lowest, min_of(min_of(floor.bind_match, floor.bind_mismatch),
+                                           min_of(floor.top_bulge,
+                                                  min_of(floor.bottom_bulge_one,
+                                                         floor.bottom_bulge))));
+        }
+        lower = &floors[row * ncol];
+    }
+    return 0;
+}
+
+/* cannot_cross:
+ * TRUE if no record to come, from the records of entries (a row
+ * filled, floors those of its entries) or started over (no lower
+ * than restart), can go below the threshold */
+static int cannot_cross(const Duplex_Bound *bound, const SW_Entry *entries,
+                        int ncol, const Entry_Floor *floors, float restart)
+{
+    const SW_Entry *entry;
+    register int col;
+    if (restart <= bound->threshold)
+    {
+        return FALSE;
+    }
+    for (col = 0; col < ncol; col++)
+    {
+        entry = &entries[col];
+        if (entry->bind.delG + ((entry->bind.current_decision == MATCH) ?
+                                floors[col].bind_match : floors[col].bind_mismatch) <=
+            bound->threshold ||
+            entry->top_bulge.delG + floors[col].top_bulge <= bound->threshold ||
+            entry->bottom_bulge.delG +
+            ((entry->bottom_bulge.bottom_loop_len == 1 &&
+              entry->bottom_bulge.top_loop_len == 0) ?
+             floors[col].bottom_bulge_one : floors[col].bottom_bulge) <=
+            bound->threshold)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static float min_of(float first, float second)
+{
+    return (first < second) ? first : second;
+}
@@ -0,0 +1,83 @@
+/************************** ENCODING ROUTINES ******************************
+ * Sequences are checked and encoded once as they enter the duplex DP,
+ * so that the DP itself never looks at a character: complementarity is
+ * an XOR (IS_COMPLEMENT()) and the place of a neighbour in the delG
+ * tables a few shifts and ORs (NN_CODE_INDEX()).
+ ****************************************************************************/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swnn.h"
+
+static void write_codes(char *seq, int seq_len, unsigned char *codes);
+
+
+/* encode_base: the code of a base, not case sensitive */
+unsigned char encode_base(char base)
+{
+    switch (toupper(base))
+    {
+        case 'A':
+            return CODE_A;
+        case 'C':
+            return CODE_C;
+        case 'G':
+            return CODE_G;
+        case 'T':
+            return CODE_T;
+        case 'I':
+            return CODE_I;
+        case '.':
+            return CODE_DOT;
+        default:
+            return CODE_INVALID;
+    }
+}
+
+/* encode_sequence:
+ * return the codes of the bases of seq, as many as strlen(seq).
+ * A sequence with anything but A, C, G, T, I or '.' is an error.
+ * The codes are allocated and should be released with free(). */
+unsigned char *encode_sequence(char *seq)
+{
+    int seq_len = strlen(seq);
+    unsigned char *codes = malloc(seq_len +1);
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 1);
+    if (codes == NULL)
+    {
+        fprintf(stderr, "swnn: memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    write_codes(seq, seq_len, codes);
+    return codes;
+}
+
+/* arena_encode_sequence: encode_sequence() allocated from arena */
+unsigned char *arena_encode_sequence(Arena *arena, char *seq)
+{
+    int seq_len = strlen(seq);
+    unsigned char *codes = arena_alloc(arena, seq_len +1);
+    write_codes(seq, seq_len, codes);
+    return codes;
+}
+
+
+/* write_codes: the work of encode_sequence(), codes holds seq_len +1 */
+static void write_codes(char *seq, int seq_len, unsigned char *codes)
+{
+    register int i;
+    for (i = 0; i < seq_len; i++)
+    {
+        codes[i] = encode_base(seq[i]);
+        if (codes[i] == CODE_INVALID)
+        {
+            fprintf(stderr, "swnn: invalid base '%c' at position %d of %s\n",
+                    seq[i], i, seq);
+            exit(EXIT_FAILURE);
+        }
+    }
+    codes[seq_len] = CODE_INVALID;
+}
+
@@ -0,0 +1,448 @@
+/************************ LINEAR SPACE TRACEBACK ROUTINES *******************
+ * Full swinc alignment (score and path) in O(ref_len + query_len) memory
+ * by divide and conquer (Hirschberg, D S, "A linear space algorithm for
+ * computing maximal common subsequences", CACM 18(6), 1975), extended to
+ * the 3 records (M, I, D) of every sw_matrix entry.
+ *
+ * The records are nodes of a graph, an edge leads into
+ *   M[row][col] from any record of [row-1][col-1], scored match/mismatch
+ *   I[row][col] from I[row-1][col] (gap_extension) or M[row-1][col] (gap_open)
+ *   D[row][col] from D[row][col-1] (gap_extension) or M[row][col-1] (gap_open)
+ * and an alignment is a path that starts in a null entry (first row or
+ * first column, never entered again) and ends at the best entry.
+ *
+ * The end is found by swalign_linear() and the start by one backward pass.
+ * To find the path between two records, the rows in between are cut in
+ * half: a forward pass gives the best score of reaching every record of
+ * the middle row, a backward pass the best score of leaving it; the record
+ * with the best sum is on the optimal path and both halves are solved
+ * recursively. Segments of at most 2 rows are solved with a small
+ * decision matrix. Only a few rows of scores are alive at any time.
+ *
+ * Among equally good alignments, the one found may differ from the
+ * one print_alignment() would trace, the score is the same.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "swinc.h"
+
+enum
+{
+    STATE_M = 0,
+    STATE_I = 1,
+    STATE_D = 2,
+    NUM_STATE = 3
+};
+
+/* Everything the recursion shares. scratch holds 6 rows of
+ * (ref_len +1) floats, path is filled from start to end. */
+typedef struct {
+    char *ref;
+    char *query;
+    Score_Param score_param;
+    float *scratch;
+    char *path;
+    int path_len;
+} Hirschberg_Context;
+
+static void solve(Hirschberg_Context *context,
+                  int start_row, int start_col, int start_state,
+                  int end_row, int end_col, int end_state);
+static void solve_short(Hirschberg_Context *context,
+                        int start_row, int start_col, int start_state,
+                        int end_row, int end_col, int end_state);
+static void forward_rows(Hirschberg_Context *context,
+                         int start_row, int start_col, int start_state,
+                         int last_row, int end_col, float *rows[]);
+static void backward_rows(Hirschberg_Context *context,
+                          int end_row, int end_col, int end_state,
+                          int last_row, int start_col, float *rows[],
+                          int *best_start);
+static float substitution(Hirschberg_Context *context, int row, int col);
+
+
+/* align_linear_space:
+ * return the best alignment of query to ref, see SW_Alignment.
+ * The path is allocated and should be released with free_alignment(). */
+SW_Alignment align_linear_space(char *ref, char *query, Score_Param score_param)
+{
+    int ref_len = strlen(ref);
+    int query_len = strlen(query);
+    SW_Hit hit = swalign_linear(ref, query, score_param);
+    SW_Alignment alignment = {hit.score, hit.col, hit.col, hit.row, hit.row, 0, NULL};
+    alignment.path = allocate(query_len + ref_len +1);
+    alignment.path[0] = '\0';
+    if (hit.state == 'T')
+    {// nothing scores above a null entry: empty alignment
+        return alignment;
+    }
+
+    // the path is recovered in linear space, timed as the traceback
+    INSTRUMENT_START(traceback_timer);
+    Hirschberg_Context context = {ref, query, score_param, NULL,
+                                  alignment.path, 0};
+    context.scratch = allocate(sizeof(float) * (ref_len +1) * 2 * NUM_STATE);
+    int end_state = (hit.state == 'M') ? STATE_M :
+                    (hit.state == 'I') ? STATE_I : STATE_D;
+    // locate the null entry the alignment starts from
+    float *rows[NUM_STATE];
+    int best_start[3];
+    int state;
+    for (state = 0; state < NUM_STATE; state++)
+    {
+        rows[state] = context.scratch + state * (ref_len +1);
+    }
+    backward_rows(&context, hit.row, hit.col, end_state, 0, 0, rows, best_start);
+    alignment.query_start = best_start[0];
+    alignment.ref_start = best_start[1];
+
+    solve(&context, best_start[0], best_start[1], best_start[2],
+          hit.row, hit.col, end_state);
+    alignment.path_len = context.path_len;
+    alignment.path[context.path_len] = '\0';
+    free(context.scratch);
+    INSTRUMENT_PHASE(PHASE_TRACEBACK, traceback_timer);
+    return alignment;
+}
+
+void free_alignment(SW_Alignment *alignment)
+{
+    free(alignment->path);
+    alignment->path = NULL;
+    alignment->path_len = 0;
+}
+
+/* print_sw_alignment:
+ * print an alignment of query to ref in the same layout
+ * as print_alignment() */
+void print_sw_alignment(SW_Alignment *alignment, char *ref, char *query)
+{
+    char *ref_string = allocate(alignment->path_len +1);
+    char *query_string = allocate(alignment->path_len +1);
+    char *cigar = allocate(CIGAR_MAX_LEN(alignment->path_len));
+    format_gapped(alignment, ref, query, ref_string, query_string);
+    format_cigar(alignment, strlen(query), cigar);
+    printf("Reference sequence = %s\n", ref);
+    printf("Query sequence = %s\n", query);
+    printf("Alignment score: %.2f\n", alignment->score);
+    printf("Reference position: [%d, %d)\n",
+           alignment->ref_start, alignment->ref_end);
+    printf("Query position: [%d, %d)\n",
+           alignment->query_start, alignment->query_end);
+    printf("%s\n", ref_string);
+    printf("%s\n", query_string);
+    printf("CIGAR: %s\n", cigar);
+    free(ref_string);
+    free(query_string);
+    free(cigar);
+}
+
+
+
+/* solve:
+ * append to the path the records after (start_row, start_col, start_state)
+ * up to and including (end_row, end_col, end_state). */
+static void solve(Hirschberg_Context *context,
+                  int start_row, int start_col, int start_state,
+                  int end_row, int end_col, int end_state)
+{
+    if (end_row - start_row <= 1)
+    {
+        solve_short(context, start_row, start_col, start_state,
+                    end_row, end_col, end_state);
+        return;
+    }
+    int mid_row = (start_row + end_row) / 2;
+    int width = end_col - start_col +1;
+    float *forward[NUM_STATE];
+    float *backward[NUM_STATE];
+    int state, col;
+    for (state = 0; state < NUM_STATE; state++)
+    {
+        forward[state] = context->scratch + state * width;
+        backward[state] = context->scratch + (NUM_STATE + state) * width;
+    }
+    forward_rows(context, start_row, start_col, start_state,
+                 mid_row, end_col, forward);
+    backward_rows(context, end_row, end_col, end_state,
+                  mid_row, start_col, backward, NULL);
+
+    float total, best_total = -INFINITY;
+    int mid_col = start_col, mid_state = STATE_M;
+    for (col = 0; col < width; col++)
+    {
+        for (state = 0; state < NUM_STATE; state++)
+        {
+            total = forward[state][col] + backward[state][col];
+            if (total > best_total)
+            {
+                best_total = total;
+                mid_col = start_col + col;
+                mid_state = state;
+            }
+        }
+    }
+    // scratch is free again once the middle record is known
+    solve(context, start_row, start_col, start_state,
+          mid_row, mid_col, mid_state);
+    solve(context, mid_row, mid_col, mid_state,
+          end_row, end_col, end_state);
+}
+
+
+/* is_blocked: null entries can only be the start of a path */
+#define is_blocked(row, col, start_row, start_col) \
+    (((row) == 0 || (col) == 0) && ((row) != (start_row) || (col) != (start_col)))
+
+static float best_of(float first, float second)
+{
+    return (second > first) ? second : first;
+}
+
+
+/* forward_rows:
+ * rows[state][col - start_col] becomes the best score of any path from
+ * (start_row, start_col, start_state) to (last_row, col, state). */
+static void forward_rows(Hirschberg_Context *context,
+                         int start_row, int start_col, int start_state,
+                         int last_row, int end_col, float *rows[])
+{
+    float *m_row = rows[STATE_M];
+    float *i_row = rows[STATE_I];
+    float *d_row = rows[STATE_D];
+    float gap_open = context->score_param.gap_open_penalty;
+    float gap_extension = context->score_param.gap_extension_penalty;
+    int width = end_col - start_col +1;
+    register int row, col;
+    float diag_h, up_h, old_m;
+
+    // first row: only the start and deletions after it are reachable
+    m_row[0] = i_row[0] = d_row[0] = -INFINITY;
+    rows[start_state][0] = 0.0;
+    for (col = 1; col < width; col++)
+    {
+        m_row[col] = i_row[col] = -INFINITY;
+        d_row[col] = (is_blocked(start_row, start_col + col, start_row, start_col)) ?
+                     -INFINITY :
+                     best_of(d_row[col -1] + gap_extension,
+                             m_row[col -1] + gap_open);
+    }
+    for (row = start_row +1; row <= last_row; row++)
+    {
+        diag_h = best_of(best_of(m_row[0], i_row[0]), d_row[0]);
+        // first column: only an insertion can come from above
+        i_row[0] = (is_blocked(row, start_col, start_row, start_col)) ?
+                   -INFINITY :
+                   best_of(i_row[0] + gap_extension, m_row[0] + gap_open);
+        m_row[0] = d_row[0] = -INFINITY;
+        for (col = 1; col < width; col++)
+        {
+            up_h = best_of(best_of(m_row[col], i_row[col]), d_row[col]);
+            old_m = m_row[col];
+            if (is_blocked(row, start_col + col, start_row, start_col))
+            {
+                m_row[col] = i_row[col] = d_row[col] = -INFINITY;
+            } else
+            {
+                m_row[col] = diag_h + substitution(context, row, start_col + col);
+                i_row[col] = best_of(i_row[col] + gap_extension, old_m + gap_open);
+                d_row[col] = best_of(d_row[col -1] + gap_extension,
+                                     m_row[col -1] + gap_open);
+            }
+            diag_h = up_h;
+        }
+    }
+}
+
+
+/* backward_rows:
+ * rows[state][col - start_col] becomes the best score of any path from
+ * (last_row, col, state), excluding the record itself, to
+ * (end_row, end_col, end_state).
+ * If best_start is not NULL, it receives {row, col, state} of the null
+ * entry with the best path to the end. */
+static void backward_rows(Hirschberg_Context *context,
+                          int end_row, int end_col, int end_state,
+                          int last_row, int start_col, float *rows[],
+                          int *best_start)
+{
+    float *m_row = rows[STATE_M];
+    float *i_row = rows[STATE_I];
+    float *d_row = rows[STATE_D];
+    float gap_open = context->score_param.gap_open_penalty;
+    float gap_extension = context->score_param.gap_extension_penalty;
+    int width = end_col - start_col +1;
+    register int row, col;
+    float below_m, below_i, below_right_m, right_d, to_match;
+    float w_m, w_i, w_d;
+    float best_total = -INFINITY;
+    int state;
+
+    for (row = end_row; row >= last_row; row--)
+    {
+        // the row below still sits in the arrays at col and
+        // to the left of it, the current row to the right.
+        below_right_m = -INFINITY;
+        for (col = width -1; col >= 0; col--)
+        {
+            below_m = (row < end_row) ? m_row[col] : -INFINITY;
+            below_i = (row < end_row) ? i_row[col] : -INFINITY;
+            right_d = (col < width -1) ? d_row[col +1] : -INFINITY;
+            to_match = (row < end_row && col < width -1) ?
+                       below_right_m + substitution(context, row +1, start_col + col +1) :
+                       -INFINITY;
+            if (row == end_row && col == width -1)
+            {
+                w_m = w_i = w_d = -INFINITY;
+            } else
+            {
+                w_m = best_of(best_of(to_match, below_i + gap_open), right_d + gap_open);
+                w_i = best_of(to_match, below_i + gap_extension);
+                w_d = best_of(to_match, right_d + gap_extension);
+            }
+            m_row[col] = w_m;
+            i_row[col] = w_i;
+            d_row[col] = w_d;
+            if (row == end_row && col == width -1)
+            {
+                rows[end_state][col] = 0.0;
+            }
+            if (best_start != NULL && (row == 0 || start_col + col == 0))
+            {
+                for (state = 0; state < NUM_STATE; state++)
+                {
+                    if (rows[state][col] > best_total)
+                    {
+                        best_total = rows[state][col];
+                        best_start[0] = row;
+                        best_start[1] = start_col + col;
+                        best_start[2] = state;
+                    }
+                }
+            }
+            if (is_blocked(row, start_col + col, -1, -1))
+            {
+                m_row[col] = i_row[col] = d_row[col] = -INFINITY;
+            }
+            below_right_m = below_m;
+        }
+    }
+}
+
+
+/* solve_short:
+ * solve() for at most 2 rows by keeping the decisions
+ * of every record and tracing them back. */
+static void solve_short(Hirschberg_Context *context,
+                        int start_row, int start_col, int start_state,
+                        int end_row, int end_col, int end_state)
+{
+    float gap_open = context->score_param.gap_open_penalty;
+    float gap_extension = context->score_param.gap_extension_penalty;
+    int height = end_row - start_row +1;
+    int width = end_col - start_col +1;
+    float (*scores)[width][NUM_STATE] = allocate(sizeof(float) * height * width * NUM_STATE);
+    char (*from)[width][NUM_STATE] = allocate(height * width * NUM_STATE);
+    register int row, col;
+    int state, best_state;
+    float extended, opened;
+
+    for (row = 0; row < height; row++)
+    {
+        for (col = 0; col < width; col++)
+        {
+            for (state = 0; state < NUM_STATE; state++)
+            {
+                scores[row][col][state] = -INFINITY;
+            }
+            if (row == 0 && col == 0)
+            {
+                scores[0][0][start_state] = 0.0;
+                continue;
+            }
+            if (is_blocked(start_row + row, start_col + col, start_row, start_col))
+            {
+                continue;
+            }
+            if (row > 0 && col > 0)
+            {
+                best_state = STATE_M;
+                for (state = STATE_I; state < NUM_STATE; state++)
+                {
+                    if (scores[row -1][col -1][state] > scores[row -1][col -1][best_state])
+                    {
+                        best_state = state;
+                    }
+                }
+                scores[row][col][STATE_M] = scores[row -1][col -1][best_state] + \
+                    substitution(context, start_row + row, start_col + col);
+                from[row][col][STATE_M] = best_state;
+            }
+            if (row > 0)
+            {
+                extended = scores[row -1][col][STATE_I] + gap_extension;
+                opened = scores[row -1][col][STATE_M] + gap_open;
+                scores[row][col][STATE_I] = best_of(extended, opened);
+                from[row][col][STATE_I] = (opened > extended) ? STATE_M : STATE_I;
+            }
+            if (col > 0)
+            {
+                extended = scores[row][col -1][STATE_D] + gap_extension;
+                opened = scores[row][col -1][STATE_M] + gap_open;
+                scores[row][col][STATE_D] = best_of(extended, opened);
+                from[row][col][STATE_D] = (opened > extended) ? STATE_M : STATE_D;
+            }
+        }
+    }
+
+    // trace back from the end, the moves come out in reverse
+    int first = context->path_len;
+    row = height -1;
+    col = width -1;
+    state = end_state;
+    while (row != 0 || col != 0)
+    {
+        int previous_state = from[row][col][state];
+        switch (state)
+        {
+            case (STATE_M):
+                context->path[context->path_len++] =
+                    (context->ref[start_col + col -1] ==
+                     context->query[start_row + row -1]) ? 'M' : 'X';
+                row--;
+                col--;
+                break;
+            case (STATE_I):
+                context->path[context->path_len++] = 'I';
+                row--;
+                break;
+            case (STATE_D):
+                context->path[context->path_len++] = 'D';
+                col--;
+                break;
+        }
+        state = previous_state;
+    }
+    int last = context->path_len -1;
+    char temp;
+    while (first < last)
+    {
+        temp = context->path[first];
+        context->path[first++] = context->path[last];
+        context->path[last--] = temp;
+    }
+    free(scores);
+    free(from);
+}
+
+
+/* substitution: score of entering M at (row, col) */
+static float substitution(Hirschberg_Context *context, int row, int col)
+{
+    return (context->ref[col -1] == context->query[row -1]) ?
+           context->score_param.match_score :
+           context->score_param.mismatch_penalty;
+}
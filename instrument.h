@@ -0,0 +1,63 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdio.h>
+
+/* Instrumentation of the hot paths, compiled in with -DINSTRUMENT and
+ * to nothing otherwise.
+ * Every thread keeps its own phase timers, counters and histogram of
+ * alignment latency, updated without locks; instrument_dump() adds them
+ * up and writes them out as JSON (see instrument_routines.c). Once
+ * INSTRUMENT_INIT() is run at the start of main(), that happens at exit
+ * and whenever the process gets SIGUSR1. */
+
+enum
+{
+    PHASE_PARSE,            // reading primers in
+    PHASE_REV_COMPLEMENT,
+    PHASE_FILL,             // the DP of score-only and full alignments
+    PHASE_TRACEBACK,
+    PHASE_OUTPUT,           // formatting and writing results
+    NUM_PHASE
+};
+
+enum
+{
+    COUNTER_CELLS,          // DP cells computed
+    COUNTER_PAIRS,          // alignments (or duplexes) made
+    COUNTER_PAIRS_PRUNED,   // pairs skipped without a full DP
+    COUNTER_ALLOCATIONS,    // heap allocations on the alignment paths
+    NUM_COUNTER
+};
+
+/* latency bucket b counts alignments of less than 2^b ns */
+#define NUM_LATENCY_BUCKET 40
+
+#ifdef INSTRUMENT
+
+#define INSTRUMENT_INIT() instrument_init(NULL)
+#define INSTRUMENT_START(timer) long long timer = instrument_now()
+#define INSTRUMENT_PHASE(phase, timer) \
+    instrument_phase((phase), instrument_now() - (timer))
+#define INSTRUMENT_ALIGNMENT(timer, num_pair, num_cell) \
+    instrument_alignment(instrument_now() - (timer), (num_pair), (num_cell))
+#define INSTRUMENT_COUNT(counter, count) instrument_count((counter), (count))
+
+#else
+
+#define INSTRUMENT_INIT() ((void) 0)
+#define INSTRUMENT_START(timer)
+#define INSTRUMENT_PHASE(phase, timer) ((void) 0)
+#define INSTRUMENT_ALIGNMENT(timer, num_pair, num_cell) ((void) 0)
+#define INSTRUMENT_COUNT(counter, count) ((void) 0)
+
+#endif /* INSTRUMENT */
+
+void instrument_init(const char *filename);
+long long instrument_now(void);
+void instrument_phase(int phase, long long elapsed_ns);
+void instrument_alignment(long long elapsed_ns, long num_pair, long long num_cell);
+void instrument_count(int counter, long long count);
+void instrument_dump(FILE *outfile);
+
+#endif /* INSTRUMENT_H */
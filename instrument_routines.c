@@ -0,0 +1,272 @@
+/************************** INSTRUMENTATION ROUTINES ***********************
+ * The per thread records behind the INSTRUMENT_* macros (instrument.h).
+ *
+ * A thread's record is made the first time it reports anything and put
+ * on a list, where it stays after the thread is gone so that a dump
+ * covers all the work done. Only its thread writes it, with relaxed
+ * atomic stores (plain moves on x86), so the hot paths never lock;
+ * a dump reads the records with relaxed loads while they are being
+ * written and is a consistent snapshot of each number, not of all.
+ *
+ * SIGUSR1 is blocked by instrument_init(), so that the threads created
+ * after it inherit the mask, and taken by a thread of its own in
+ * sigwait(): the dump runs in a normal thread, not in a handler.
+ *
+ * A dump is a JSON object:
+ *   {"phases": {"parse": {"seconds": ..., "calls": ...}, ...},
+ *    "counters": {"cells": ..., "pairs": ..., ...},
+ *    "threads": [{"thread": 0, "phases": ..., "counters": ...,
+ *                 "latency_ns": [[upper bound, count], ...]}, ...]}
+ * with the phases and counters of the whole process first.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include "instrument.h"
+
+typedef struct Instrument_Record {
+    long long phase_ns[NUM_PHASE];
+    long long phase_calls[NUM_PHASE];
+    long long counters[NUM_COUNTER];
+    long long latency[NUM_LATENCY_BUCKET];
+    int thread_id;
+    struct Instrument_Record *next;
+} Instrument_Record;
+
+static const char *phase_names[NUM_PHASE] = {
+    "parse", "rev_complement", "fill", "traceback", "output"
+};
+static const char *counter_names[NUM_COUNTER] = {
+    "cells", "pairs", "pairs_pruned", "allocations"
+};
+
+static __thread Instrument_Record *thread_record = NULL;
+static Instrument_Record *records = NULL;
+static int num_record = 0;
+static pthread_mutex_t records_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char *dump_filename = NULL;
+
+static Instrument_Record *own_record(void);
+static void add(long long *field, long long value);
+static void dump_to_file(void);
+static void *wait_for_signal(void *unused);
+static void write_fields(FILE *outfile, const char *name, const char **names,
+                         const long long *values, int num_value, int as_phases,
+                         const long long *calls);
+
+
+/* instrument_init:
+ * dump into filename at exit and on SIGUSR1. filename is
+ * $INSTRUMENT_FILE if NULL, and stderr if that isn't set. */
+void instrument_init(const char *filename)
+{
+    static int is_initialised = 0;
+    if (is_initialised)
+    {
+        return;
+    }
+    is_initialised = 1;
+    dump_filename = (filename != NULL) ? filename : getenv("INSTRUMENT_FILE");
+    atexit(dump_to_file);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, wait_for_signal, NULL) == 0)
+    {
+        pthread_detach(thread);
+    }
+}
+
+/* instrument_now: a monotonic clock in ns */
+long long instrument_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void instrument_phase(int phase, long long elapsed_ns)
+{
+    Instrument_Record *record = own_record();
+    add(&record->phase_ns[phase], elapsed_ns);
+    add(&record->phase_calls[phase], 1);
+}
+
+/* instrument_alignment:
+ * num_pair alignments of num_cell cells in all were filled in
+ * elapsed_ns, each one goes into the histogram at the mean */
+void instrument_alignment(long long elapsed_ns, long num_pair, long long num_cell)
+{
+    Instrument_Record *record = own_record();
+    add(&record->phase_ns[PHASE_FILL], elapsed_ns);
+    add(&record->phase_calls[PHASE_FILL], 1);
+    add(&record->counters[COUNTER_PAIRS], num_pair);
+    add(&record->counters[COUNTER_CELLS], num_cell);
+    if (num_pair > 0)
+    {
+        unsigned long long latency = elapsed_ns / num_pair;
+        int bucket = (latency > 0) ? 64 - __builtin_clzll(latency) : 0;
+        bucket = (bucket < NUM_LATENCY_BUCKET) ? bucket : NUM_LATENCY_BUCKET -1;
+        add(&record->latency[bucket], num_pair);
+    }
+}
+
+void instrument_count(int counter, long long count)
+{
+    add(&own_record()->counters[counter], count);
+}
+
+/* instrument_dump: the records so far as JSON, see above */
+void instrument_dump(FILE *outfile)
+{
+    long long phase_ns[NUM_PHASE] = {0};
+    long long phase_calls[NUM_PHASE] = {0};
+    long long counters[NUM_COUNTER] = {0};
+    long long values[NUM_LATENCY_BUCKET];
+    Instrument_Record *record;
+    int i;
+
+    pthread_mutex_lock(&records_lock);
+    for (record = records; record != NULL; record = record->next)
+    {
+        for (i = 0; i < NUM_PHASE; i++)
+        {
+            phase_ns[i] += __atomic_load_n(&record->phase_ns[i], __ATOMIC_RELAXED);
+            phase_calls[i] += __atomic_load_n(&record->phase_calls[i], __ATOMIC_RELAXED);
+        }
+        for (i = 0; i < NUM_COUNTER; i++)
+        {
+            counters[i] += __atomic_load_n(&record->counters[i], __ATOMIC_RELAXED);
+        }
+    }
+    fprintf(outfile, "{");
+    write_fields(outfile, "phases", phase_names, phase_ns, NUM_PHASE, 1, phase_calls);
+    fprintf(outfile, ",\n ");
+    write_fields(outfile, "counters", counter_names, counters, NUM_COUNTER, 0, NULL);
+    fprintf(outfile, ",\n \"threads\": [");
+    for (record = records; record != NULL; record = record->next)
+    {
+        fprintf(outfile, "%s\n  {\"thread\": %d, ", (record != records) ? "," : "",
+                record->thread_id);
+        for (i = 0; i < NUM_PHASE; i++)
+        {
+            phase_ns[i] = __atomic_load_n(&record->phase_ns[i], __ATOMIC_RELAXED);
+            phase_calls[i] = __atomic_load_n(&record->phase_calls[i], __ATOMIC_RELAXED);
+        }
+        for (i = 0; i < NUM_COUNTER; i++)
+        {
+            counters[i] = __atomic_load_n(&record->counters[i], __ATOMIC_RELAXED);
+        }
+        write_fields(outfile, "phases", phase_names, phase_ns, NUM_PHASE, 1, phase_calls);
+        fprintf(outfile, ", ");
+        write_fields(outfile, "counters", counter_names, counters, NUM_COUNTER, 0, NULL);
+        fprintf(outfile, ", \"latency_ns\": [");
+        int num_written = 0;
+        for (i = 0; i < NUM_LATENCY_BUCKET; i++)
+        {
+            values[i] = __atomic_load_n(&record->latency[i], __ATOMIC_RELAXED);
+            if (values[i] > 0)
+            {
+                fprintf(outfile, "%s[%llu, %lld]", (num_written++ > 0) ? ", " : "",
+                        1ULL << i, values[i]);
+            }
+        }
+        fprintf(outfile, "]}");
+    }
+    fprintf(outfile, "\n]}\n");
+    fflush(outfile);
+    pthread_mutex_unlock(&records_lock);
+}
+
+
+/* own_record: the calling thread's record, made on first use */
+static Instrument_Record *own_record(void)
+{
+    if (thread_record == NULL)
+    {
+        Instrument_Record *record = calloc(1, sizeof(Instrument_Record));
+        if (record == NULL)
+        {
+            fprintf(stderr, "instrument: memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_lock(&records_lock);
+        record->thread_id = num_record++;
+        // appended, so that threads are dumped in the order they started
+        Instrument_Record **last = &records;
+        while (*last != NULL)
+        {
+            last = &(*last)->next;
+        }
+        *last = record;
+        pthread_mutex_unlock(&records_lock);
+        thread_record = record;
+    }
+    return thread_record;
+}
+
+/* add: the owner's update of a field a dump may be reading */
+static void add(long long *field, long long value)
+{
+    __atomic_store_n(field, *field + value, __ATOMIC_RELAXED);
+}
+
+static void dump_to_file(void)
+{
+    FILE *outfile = (dump_filename != NULL) ? fopen(dump_filename, "w") : stderr;
+    if (outfile == NULL)
+    {
+        fprintf(stderr, "instrument: cannot write %s\n", dump_filename);
+        return;
+    }
+    instrument_dump(outfile);
+    if (outfile != stderr)
+    {
+        fclose(outfile);
+    }
+}
+
+/* wait_for_signal: dump on every SIGUSR1, for ever */
+static void *wait_for_signal(void *unused)
+{
+    sigset_t signals;
+    int signal_number;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    while (sigwait(&signals, &signal_number) == 0)
+    {
+        dump_to_file();
+    }
+    return unused;
+}
+
+/* write_fields:
+ * "name": {"names[i]": values[i], ...}, phases as
+ * {"seconds": ..., "calls": ...} */
+static void write_fields(FILE *outfile, const char *name, const char **names,
+                         const long long *values, int num_value, int as_phases,
+                         const long long *calls)
+{
+    int i;
+    fprintf(outfile, "\"%s\": {", name);
+    for (i = 0; i < num_value; i++)
+    {
+        if (as_phases)
+        {
+            fprintf(outfile, "%s\"%s\": {\"seconds\": %.9f, \"calls\": %lld}",
+                    (i > 0) ? ", " : "", names[i], values[i] * 1e-9, calls[i]);
+        }else
+        {
+            fprintf(outfile, "%s\"%s\": %lld", (i > 0) ? ", " : "",
+                    names[i], values[i]);
+        }
+    }
+    fprintf(outfile, "}");
+}
@@ -0,0 +1,97 @@
+/************************ LINEAR MEMORY SW ROUTINES *************************
+ * Score-only swinc alignment that keeps a single rolling row of the
+ * M, I and max(M, I, D) records instead of the whole sw_matrix.
+ * D only depends on the entry to the left and is carried along the row,
+ * the diagonal max is held in a register before its slot is overwritten.
+ *
+ * Memory is O(ref_len) and no decision is stored, so the length of the
+ * sequences is no longer limited by the stack.
+ * Scores and the reported end coordinate are the same as the ones from
+ * fill_matrix().
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+
+/* swalign_linear:
+ * return the best score of aligning query to ref together with the
+ * entry (row in query, col in ref) where it is found.
+ * As in fill_matrix(), the bottom rightmost entry is chosen among
+ * equal maxima, and the state is the best record of that entry
+ * ('M' for match/mismatch, 'I' for insert, 'D' for delete; 'T' for
+ * the null entries of the first row and column). */
+SW_Hit swalign_linear(char *ref, char *query, Score_Param score_param)
+{
+    int ref_len = strlen(ref);
+    int query_len = strlen(query);
+    int ncol = ref_len +1;
+    SW_Hit best_hit = {0.0, 0, 0, 'T'};
+    INSTRUMENT_START(fill_timer);
+    float *m_row = allocate(sizeof(float) * ncol * 3);
+    float *i_row = m_row + ncol;
+    float *h_row = i_row + ncol;
+    register int row, col;
+    float diag_h, up_h, left_m, left_d;
+    float match_score, insert_score, delete_score;
+    float extended, opened, best_score;
+    char best_state;
+
+    // first row is null entries
+    for (col = 0; col < ncol; col++)
+    {
+        m_row[col] = i_row[col] = h_row[col] = 0.0;
+    }
+    best_hit.col = ref_len;
+    for (row = 1; row <= query_len; row++)
+    {
+        // the first column is a null entry as well
+        if (best_hit.score <= 0.0)
+        {
+            best_hit = (SW_Hit) {0.0, row, 0, 'T'};
+        }
+        diag_h = left_m = left_d = 0.0;
+        for (col = 1; col < ncol; col++)
+        {
+            match_score = diag_h + ((ref[col -1] == query[row -1]) ?
+                                    score_param.match_score :
+                                    score_param.mismatch_penalty);
+            extended = i_row[col] + score_param.gap_extension_penalty;
+            opened = m_row[col] + score_param.gap_open_penalty;
+            insert_score = (opened > extended) ? opened : extended;
+            extended = left_d + score_param.gap_extension_penalty;
+            opened = left_m + score_param.gap_open_penalty;
+            delete_score = (opened > extended) ? opened : extended;
+
+            best_score = match_score;
+            best_state = 'M';
+            if (insert_score > best_score)
+            {
+                best_score = insert_score;
+                best_state = 'I';
+            }
+            if (delete_score > best_score)
+            {
+                best_score = delete_score;
+                best_state = 'D';
+            }
+            if (best_score >= best_hit.score)
+            {
+                best_hit = (SW_Hit) {best_score, row, col, best_state};
+            }
+
+            up_h = h_row[col];
+            m_row[col] = match_score;
+            i_row[col] = insert_score;
+            h_row[col] = best_score;
+            diag_h = up_h;
+            left_m = match_score;
+            left_d = delete_score;
+        }
+    }
+    free(m_row);
+    INSTRUMENT_ALIGNMENT(fill_timer, 1, (long long) ref_len * query_len);
+    return best_hit;
+}
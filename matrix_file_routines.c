@@ -0,0 +1,296 @@
+/************************ INTERACTION MATRIX FILE ROUTINES ******************
+ * A binary file for interaction matrices, so that the scores of a pool
+ * are computed once and then looked up by any tool without parsing
+ * print_interaction_matrix() output.
+ *
+ * The file is a Matrix_File_Header followed, at payload_offset, by the
+ * scores in tiles of tile_size x tile_size entries. Tiles are stored
+ * row major and so are the entries within a tile; the tiles of the last
+ * row and column are padded to full size so that the place of (i, j) is
+ * a few multiplications away:
+ *   tile  = (i / tile_size) * num_tile_col + j / tile_size
+ *   entry = tile * tile_size^2 + (i % tile_size) * tile_size + j % tile_size
+ * A tile holds the pairs that align_pool_parallel() schedules together,
+ * and a lookup touches a single page of the payload.
+ *
+ * Files are written in the byte order of the machine, byte_order tells
+ * a reader when it differs. pool_hash identifies the primers (in order)
+ * and score_param the scores the matrix was made with;
+ * open_pool_interaction_file() turns down a file of another pool.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "swinc.h"
+
+#define MATRIX_FILE_MAGIC "SWINCMX"
+#define MATRIX_FILE_VERSION 1
+#define MATRIX_FILE_BYTE_ORDER 0x01020304
+#define MATRIX_FILE_HEADER_SIZE 64
+#define MATRIX_PRECISION_FLOAT32 4
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t precision;     // bytes per score
+    uint32_t num_primer;
+    uint32_t tile_size;
+    uint32_t kmer_size;
+    uint64_t pool_hash;
+    float score_param[4];   // match, mismatch, gap open, gap extension
+    uint64_t payload_offset;
+} Matrix_File_Header;
+
+static uint64_t payload_size(uint64_t num_primer, uint64_t tile_size);
+
+
+/* hash_pool:
+ * FNV-1a hash of the primers, each followed by a newline */
+unsigned long long hash_pool(char **primers, int num_primer)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *base;
+    int i;
+    for (i = 0; i < num_primer; i++)
+    {
+        for (base = (const unsigned char *) primers[i]; *base != '\0'; base++)
+        {
+            hash = (hash ^ *base) * 1099511628211ULL;
+        }
+        hash = (hash ^ '\n') * 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+/* align_pool_to_file:
+ * align primers[i] to rc(primers[j]) for all i, j as align_pool() does
+ * (the diagonal is 0) and write the scores into filename, see above.
+ * The matrix is produced a row of tiles at a time, never as a whole.
+ * tile_size is POOL_TILE_SIZE if 0. */
+void align_pool_to_file(char **primers, int num_primer,
+                        Score_Param score_param, int tile_size,
+                        char *filename)
+{
+    tile_size = (tile_size > 0) ? tile_size : POOL_TILE_SIZE;
+    int num_tile_col = (num_primer + tile_size -1) / tile_size;
+    size_t band_pairs = (size_t) tile_size * num_tile_col * tile_size;
+    char **queries = allocate(sizeof(char *) * (num_primer +1));
+    char **refs = allocate(sizeof(char *) * band_pairs);
+    char **pair_queries = allocate(sizeof(char *) * band_pairs);
+    float *scores = allocate(sizeof(float) * band_pairs);
+    float *band = allocate(sizeof(float) * band_pairs);
+    Arena *arena = create_arena(0);
+    int i, j, tile_row, num_pair;
+    Matrix_File_Header header;
+
+    FILE *outfile = fopen(filename, "wb");
+    if (outfile == NULL)
+    {
+        fprintf(stderr, "%s error:\nCannot write %s\n", PROGRAM_NAME, filename);
+        exit(EXIT_FAILURE);
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.version = MATRIX_FILE_VERSION;
+    header.byte_order = MATRIX_FILE_BYTE_ORDER;
+    header.precision = MATRIX_PRECISION_FLOAT32;
+    header.num_primer = num_primer;
+    header.tile_size = tile_size;
+    header.kmer_size = KMER_SIZE;
+    header.pool_hash = hash_pool(primers, num_primer);
+    header.score_param[0] = score_param.match_score;
+    header.score_param[1] = score_param.mismatch_penalty;
+    header.score_param[2] = score_param.gap_open_penalty;
+    header.score_param[3] = score_param.gap_extension_penalty;
+    header.payload_offset = MATRIX_FILE_HEADER_SIZE;
+    char header_block[MATRIX_FILE_HEADER_SIZE] = {0};
+    memcpy(header_block, &header, sizeof(header));
+    fwrite(header_block, 1, MATRIX_FILE_HEADER_SIZE, outfile);
+
+    for (j = 0; j < num_primer; j++)
+    {
+        queries[j] = rev_complement(primers[j], KMER_SIZE);
+    }
+    for (tile_row = 0; tile_row * tile_size < num_primer; tile_row++)
+    {
+        num_pair = 0;
+        for (i = tile_row * tile_size; i < num_primer && i < (tile_row +1) * tile_size; i++)
+        {
+            for (j = 0; j < num_primer; j++)
+            {
+                refs[num_pair] = primers[i];
+                pair_queries[num_pair++] = queries[j];
+            }
+        }
+        swalign_batch_arena(refs, pair_queries, num_pair, score_param,
+                            scores, arena);
+        arena_reset(arena);
+        // scatter the rows into the tiles of the band, padding with 0
+        memset(band, 0, sizeof(float) * band_pairs);
+        num_pair = 0;
+        for (i = 0; i < tile_size && tile_row * tile_size + i < num_primer; i++)
+        {
+            for (j = 0; j < num_primer; j++)
+            {
+                band[(size_t) (j / tile_size) * tile_size * tile_size +
+                     (size_t) i * tile_size + j % tile_size] =
+                    (tile_row * tile_size + i == j) ? 0.0 : scores[num_pair];
+                num_pair++;
+            }
+        }
+        fwrite(band, sizeof(float), band_pairs, outfile);
+    }
+    if (ferror(outfile) || fclose(outfile) != 0)
+    {
+        fprintf(stderr, "%s error:\nCannot write %s\n", PROGRAM_NAME, filename);
+        exit(EXIT_FAILURE);
+    }
+
+    for (j = 0; j < num_primer; j++)
+    {
+        free(queries[j]);
+    }
+    free(queries);
+    free(refs);
+    free(pair_queries);
+    free(scores);
+    free(band);
+    free_arena(arena);
+}
+
+
+/* open_interaction_file:
+ * map a file written by align_pool_to_file() for reading.
+ * Nothing is read but the header until scores are looked up.
+ * Return NULL (and say why on stderr) if the file can't be used. */
+Interaction_File *open_interaction_file(char *filename)
+{
+    int file_descriptor = open(filename, O_RDONLY);
+    struct stat file_stat;
+    if (file_descriptor < 0 || fstat(file_descriptor, &file_stat) != 0)
+    {
+        fprintf(stderr, "%s error:\nCannot open %s\n", PROGRAM_NAME, filename);
+        if (file_descriptor >= 0)
+        {
+            close(file_descriptor);
+        }
+        return NULL;
+    }
+    size_t map_len = file_stat.st_size;
+    void *map = (map_len >= MATRIX_FILE_HEADER_SIZE) ?
+                mmap(NULL, map_len, PROT_READ, MAP_SHARED, file_descriptor, 0) :
+                MAP_FAILED;
+    close(file_descriptor); // the mapping stays valid
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "%s error:\nCannot map %s\n", PROGRAM_NAME, filename);
+        return NULL;
+    }
+
+    Matrix_File_Header header;
+    memcpy(&header, map, sizeof(header));
+    char *problem = NULL;
+    if (memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        problem = "not an interaction matrix file";
+    }else if (header.byte_order != MATRIX_FILE_BYTE_ORDER)
+    {
+        problem = "written with another byte order";
+    }else if (header.version != MATRIX_FILE_VERSION)
+    {
+        problem = "unknown version";
+    }else if (header.precision != MATRIX_PRECISION_FLOAT32 || header.tile_size == 0 ||
+              header.num_primer > INT_MAX || header.tile_size > INT_MAX)
+    {
+        problem = "unknown layout";
+    }else if (header.payload_offset < MATRIX_FILE_HEADER_SIZE ||
+              header.payload_offset > map_len ||
+              header.payload_offset % sizeof(float) != 0)
+    {
+        problem = "bad payload offset";
+    }else if (payload_size(header.num_primer, header.tile_size) >
+              map_len - header.payload_offset)
+    {
+        problem = "truncated";
+    }
+    if (problem != NULL)
+    {
+        fprintf(stderr, "%s error:\n%s: %s\n", PROGRAM_NAME, filename, problem);
+        munmap(map, map_len);
+        return NULL;
+    }
+
+    Interaction_File *file = allocate(sizeof(Interaction_File));
+    file->num_primer = header.num_primer;
+    file->tile_size = header.tile_size;
+    file->num_tile_col = (header.num_primer + header.tile_size -1) / header.tile_size;
+    file->pool_hash = header.pool_hash;
+    file->score_param.match_score = header.score_param[0];
+    file->score_param.mismatch_penalty = header.score_param[1];
+    file->score_param.gap_open_penalty = header.score_param[2];
+    file->score_param.gap_extension_penalty = header.score_param[3];
+    file->scores = (const float *) ((const char *) map + header.payload_offset);
+    file->map = map;
+    file->map_len = map_len;
+    return file;
+}
+
+/* open_pool_interaction_file:
+ * open_interaction_file() of a file that should hold the matrix of
+ * the num_primer primers: NULL (and why on stderr) if it was made
+ * from another pool, as told by num_primer and pool_hash. */
+Interaction_File *open_pool_interaction_file(char *filename, char **primers,
+                                             int num_primer)
+{
+    Interaction_File *file = open_interaction_file(filename);
+    if (file != NULL && (file->num_primer != num_primer ||
+                         file->pool_hash != hash_pool(primers, num_primer)))
+    {
+        fprintf(stderr, "%s error:\n%s: made from another pool\n",
+                PROGRAM_NAME, filename);
+        close_interaction_file(file);
+        return NULL;
+    }
+    return file;
+}
+
+/* interaction_score:
+ * interaction_matrix[i][j] of the file, i and j should be
+ * less than file->num_primer. */
+float interaction_score(Interaction_File *file, int i, int j)
+{
+    int tile_size = file->tile_size;
+    size_t tile = (size_t) (i / tile_size) * file->num_tile_col + j / tile_size;
+    return file->scores[tile * tile_size * tile_size +
+                        (i % tile_size) * tile_size + j % tile_size];
+}
+
+void close_interaction_file(Interaction_File *file)
+{
+    munmap(file->map, file->map_len);
+    free(file);
+}
+
+
+/* payload_size:
+ * the bytes of the tiles of num_primer x num_primer scores,
+ * UINT64_MAX if that doesn't fit in 64 bits */
+static uint64_t payload_size(uint64_t num_primer, uint64_t tile_size)
+{
+    // a side of the padded matrix, less than 2^33 for 32 bit fields
+    uint64_t side = (num_primer + tile_size -1) / tile_size * tile_size;
+    if (side != 0 && side > UINT64_MAX / sizeof(float) / side)
+    {
+        return UINT64_MAX;
+    }
+    return side * side * sizeof(float);
+}
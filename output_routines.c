@@ -0,0 +1,252 @@
+/************************** OUTPUT ROUTINES ********************************
+ * Interaction matrix reports, written a block of rows at a time:
+ *   REPORT_TSV      a header line of primer names, then for every row
+ *                   its primer and its scores, separated by tabs,
+ *   REPORT_CSV      the same separated by commas,
+ *   REPORT_SUMMARY  for every row its primer, its max and its mean
+ *                   over all ncol columns, the diagonal included, as
+ *                   print_interaction_matrix() takes them (those of
+ *                   summarise_pool() leave the primer against itself
+ *                   out).
+ *
+ * Scores are formatted by format_float() rather than printf(): the
+ * score is scaled and rounded once, in double where the product is
+ * exact, and its digits written out of an integer, so the text is the
+ * one of printf("%.*f") without parsing a format for every cell.
+ * Rows are formatted into Text_Buffers, by num_thread threads at once
+ * if asked to, each taking a contiguous run of REPORT_BLOCK_ROWS rows;
+ * the buffers are then written out in row order with one fwrite()
+ * each, so the report is the same whatever the number of threads.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "swinc.h"
+
+#define REPORT_BLOCK_ROWS 256
+#define REPORT_MAX_PRECISION 6
+
+/* a run of rows for one thread to format */
+typedef struct {
+    const float *matrix;
+    size_t row_stride;
+    char **names;
+    int ncol;
+    Report_Options options;
+    int first_row;
+    int last_row;
+    Text_Buffer buffer;
+} Report_Job;
+
+static const double power_of_ten[REPORT_MAX_PRECISION +1] = {
+    1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0
+};
+
+static void *format_rows(void *job);
+static size_t name_len(char **names, int index);
+static char *write_name(char *cursor, char **names, int index);
+static int clamp_precision(int precision);
+
+
+/* format_float:
+ * write value into text as printf("%.*f", precision, value) does,
+ * return the number of chars written (not counting the '\0').
+ * precision is at most REPORT_MAX_PRECISION. */
+int format_float(float value, int precision, char *text)
+{
+    precision = clamp_precision(precision);
+    // a float times a power of ten up to 10^6 is exact in a double
+    double scaled = rint((double) value * power_of_ten[precision]);
+    if (!isfinite(scaled) || fabs(scaled) >= 1e18)
+    {
+        return sprintf(text, "%.*f", precision, value);
+    }
+    char digits[24];
+    int num_digit = 0;
+    long long integer = (long long) fabs(scaled);
+    char *cursor = text;
+    do
+    {
+        digits[num_digit++] = '0' + integer % 10;
+        integer /= 10;
+    } while (integer > 0 || num_digit <= precision);
+    if (signbit(value))
+    {// printf keeps the sign of what rounds to 0
+        *cursor++ = '-';
+    }
+    while (num_digit > precision)
+    {
+        *cursor++ = digits[--num_digit];
+    }
+    if (precision > 0)
+    {
+        *cursor++ = '.';
+        while (num_digit > 0)
+        {
+            *cursor++ = digits[--num_digit];
+        }
+    }
+    *cursor = '\0';
+    return cursor - text;
+}
+
+
+/* write_interaction_report:
+ * write nrow rows of ncol scores of matrix, row i starting at
+ * matrix + i * row_stride, into outfile in options.format.
+ * names[i] is the primer of row and column i (their index if
+ * names is NULL). */
+void write_interaction_report(FILE *outfile, const float *matrix,
+                              size_t row_stride, char **names,
+                              int nrow, int ncol, Report_Options options)
+{
+    INSTRUMENT_START(output_timer);
+    int num_thread = (options.num_thread > 1) ? options.num_thread : 1;
+    char separator = (options.format == REPORT_CSV) ? ',' : '\t';
+    Report_Job *jobs = allocate(sizeof(Report_Job) * num_thread);
+    pthread_t *threads = allocate(sizeof(pthread_t) * num_thread);
+    int i, row, num_job;
+
+    for (i = 0; i < num_thread; i++)
+    {
+        jobs[i] = (Report_Job) {matrix, row_stride, names, ncol, options,
+                                0, 0, {NULL, 0, 0}};
+        init_text_buffer(&jobs[i].buffer, 0);
+    }
+    // the header line
+    Text_Buffer *buffer = &jobs[0].buffer;
+    char *cursor;
+    if (options.format == REPORT_SUMMARY)
+    {
+        fputs("primer\tmax\tmean\n", outfile);
+    }else
+    {
+        fputs("primer", outfile);
+        for (i = 0; i < ncol; i++)
+        {
+            cursor = reserve_text(buffer, name_len(names, i) +1);
+            *cursor++ = separator;
+            cursor = write_name(cursor, names, i);
+            buffer->len = cursor - buffer->text;
+        }
+        fwrite(buffer->text, 1, buffer->len, outfile);
+        fputc('\n', outfile);
+        buffer->len = 0;
+    }
+
+    for (row = 0; row < nrow; )
+    {
+        for (num_job = 0; num_job < num_thread && row < nrow; num_job++)
+        {
+            jobs[num_job].first_row = row;
+            row += REPORT_BLOCK_ROWS;
+            jobs[num_job].last_row = (row < nrow) ? row : nrow;
+        }
+        if (num_job == 1)
+        {
+            format_rows(&jobs[0]);
+        }else
+        {
+            for (i = 0; i < num_job; i++)
+            {
+                if (pthread_create(&threads[i], NULL, format_rows, &jobs[i]) != 0)
+                {
+                    fprintf(stderr, "%s error:\nCannot create thread %d\n",
+                            PROGRAM_NAME, i);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            for (i = 0; i < num_job; i++)
+            {
+                pthread_join(threads[i], NULL);
+            }
+        }
+        for (i = 0; i < num_job; i++)
+        {
+            fwrite(jobs[i].buffer.text, 1, jobs[i].buffer.len, outfile);
+            jobs[i].buffer.len = 0;
+        }
+    }
+
+    for (i = 0; i < num_thread; i++)
+    {
+        free_text_buffer(&jobs[i].buffer);
+    }
+    free(jobs);
+    free(threads);
+    INSTRUMENT_PHASE(PHASE_OUTPUT, output_timer);
+}
+
+
+/* format_rows: format the rows of a Report_Job into its buffer */
+static void *format_rows(void *arg)
+{
+    Report_Job *job = arg;
+    int precision = clamp_precision(job->options.precision);
+    char separator = (job->options.format == REPORT_CSV) ? ',' : '\t';
+    // a float is at most 39 digits, a sign and a point before rounding
+    size_t cell_len = 42 + precision;
+    size_t row_len = 2 + ((job->options.format == REPORT_SUMMARY) ?
+                          2 : job->ncol) * cell_len;
+    const float *scores;
+    float max_score;
+    char *cursor;
+    int row, col;
+    for (row = job->first_row; row < job->last_row; row++)
+    {
+        scores = job->matrix + (size_t) row * job->row_stride;
+        cursor = reserve_text(&job->buffer, name_len(job->names, row) + row_len);
+        cursor = write_name(cursor, job->names, row);
+        if (job->options.format == REPORT_SUMMARY)
+        {
+            max_score = 0.0;
+            for (col = 0; col < job->ncol; col++)
+            {
+                max_score = (scores[col] > max_score) ? scores[col] : max_score;
+            }
+            *cursor++ = '\t';
+            cursor += format_float(max_score, precision, cursor);
+            *cursor++ = '\t';
+            cursor += format_float((job->ncol > 0) ?
+                                   mean((float *) scores, job->ncol) : 0.0,
+                                   precision, cursor);
+        }else
+        {
+            for (col = 0; col < job->ncol; col++)
+            {
+                *cursor++ = separator;
+                cursor += format_float(scores[col], precision, cursor);
+            }
+        }
+        *cursor++ = '\n';
+        job->buffer.len = cursor - job->buffer.text;
+    }
+    return NULL;
+}
+
+/* name_len: the length write_name() writes at most */
+static size_t name_len(char **names, int index)
+{
+    return (names == NULL) ? 11 : strlen(names[index]);
+}
+
+/* write_name: the whole of names[index], or index if there are no names */
+static char *write_name(char *cursor, char **names, int index)
+{
+    if (names == NULL)
+    {
+        return cursor + sprintf(cursor, "%d", index);
+    }
+    size_t len = strlen(names[index]);
+    memcpy(cursor, names[index], len);
+    return cursor + len;
+}
+
+static int clamp_precision(int precision)
+{
+    return (precision < 0) ? 0 :
+           (precision > REPORT_MAX_PRECISION) ? REPORT_MAX_PRECISION : precision;
+}
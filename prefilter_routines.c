@@ -0,0 +1,498 @@
+/************************ DIMER PREFILTER ROUTINES **************************
+ * A screen of the pairs of a pool for complementarity without gaps,
+ * run before the DP so that only the pairs that may form a dimer are
+ * aligned.
+ *
+ * A sequence of at most PACKED_MAX_LEN bases is packed into 2 bit
+ * planes (see Packed_Seq), base k at bit k. The query is the reverse
+ * complement of a primer, as in align_pool(), and bases are compared
+ * as swalign() does, so a complementary run is a run of equal bases.
+ *
+ * dimer_runs() measures a pair: on the diagonal where query base p
+ * faces ref base p + shift, the bases that match are
+ *   ~((ref.low ^ query.low << shift) | (ref.high ^ query.high << shift))
+ * with both valid, a word for the whole diagonal. x &= x >> 1 takes a
+ * base off every run of 1 in it, so the longest run is the number of
+ * times it takes to empty x; a run at the 3' end of the ref (bit
+ * len -1) or of the primer behind the query (bit shift, query base 0)
+ * is a count of leading or trailing 1. It looks at all
+ * len(ref) + len(query) -1 diagonals.
+ *
+ * screen_dimers() only tests pairs against a Dimer_Prefilter, for
+ * PREFILTER_LANES refs at once. A word per query base p,
+ *   ends[p] = the ref bases equal to query base p
+ * holds the runs of 1 match ending at p on every diagonal at once (a
+ * diagonal is a bit of ends[p -1] shifted up by one). A run of 2 * len
+ * is 2 runs of len one after the other:
+ *   ends[p] &= ends[p - len] << len
+ * so runs of k take log2(k) passes over the query, with no branch on
+ * the bases, and there is a run if any bit is left. The query being
+ * the same in all lanes, ends[p] is one load of the ref_bases of the
+ * code of query base p: the kernels run the lanes in AVX2 or AVX-512
+ * registers, bound through swinc_kernels().
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+#ifdef SIMD_WIDE_KERNELS
+#include <immintrin.h>
+#endif
+
+static int code_of_base(char base);
+static int longest_run_of(unsigned long long matches);
+static int query_code(const Packed_Seq *query, int p);
+static int extend_runs(unsigned long long (*ends)[PREFILTER_LANES],
+                       int query_len, int len, int run_len);
+
+
+/* pack_sequence:
+ * pack seq into packed, 0 if it is longer than PACKED_MAX_LEN.
+ * Anything but A, C, G and T is packed as a base matching nothing. */
+int pack_sequence(const char *seq, Packed_Seq *packed)
+{
+    int len = strlen(seq);
+    int i, code;
+    *packed = (Packed_Seq) {0, 0, 0, len};
+    if (len > PACKED_MAX_LEN)
+    {
+        return 0;
+    }
+    for (i = 0; i < len; i++)
+    {
+        code = code_of_base(seq[i]);
+        if (code >= 0)
+        {
+            packed->low |= (unsigned long long) (code & 1) << i;
+            packed->high |= (unsigned long long) (code >> 1) << i;
+            packed->valid |= 1ULL << i;
+        }
+    }
+    return 1;
+}
+
+/* dimer_runs:
+ * the longest run of matches between ref and query on any diagonal,
+ * and the longest one at the 3' end of the ref or of the primer
+ * query is the reverse complement of */
+Dimer_Runs dimer_runs(const Packed_Seq *ref, const Packed_Seq *query)
+{
+    Dimer_Runs runs = {0, 0};
+    unsigned long long matches, anchored;
+    int shift, run;
+    for (shift = 1 - query->len; shift < ref->len; shift++)
+    {
+        if (shift >= 0)
+        {
+            matches = ~((ref->low ^ (query->low << shift)) |
+                        (ref->high ^ (query->high << shift))) &
+                      ref->valid & (query->valid << shift);
+        } else
+        {
+            matches = ~((ref->low ^ (query->low >> -shift)) |
+                        (ref->high ^ (query->high >> -shift))) &
+                      ref->valid & (query->valid >> -shift);
+        }
+        if (matches == 0)
+        {
+            continue;
+        }
+        run = longest_run_of(matches);
+        runs.longest_run = (run > runs.longest_run) ? run : runs.longest_run;
+        // the ref's 3' end at the top bit, the primer's at bit shift
+        anchored = ~(matches << (PACKED_MAX_LEN - ref->len));
+        run = (anchored == 0) ? PACKED_MAX_LEN : __builtin_clzll(anchored);
+        runs.anchored_run = (run > runs.anchored_run) ? run : runs.anchored_run;
+        if (shift >= 0)
+        {
+            anchored = ~(matches >> shift);
+            run = (anchored == 0) ? PACKED_MAX_LEN : __builtin_ctzll(anchored);
+            runs.anchored_run = (run > runs.anchored_run) ? run : runs.anchored_run;
+        }
+    }
+    return runs;
+}
+
+/* passes_prefilter:
+ * 1 if a pair of runs is taken for a dimer by prefilter,
+ * the test screen_dimers() makes without counting the runs */
+int passes_prefilter(Dimer_Runs runs, Dimer_Prefilter prefilter)
+{
+    return (runs.longest_run >= prefilter.min_run ||
+            (prefilter.min_anchored_run > 0 &&
+             runs.anchored_run >= prefilter.min_anchored_run));
+}
+
+/* load_prefilter_lanes:
+ * the first num_ref (at most PREFILTER_LANES) of refs into lanes,
+ * the lanes left are empty refs */
+void load_prefilter_lanes(const Packed_Seq *refs, int num_ref,
+                          Prefilter_Lanes *lanes)
+{
+    int lane;
+    memset(lanes, 0, sizeof(Prefilter_Lanes));
+    lanes->num_lane = num_ref;
+    for (lane = 0; lane < num_ref; lane++)
+    {
+        const Packed_Seq *ref = &refs[lane];
+        lanes->ref_bases[0][lane] = ~ref->low & ~ref->high & ref->valid;
+        lanes->ref_bases[1][lane] = ref->low & ~ref->high & ref->valid;
+        lanes->ref_bases[2][lane] = ~ref->low & ref->high & ref->valid;
+        lanes->ref_bases[3][lane] = ref->low & ref->high & ref->valid;
+        lanes->last_base[lane] = (ref->len > 0) ? 1ULL << (ref->len -1) : 0;
+    }
+}
+
+/* screen_dimers:
+ * bit lane set for the refs of lanes that pass prefilter with query
+ * (passes_prefilter() of their dimer_runs()), in the kernel bound to
+ * the instruction set level */
+unsigned screen_dimers(const Prefilter_Lanes *lanes, const Packed_Seq *query,
+                       Dimer_Prefilter prefilter)
+{
+    return swinc_kernels()->screen_dimers(lanes, query, prefilter);
+}
+
+/* screen_dimers_scalar: screen_dimers() a lane at a time */
+unsigned screen_dimers_scalar(const Prefilter_Lanes *lanes,
+                              const Packed_Seq *query,
+                              Dimer_Prefilter prefilter)
+{
+    unsigned long long ends[PACKED_MAX_LEN][PREFILTER_LANES];
+    unsigned long long found[PREFILTER_LANES] = {0};
+    unsigned long long anchor;
+    int run_len = prefilter.min_run;
+    int anchored_len = prefilter.min_anchored_run;
+    int targets[2];
+    int p, lane, target, len = 1;
+    unsigned passed = 0;
+    if (run_len <= 0)
+    {
+        return (1U << lanes->num_lane) -1;
+    }
+    for (p = 0; p < query->len; p++)
+    {
+        const unsigned long long *bases = lanes->ref_bases[query_code(query, p)];
+        for (lane = 0; lane < PREFILTER_LANES; lane++)
+        {
+            ends[p][lane] = bases[lane];
+        }
+    }
+    // the anchored runs at whichever of the 2 lengths comes first
+    targets[0] = (anchored_len > 0 && anchored_len < run_len) ? anchored_len : run_len;
+    targets[1] = (targets[0] == run_len) ? anchored_len : run_len;
+    for (target = 0; target < 2; target++)
+    {
+        len = extend_runs(ends, query->len, len, targets[target]);
+        for (p = 0; p < query->len && targets[target] > 0; p++)
+        {
+            // any run, a run from query base 0, or one to the ref's 3' end
+            for (lane = 0; lane < PREFILTER_LANES; lane++)
+            {
+                anchor = (targets[target] == run_len || p == anchored_len -1) ?
+                         ~0ULL : lanes->last_base[lane];
+                found[lane] |= ends[p][lane] & anchor;
+            }
+        }
+    }
+    for (lane = 0; lane < lanes->num_lane; lane++)
+    {
+        passed |= (unsigned) (found[lane] != 0) << lane;
+    }
+    return passed;
+}
+
+/* align_pool_prefiltered:
+ * align_pool() on the pairs that pass prefilter only, the others are
+ * taken for no dimer and get 0 as the diagonal does. Refs are
+ * screened PREFILTER_LANES at a time against every query, then each
+ * row's pairs that passed are aligned in one batch. Pairs with a
+ * primer too long to be packed are always aligned. Return the number
+ * of pairs left out. */
+long align_pool_prefiltered(int pool_size, Score_Param score_param,
+                            Dimer_Prefilter prefilter)
+{
+    char **queries = allocate(sizeof(char *) * (pool_size +1));
+    char **refs = allocate(sizeof(char *) * (pool_size +1));
+    char **passed = allocate(sizeof(char *) * (pool_size +1));
+    int *passed_index = allocate(sizeof(int) * (pool_size +1));
+    float *scores = allocate(sizeof(float) * (pool_size +1));
+    unsigned *screens = allocate(sizeof(unsigned) * (pool_size +1));
+    Packed_Seq *packed_queries = allocate(sizeof(Packed_Seq) * (pool_size +1));
+    int *is_packed = allocate(sizeof(int) * (pool_size +1));
+    Packed_Seq packed_refs[PREFILTER_LANES];
+    Prefilter_Lanes lanes;
+    Arena *arena = create_arena(0);
+    unsigned unpacked_lanes;
+    long num_pruned = 0;
+    int i, j, k, lane, num_lane, num_passed;
+
+    for (j = 0; j < pool_size; j++)
+    {
+        queries[j] = rev_complement(pool[j], KMER_SIZE);
+        is_packed[j] = pack_sequence(queries[j], &packed_queries[j]);
+    }
+    for (i = 0; i < pool_size; i += PREFILTER_LANES)
+    {
+        num_lane = (pool_size - i < PREFILTER_LANES) ? pool_size - i : PREFILTER_LANES;
+        unpacked_lanes = 0;
+        for (lane = 0; lane < num_lane; lane++)
+        {
+            unpacked_lanes |= (unsigned) !pack_sequence(pool[i + lane],
+                                                        &packed_refs[lane]) << lane;
+        }
+        load_prefilter_lanes(packed_refs, num_lane, &lanes);
+        for (j = 0; j < pool_size; j++)
+        {
+            screens[j] = (is_packed[j]) ?
+                         screen_dimers(&lanes, &packed_queries[j], prefilter) |
+                         unpacked_lanes : ~0U;
+        }
+        // the pairs of each row that passed, in one batch as align_pool() does
+        for (lane = 0; lane < num_lane; lane++)
+        {
+            num_passed = 0;
+            for (j = 0; j < pool_size; j++)
+            {
+                interaction_matrix[i + lane][j] = 0.0;
+                if (j != i + lane && (screens[j] >> lane & 1))
+                {
+                    refs[num_passed] = pool[i + lane];
+                    passed[num_passed] = queries[j];
+                    passed_index[num_passed++] = j;
+                }
+            }
+            num_pruned += pool_size -1 - num_passed;
+            if (num_passed > 0)
+            {
+                swalign_batch_arena(refs, passed, num_passed, score_param,
+                                    scores, arena);
+                arena_reset(arena);
+            }
+            for (k = 0; k < num_passed; k++)
+            {
+                interaction_matrix[i + lane][passed_index[k]] = scores[k];
+            }
+        }
+    }
+    INSTRUMENT_COUNT(COUNTER_PAIRS_PRUNED, num_pruned);
+
+    for (j = 0; j < pool_size; j++)
+    {
+        free(queries[j]);
+    }
+    free(queries);
+    free(refs);
+    free(passed);
+    free(passed_index);
+    free(scores);
+    free(screens);
+    free(packed_queries);
+    free(is_packed);
+    free_arena(arena);
+    return num_pruned;
+}
+
+
+#ifdef SIMD_WIDE_KERNELS
+/* screen_dimers_avx2:
+ * screen_dimers_scalar() with the lanes in 2 AVX2 registers */
+__attribute__((target("avx2")))
+unsigned screen_dimers_avx2(const Prefilter_Lanes *lanes,
+                            const Packed_Seq *query,
+                            Dimer_Prefilter prefilter)
+{
+    __m256i ends[PACKED_MAX_LEN][2];
+    __m256i found[2], anchor[2], last_base[2];
+    __m128i shift;
+    int run_len = prefilter.min_run;
+    int anchored_len = prefilter.min_anchored_run;
+    int targets[2];
+    int p, half, target, step, len = 1;
+    unsigned passed = 0;
+    if (run_len <= 0)
+    {
+        return (1U << lanes->num_lane) -1;
+    }
+    for (half = 0; half < 2; half++)
+    {
+        found[half] = _mm256_setzero_si256();
+        last_base[half] = _mm256_loadu_si256((const __m256i *) &lanes->last_base[4 * half]);
+    }
+    for (p = 0; p < query->len; p++)
+    {
+        const unsigned long long *bases = lanes->ref_bases[query_code(query, p)];
+        ends[p][0] = _mm256_loadu_si256((const __m256i *) bases);
+        ends[p][1] = _mm256_loadu_si256((const __m256i *) (bases + 4));
+    }
+    // the anchored runs at whichever of the 2 lengths comes first
+    targets[0] = (anchored_len > 0 && anchored_len < run_len) ? anchored_len : run_len;
+    targets[1] = (targets[0] == run_len) ? anchored_len : run_len;
+    for (target = 0; target < 2; target++)
+    {
+        // extend_runs()
+        while (len < targets[target])
+        {
+            step = (2 * len <= targets[target]) ? len : targets[target] - len;
+            shift = _mm_cvtsi32_si128(step);
+            for (p = query->len -1; p >= step; p--)
+            {
+                for (half = 0; half < 2; half++)
+                {
+                    ends[p][half] = _mm256_and_si256(ends[p][half],
+                                        _mm256_sll_epi64(ends[p - step][half], shift));
+                }
+            }
+            for (p = 0; p < step && p < query->len; p++)
+            {
+                ends[p][0] = ends[p][1] = _mm256_setzero_si256();
+            }
+            len += step;
+        }
+        for (p = 0; p < query->len && targets[target] > 0; p++)
+        {
+            for (half = 0; half < 2; half++)
+            {
+                anchor[half] = (targets[target] == run_len || p == anchored_len -1) ?
+                               _mm256_set1_epi64x(-1) : last_base[half];
+                found[half] = _mm256_or_si256(found[half],
+                                  _mm256_and_si256(ends[p][half], anchor[half]));
+            }
+        }
+    }
+    for (half = 0; half < 2; half++)
+    {
+        found[half] = _mm256_cmpeq_epi64(found[half], _mm256_setzero_si256());
+        passed |= (~_mm256_movemask_pd(_mm256_castsi256_pd(found[half])) & 0xf)
+                  << (4 * half);
+    }
+    return passed & ((1U << lanes->num_lane) -1);
+}
+
+/* screen_dimers_avx512:
+ * screen_dimers_scalar() with the lanes in an AVX-512 register */
+__attribute__((target("avx512f")))
+unsigned screen_dimers_avx512(const Prefilter_Lanes *lanes,
+                              const Packed_Seq *query,
+                              Dimer_Prefilter prefilter)
+{
+    __m512i ends[PACKED_MAX_LEN];
+    __m512i found = _mm512_setzero_si512();
+    __m512i last_base = _mm512_loadu_si512(lanes->last_base);
+    __m512i anchor;
+    __m128i shift;
+    int run_len = prefilter.min_run;
+    int anchored_len = prefilter.min_anchored_run;
+    int targets[2];
+    int p, target, step, len = 1;
+    if (run_len <= 0)
+    {
+        return (1U << lanes->num_lane) -1;
+    }
+    for (p = 0; p < query->len; p++)
+    {
+        ends[p] = _mm512_loadu_si512(lanes->ref_bases[query_code(query, p)]);
+    }
+    // the anchored runs at whichever of the 2 lengths comes first
+    targets[0] = (anchored_len > 0 && anchored_len < run_len) ? anchored_len : run_len;
+    targets[1] = (targets[0] == run_len) ? anchored_len : run_len;
+    for (target = 0; target < 2; target++)
+    {
+        // extend_runs()
+        while (len < targets[target])
+        {
+            step = (2 * len <= targets[target]) ? len : targets[target] - len;
+            shift = _mm_cvtsi32_si128(step);
+            for (p = query->len -1; p >= step; p--)
+            {
+                ends[p] = _mm512_and_si512(ends[p], _mm512_sll_epi64(ends[p - step], shift));
+            }
+            for (p = 0; p < step && p < query->len; p++)
+            {
+                ends[p] = _mm512_setzero_si512();
+            }
+            len += step;
+        }
+        for (p = 0; p < query->len && targets[target] > 0; p++)
+        {
+            anchor = (targets[target] == run_len || p == anchored_len -1) ?
+                     _mm512_set1_epi64(-1) : last_base;
+            found = _mm512_or_si512(found, _mm512_and_si512(ends[p], anchor));
+        }
+    }
+    return _mm512_test_epi64_mask(found, found) & ((1U << lanes->num_lane) -1);
+}
+#endif /* SIMD_WIDE_KERNELS */
+
+
+/* code_of_base: the 2 bit code of a base, -1 for anything else */
+static int code_of_base(char base)
+{
+    switch (base)
+    {
+        case 'A':
+            return 0;
+        case 'C':
+            return 1;
+        case 'G':
+            return 2;
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+/* longest_run_of: the longest run of 1 in matches */
+static int longest_run_of(unsigned long long matches)
+{
+    int run = 0;
+    while (matches != 0)
+    {
+        matches &= matches >> 1;
+        run++;
+    }
+    return run;
+}
+
+/* query_code:
+ * the code of query base p, the row of ref_bases in
+ * Prefilter_Lanes: 4 to 7 if it's not valid */
+static int query_code(const Packed_Seq *query, int p)
+{
+    return ((query->low >> p) & 1) | ((query->high >> p) & 1) << 1 |
+           ((~query->valid >> p) & 1) << 2;
+}
+
+/* extend_runs:
+ * ends[p] holds the ref bases where a run of len matches ends facing
+ * query base p, make them runs of run_len and return the length they
+ * are of: run_len, or len if that's more. Each step is
+ *   ends[p] &= ends[p - step] << step    with step <= len */
+static int extend_runs(unsigned long long (*ends)[PREFILTER_LANES],
+                       int query_len, int len, int run_len)
+{
+    int p, lane, step;
+    while (len < run_len)
+    {
+        step = (2 * len <= run_len) ? len : run_len - len;
+        for (p = query_len -1; p >= step; p--)
+        {
+            for (lane = 0; lane < PREFILTER_LANES; lane++)
+            {
+                ends[p][lane] &= ends[p - step][lane] << step;
+            }
+        }
+        for (p = 0; p < step && p < query_len; p++)
+        {
+            for (lane = 0; lane < PREFILTER_LANES; lane++)
+            {
+                ends[p][lane] = 0;
+            }
+        }
+        len += step;
+    }
+    return len;
+}
@@ -0,0 +1,188 @@
+/************************** ALIGNMENT REPORT ROUTINES **********************
+ * Text forms of an SW_Alignment, written straight into buffers the
+ * caller sized, never grown a character at a time:
+ *   - the CIGAR string of the alignment, with '=' for a match, 'X' for
+ *     a mismatch, 'I' for a base of query against a gap in ref, 'D' for
+ *     a base of ref against a gap in query, and 'S' for the bases of
+ *     query clipped off before query_start and after query_end,
+ *   - the gapped strings, ref and query laid over each other with '-'
+ *     in the gaps, as print_alignment() prints them.
+ * The path is walked once for each, so formatting is linear in its
+ * length.
+ *
+ * format_alignments() reports a whole batch into a single Text_Buffer,
+ * one line per alignment, with the tracebacks in the arena of an
+ * SW_Aligner: the buffer is the only thing that grows.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+static char *write_cigar_op(char *cursor, int count, char op);
+
+
+/* format_cigar:
+ * write the CIGAR string of alignment into cigar, which holds
+ * CIGAR_MAX_LEN(alignment->path_len) chars. query_len is the length
+ * of the whole query, for the clip at its end.
+ * Return the length of the string. */
+int format_cigar(SW_Alignment *alignment, int query_len, char *cigar)
+{
+    char *cursor = cigar;
+    char op, next_op;
+    int i, count;
+    if (alignment->query_start > 0)
+    {
+        cursor = write_cigar_op(cursor, alignment->query_start, 'S');
+    }
+    for (i = 0; i < alignment->path_len; i += count)
+    {
+        op = (alignment->path[i] == 'M') ? '=' : alignment->path[i];
+        for (count = 1; i + count < alignment->path_len; count++)
+        {
+            next_op = (alignment->path[i + count] == 'M') ?
+                      '=' : alignment->path[i + count];
+            if (next_op != op)
+            {
+                break;
+            }
+        }
+        cursor = write_cigar_op(cursor, count, op);
+    }
+    if (query_len > alignment->query_end)
+    {
+        cursor = write_cigar_op(cursor, query_len - alignment->query_end, 'S');
+    }
+    *cursor = '\0';
+    return cursor - cigar;
+}
+
+/* format_gapped:
+ * write the aligned parts of ref and query, with '-' in the gaps,
+ * into ref_string and query_string, which hold path_len +1 chars. */
+void format_gapped(SW_Alignment *alignment, char *ref, char *query,
+                   char *ref_string, char *query_string)
+{
+    const char *ref_base = ref + alignment->ref_start;
+    const char *query_base = query + alignment->query_start;
+    int i;
+    for (i = 0; i < alignment->path_len; i++)
+    {
+        switch (alignment->path[i])
+        {
+            case ('M'): case ('X'):
+                ref_string[i] = *ref_base++;
+                query_string[i] = *query_base++;
+                break;
+            case ('I'):
+                ref_string[i] = '-';
+                query_string[i] = *query_base++;
+                break;
+            case ('D'):
+                ref_string[i] = *ref_base++;
+                query_string[i] = '-';
+                break;
+        }
+    }
+    ref_string[i] = '\0';
+    query_string[i] = '\0';
+}
+
+
+/* init_text_buffer: an empty buffer of capacity chars (4096 if 0) */
+void init_text_buffer(Text_Buffer *buffer, size_t capacity)
+{
+    buffer->capacity = (capacity > 0) ? capacity : 4096;
+    buffer->len = 0;
+    buffer->text = allocate(buffer->capacity);
+    buffer->text[0] = '\0';
+}
+
+void free_text_buffer(Text_Buffer *buffer)
+{
+    free(buffer->text);
+    buffer->text = NULL;
+    buffer->len = buffer->capacity = 0;
+}
+
+/* reserve_text:
+ * make room for len more chars (and the '\0') at the end
+ * of buffer, return where they start */
+char *reserve_text(Text_Buffer *buffer, size_t len)
+{
+    if (buffer->len + len +1 > buffer->capacity)
+    {
+        while (buffer->len + len +1 > buffer->capacity)
+        {
+            buffer->capacity *= 2;
+        }
+        buffer->text = realloc(buffer->text, buffer->capacity);
+        if (buffer->text == NULL)
+        {
+            error_handle(ERROR_MEM_ALLOC);
+            exit(ERROR_MEM_ALLOC);
+        }
+    }
+    return buffer->text + buffer->len;
+}
+
+/* format_alignments:
+ * align queries[k] to refs[k] for all k < num_pair with the
+ * parameters of aligner and append to buffer a line per alignment:
+ *     k score ref_start ref_end query_start query_end cigar
+ *     gapped_ref gapped_query
+ * separated by tabs, positions as in SW_Alignment.
+ * The alignments are made one at a time in the arena of aligner. */
+void format_alignments(SW_Aligner *aligner, char **refs, char **queries,
+                       int num_pair, Text_Buffer *buffer)
+{
+    SW_Alignment alignment;
+    char *cursor;
+    int k, query_len;
+    size_t max_len;
+    for (k = 0; k < num_pair; k++)
+    {
+        alignment = aligner_align(aligner, refs[k], queries[k]);
+        INSTRUMENT_START(output_timer);
+        query_len = strlen(queries[k]);
+        // 6 numbers and 8 tabs, the cigar, 2 gapped strings and a newline
+        max_len = 6 * 16 + 8 + CIGAR_MAX_LEN(alignment.path_len) +
+                  2 * alignment.path_len +1;
+        cursor = reserve_text(buffer, max_len);
+        cursor += sprintf(cursor, "%d\t%.4f\t%d\t%d\t%d\t%d\t", k,
+                          alignment.score,
+                          alignment.ref_start, alignment.ref_end,
+                          alignment.query_start, alignment.query_end);
+        cursor += format_cigar(&alignment, query_len, cursor);
+        *cursor++ = '\t';
+        format_gapped(&alignment, refs[k], queries[k],
+                      cursor, cursor + alignment.path_len +1);
+        cursor[alignment.path_len] = '\t'; // join the 2 strings
+        cursor += 2 * alignment.path_len +1;
+        *cursor++ = '\n';
+        *cursor = '\0';
+        buffer->len = cursor - buffer->text;
+        INSTRUMENT_PHASE(PHASE_OUTPUT, output_timer);
+    }
+}
+
+
+/* write_cigar_op: count then op at cursor, return the end */
+static char *write_cigar_op(char *cursor, int count, char op)
+{
+    char digits[12];
+    int num_digit = 0;
+    do
+    {
+        digits[num_digit++] = '0' + count % 10;
+        count /= 10;
+    } while (count > 0);
+    while (num_digit > 0)
+    {
+        *cursor++ = digits[--num_digit];
+    }
+    *cursor++ = op;
+    return cursor;
+}
@@ -0,0 +1,223 @@
+/************************ PARALLEL POOL ROUTINES ****************************
+ * align_pool() on many threads.
+ *
+ * The interaction matrix is cut into square tiles of tile_size rows and
+ * columns: the refs and queries of a tile fit in L1 and its pairs are
+ * enough to keep the lanes of swalign_batch() full.
+ * Tiles are dealt out round robin to the workers, each worker takes
+ * tiles from the bottom of its own deque and, once it runs dry, steals
+ * from the top of the others'. A worker has its own arena for the
+ * scratch space of the kernel, reset after every tile.
+ * Every entry of the matrix is computed by the same kernel on the same
+ * pair whichever worker takes its tile, so the result is bit for bit
+ * the one of the serial align_pool().
+ ****************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "swinc.h"
+
+/* A deque of tile indices. The owner pops from the bottom,
+ * thieves from the top. */
+typedef struct {
+    int *tiles;
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+} Tile_Deque;
+
+/* What the workers share */
+typedef struct {
+    int pool_size;
+    int tile_size;
+    int num_tile_col;
+    int num_thread;
+    int pin_threads;
+    Score_Param score_param;
+    char **queries;
+    Tile_Deque *deques;
+} Pool_Work;
+
+typedef struct {
+    Pool_Work *work;
+    int worker_id;
+} Worker_Args;
+
+static void *run_worker(void *args);
+static int take_tile(Pool_Work *work, int worker_id);
+static void align_tile(Pool_Work *work, int tile,
+                       char **refs, char **queries, float *scores,
+                       Arena *arena);
+
+
+/* align_pool_parallel:
+ * fill interaction_matrix as align_pool() does, using the
+ * threads, pinning and tiling described by schedule. */
+void align_pool_parallel(int pool_size, Score_Param score_param,
+                         Pool_Schedule schedule)
+{
+    int num_thread = schedule.num_thread;
+    if (num_thread <= 0)
+    {
+        num_thread = sysconf(_SC_NPROCESSORS_ONLN);
+        num_thread = (num_thread > 0) ? num_thread : 1;
+    }
+    int tile_size = (schedule.tile_size > 0) ? schedule.tile_size : POOL_TILE_SIZE;
+    int num_tile_row = (pool_size + tile_size -1) / tile_size;
+    int num_tile = num_tile_row * num_tile_row;
+    Pool_Work work = {pool_size, tile_size, num_tile_row, num_thread,
+                      schedule.pin_threads, score_param, NULL, NULL};
+    int i, tile;
+
+    work.queries = allocate(sizeof(char *) * (pool_size +1));
+    for (i = 0; i < pool_size; i++)
+    {
+        work.queries[i] = rev_complement(pool[i], KMER_SIZE);
+    }
+    // deal the tiles out round robin
+    work.deques = allocate(sizeof(Tile_Deque) * num_thread);
+    for (i = 0; i < num_thread; i++)
+    {
+        work.deques[i].tiles = allocate(sizeof(int) * (num_tile / num_thread +1));
+        work.deques[i].top = 0;
+        work.deques[i].bottom = 0;
+        pthread_mutex_init(&work.deques[i].lock, NULL);
+    }
+    for (tile = 0; tile < num_tile; tile++)
+    {
+        Tile_Deque *deque = &work.deques[tile % num_thread];
+        deque->tiles[deque->bottom++] = tile;
+    }
+
+    pthread_t *threads = allocate(sizeof(pthread_t) * num_thread);
+    Worker_Args *args = allocate(sizeof(Worker_Args) * num_thread);
+    for (i = 0; i < num_thread; i++)
+    {
+        args[i] = (Worker_Args) {&work, i};
+        if (pthread_create(&threads[i], NULL, run_worker, &args[i]) != 0)
+        {
+            fprintf(stderr, "%s error:\nCannot create thread %d\n",
+                    PROGRAM_NAME, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (i = 0; i < num_thread; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < pool_size; i++)
+    {
+        interaction_matrix[i][i] = 0.0;
+        free(work.queries[i]);
+    }
+    for (i = 0; i < num_thread; i++)
+    {
+        pthread_mutex_destroy(&work.deques[i].lock);
+        free(work.deques[i].tiles);
+    }
+    free(work.queries);
+    free(work.deques);
+    free(threads);
+    free(args);
+}
+
+
+/* run_worker: align tiles until there's none left anywhere */
+static void *run_worker(void *args)
+{
+    Pool_Work *work = ((Worker_Args *) args)->work;
+    int worker_id = ((Worker_Args *) args)->worker_id;
+    if (work->pin_threads)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(worker_id % CPU_SETSIZE, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+    }
+    int tile_pairs = work->tile_size * work->tile_size;
+    char **refs = allocate(sizeof(char *) * tile_pairs);
+    char **queries = allocate(sizeof(char *) * tile_pairs);
+    float *scores = allocate(sizeof(float) * tile_pairs);
+    Arena *arena = create_arena(0); // the worker's own
+    int tile;
+    while ((tile = take_tile(work, worker_id)) >= 0)
+    {
+        align_tile(work, tile, refs, queries, scores, arena);
+        arena_reset(arena);
+    }
+    free(refs);
+    free(queries);
+    free(scores);
+    free_arena(arena);
+    return NULL;
+}
+
+/* take_tile:
+ * the next tile of the worker's own deque, or one stolen
+ * from another worker. -1 once all deques are empty. */
+static int take_tile(Pool_Work *work, int worker_id)
+{
+    int tile = -1;
+    int victim, i;
+    Tile_Deque *deque = &work->deques[worker_id];
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top)
+    {
+        tile = deque->tiles[--deque->bottom];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    for (i = 1; tile < 0 && i < work->num_thread; i++)
+    {
+        victim = (worker_id + i) % work->num_thread;
+        deque = &work->deques[victim];
+        pthread_mutex_lock(&deque->lock);
+        if (deque->bottom > deque->top)
+        {
+            tile = deque->tiles[deque->top++];
+        }
+        pthread_mutex_unlock(&deque->lock);
+    }
+    return tile;
+}
+
+/* align_tile:
+ * align all the pairs of one tile in a single batch,
+ * with the scratch space of the kernel from arena */
+static void align_tile(Pool_Work *work, int tile,
+                       char **refs, char **queries, float *scores,
+                       Arena *arena)
+{
+    int first_row = (tile / work->num_tile_col) * work->tile_size;
+    int first_col = (tile % work->num_tile_col) * work->tile_size;
+    int last_row = first_row + work->tile_size;
+    int last_col = first_col + work->tile_size;
+    last_row = (last_row < work->pool_size) ? last_row : work->pool_size;
+    last_col = (last_col < work->pool_size) ? last_col : work->pool_size;
+    int num_pair = 0;
+    int i, j;
+    for (i = first_row; i < last_row; i++)
+    {
+        for (j = first_col; j < last_col; j++)
+        {
+            refs[num_pair] = pool[i];
+            queries[num_pair] = work->queries[j];
+            num_pair++;
+        }
+    }
+    swalign_batch_arena(refs, queries, num_pair, work->score_param,
+                        scores, arena);
+    num_pair = 0;
+    for (i = first_row; i < last_row; i++)
+    {
+        for (j = first_col; j < last_col; j++)
+        {
+            interaction_matrix[i][j] = scores[num_pair++];
+        }
+    }
+}
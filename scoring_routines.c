@@ -27,7 +27,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include "swnn2.h"
+#include "swnn.h"
 
 /****************************************************************************
  * Routine for initialisation of the sw_matrix and processing the last row
@@ -35,48 +35,57 @@
  ***************************************************************************/
 
 
-
-SW_Entry **initiate_duplex_matrix(char *ref, char *query)
+/* initialise_duplex_matrix:
+ * allocate the matrix of the encoded ref (ncol codes, horizontal) and
+ * query (nrow codes, vertical) and fill its first row and first column.
+ * The lengths are those of the sequences before encoding: the codes
+ * have no string length, CODE_A is 0. */
+SW_Entry **initialise_duplex_matrix(unsigned char *ref, unsigned char *query,
+                                    int nrow, int ncol)
 {
-    int nrow = strlen(query);
-    int ncol = strlen(ref);
     SW_Entry **sw_matrix = _allocate_matrix(nrow, ncol);
     sw_matrix[0][0] = _handle_first_entry(ref[0], query[0]);
     register int i, j;
     Neighbour nn_config;
     for (i = 0, j = 1; j < ncol; j++)
     {
-        nn_config = {ref[j -1], ref[j],
-                     '.', query[i]};
+        nn_config = (Neighbour) {ref[j -1], ref[j],
+                                 CODE_DOT, query[i]};
         sw_matrix[i][j] = _handle_init_row_col(nn_config);
     }
     for (i = 1, j = 0; i < nrow; i++)
     {
-        nn_config = {'.', ref[j],
-                     query[i -1], query[i]};
+        nn_config = (Neighbour) {CODE_DOT, ref[j],
+                                 query[i -1], query[i]};
         sw_matrix[i][j] = _handle_init_row_col(nn_config);
     }
+    return sw_matrix;
 }
 
 
     
+/* _allocate_matrix:
+ * the row pointers and the rows in a single block, released
+ * with one free() of the matrix */
 SW_Entry **_allocate_matrix(int nrow, int ncol)
 {
     register int i;
-    SW_Entry **sw_matrix = malloc(sizeof(SW_Entry *) * nrow);
-    for (i = 0; i < ncol; i++)
-    {
-        sw_matrix[i] = mallow(sizeof(SW_Entry) * ncol);
-    }
+    SW_Entry **sw_matrix = malloc(sizeof(SW_Entry *) * nrow +
+                                  sizeof(SW_Entry) * nrow * ncol);
     if (sw_matrix == NULL)
     {
         fprintf(stderr, "swnn: memory allocation error");
         exit(EXIT_FAILURE);
     }
+    SW_Entry *entries = (SW_Entry *) (sw_matrix + nrow);
+    for (i = 0; i < nrow; i++)
+    {
+        sw_matrix[i] = entries + (size_t) i * ncol;
+    }
     return sw_matrix;
 }
 
-SW_Entry _handle_first_entry(char first_ref, char first_query)
+SW_Entry _handle_first_entry(unsigned char first_ref, unsigned char first_query)
 {
     // handle first row first column where there is no dangling end.
     // This entry, like the rest, has 3 "current_decisions".
@@ -84,20 +93,19 @@ SW_Entry _handle_first_entry(char first_ref, char first_query)
     // set to 0 delG and loop len. 
     // if the first pair is a mismatch, there is no "initiation energy"
     // and the loop len is 1.
-    // otherwise, we add either "init_GC" or "init_AT".
+    // otherwise, we add the initiation (init_GC or init_AT, see init_delG()).
     SW_Entry first_entry;
-    int loop_len = (is_complement(first_ref, first_query)) ? 0 : 1;
-    first_entry.top_bulge = {0.0, STOP, TOP_BULGE, loop_len, loop_len};
-    first_entry.bottom_bulge = {0.0, STOP, BOTTOM_BULGE, loop_len, loop_len};
+    int loop_len = (IS_COMPLEMENT(first_ref, first_query)) ? 0 : 1;
+    first_entry.top_bulge = (Decision_Record) {0.0, STOP, TOP_BULGE, loop_len, loop_len};
+    first_entry.bottom_bulge = (Decision_Record) {0.0, STOP, BOTTOM_BULGE, loop_len, loop_len};
     if (loop_len == 1)
     {// if they are not complement
-        first_entry.bind = {0.0, STOP, MISMATCH, loop_len, loop_len};
+        first_entry.bind = (Decision_Record) {0.0, STOP, MISMATCH, loop_len, loop_len};
     } else
     {
-        Therm_Param init_parameter = (first_ref == 'G' || first_ref == 'C') ? 
-                                     GLOBAL_init_GC : GLOBAL_init_AT;
-        first_entry.bind = {init_delG(first_ref), STOP, MATCH, loop_len, loop_len}
+        first_entry.bind = (Decision_Record) {init_delG(first_ref), STOP, MATCH, loop_len, loop_len};
     }
+    first_entry.stop = (Decision_Record) {0.0, STOP, STOP, 0, 0};
     return first_entry;
 }
 
@@ -105,36 +113,26 @@ SW_Entry _handle_init_row_col(Neighbour nn_config)
 {
     SW_Entry result_entry;
     float delG;
-    int has_complement = (is_complement(nn_config.top5, nn_config.bottom3) ||
-                          is_complement(nn_config.top3, nn_config.bottom5)) ?
+    int has_complement = (IS_COMPLEMENT(nn_config.top5, nn_config.bottom3) ||
+                          IS_COMPLEMENT(nn_config.top3, nn_config.bottom5)) ?
                          0 : 1;
     int loop_len = (has_complement) ? 0:1;
     if (has_complement)
     {
-        delG = get_delG_terminal(nn_config) + init_delG(nn_config(top3));
+        delG = get_delG_terminal(nn_config) + init_delG(nn_config.top3);
         // the choice of top3 can be replace by bottom5 since
         // the left dangling end always have that 2 matched up
-        result_entry.bind = {delG, STOP, MATCH, loop_len, loop_len};
+        result_entry.bind = (Decision_Record) {delG, STOP, MATCH, loop_len, loop_len};
     } else
     {
-        result_entry.bind = {0.0, STOP, MATCH, loop_len, loop_len};
+        result_entry.bind = (Decision_Record) {0.0, STOP, MATCH, loop_len, loop_len};
     }
-    result_entry.top_bulge = {0.0, STOP, TOP_BULGE, loop_len, loop_len};
-    result_entry.bottom_bulge = {0.0, STOP, BOTTOM_BULGE, loop_len, loop_len};
+    result_entry.top_bulge = (Decision_Record) {0.0, STOP, TOP_BULGE, loop_len, loop_len};
+    result_entry.bottom_bulge = (Decision_Record) {0.0, STOP, BOTTOM_BULGE, loop_len, loop_len};
+    result_entry.stop = (Decision_Record) {0.0, STOP, STOP, 0, 0};
     return result_entry;
 }
 
-SW_Entry **process_last_row_col(SW_Entry sw_matrix, char *ref, char *query)
-{
-    int nrow = strlen(ref);
-    int ncol = strlen(query);
-    register int i, j;
-
-
-
-
-
-
 
 
 /****************************************************************************
@@ -156,11 +154,26 @@ SW_Entry **process_last_row_col(SW_Entry sw_matrix, char *ref, char *query)
  */
 Decision_Record score_bind(SW_Entry **sw_matrix,
                            int row, int col,
-                           char *ref, char *query)
+                           unsigned char *ref, unsigned char *query)
 {
     SW_Entry prev_entry = sw_matrix[row-1][col -1];
+    return bind_continuation(prev_entry.bind,
+                             prev_entry.top_bulge,
+                             prev_entry.bottom_bulge,
+                             row, col, ref, query);
+}
+
+/* bind_continuation:
+ * the work of score_bind() given only the 3 records
+ * of the previous (diagonal) entry it depends on. */
+Decision_Record bind_continuation(Decision_Record prev_bind,
+                                  Decision_Record prev_top_bulge,
+                                  Decision_Record prev_bottom_bulge,
+                                  int row, int col,
+                                  unsigned char *ref, unsigned char *query)
+{
     Decision_Record prev_decision_record;
-    char current_decision = (is_complement(query[row], ref[col])) ? 'M' : 'X';
+    char current_decision = (IS_COMPLEMENT(query[row], ref[col])) ? 'M' : 'X';
     Decision_Record continue_from_bind = {0, MATCH, current_decision, 0, 0};
     Decision_Record continue_from_top_bulge = {0, TOP_BULGE, current_decision, 0, 0};
     Decision_Record continue_from_bottom_bulge = {0, BOTTOM_BULGE, current_decision, 0, 0};
@@ -179,7 +192,7 @@ Decision_Record score_bind(SW_Entry **sw_matrix,
     //     -> current binding is a mismatch: another 2 subcases
     //         => previous mismatch is single: backtrack the delG addition and add on loop penalty instead
     //         => previous mismatch part of loop: loop penalty
-    prev_decision_record = prev_entry.bind;
+    prev_decision_record = prev_bind;
     switch (prev_decision_record.current_decision)
     {
         case (MATCH): // continue from previous match
@@ -216,14 +229,14 @@ Decision_Record score_bind(SW_Entry **sw_matrix,
                               continue_from_bind.delG = prev_decision_record.delG \
                                                         + internal_loop_score(continue_from_bind.top_loop_len,
                                                                               continue_from_bind.bottom_loop_len);
-                              }
                           }
                           break;
-                   default:
-                   fprintf(stderr, "Neither MATCH nor MISMATCH at bind record");
-                   exit(EXIT_FAILURE);
                }
             }
+            break;
+        default:
+            fprintf(stderr, "Neither MATCH nor MISMATCH at bind record");
+            exit(EXIT_FAILURE);
     }
     // now handle continuing from previous top_bulge:
     // previously, we add 1 to top_loop_len while none to bottom_loop_len,
@@ -235,7 +248,7 @@ Decision_Record score_bind(SW_Entry **sw_matrix,
     // we might remain in a bulge or continue a previous internal loop,
     // but since both case assume current base is a match, we do nothing
     // except carry the record over. 
-    prev_decision_record = prev_entry.top_bulge;
+    prev_decision_record = prev_top_bulge;
     switch (current_decision)
     {
         case (MATCH):
@@ -253,7 +266,7 @@ Decision_Record score_bind(SW_Entry **sw_matrix,
     }
     // now handle continuing from previous bottom_bulge,
     // the resoning is the same as continuing from top_bulge. 
-    prev_decision_record = prev_entry.bottom_bulge;
+    prev_decision_record = prev_bottom_bulge;
     switch (current_decision)
     {
         case (MATCH):
@@ -285,9 +298,24 @@ Decision_Record score_bind(SW_Entry **sw_matrix,
  */
 Decision_Record score_top_bulge(SW_Entry **sw_matrix, 
                                 int row, int col,
-                                char *ref, char *query)
+                                unsigned char *ref, unsigned char *query)
 {
     SW_Entry prev_entry = sw_matrix[row][col -1];
+    // !! the continuation from a top_bulge has always been
+    // !! evaluated on the bottom_bulge record of prev_entry.
+    return top_bulge_continuation(prev_entry.bind,
+                                  prev_entry.bottom_bulge,
+                                  row, col, ref, query);
+}
+
+/* top_bulge_continuation:
+ * the work of score_top_bulge() given only the records
+ * of the previous (left) entry it depends on. */
+Decision_Record top_bulge_continuation(Decision_Record prev_bind,
+                                       Decision_Record prev_bulge,
+                                       int row, int col,
+                                       unsigned char *ref, unsigned char *query)
+{
     Decision_Record previous_decision_record;
     Decision_Record continue_from_bind = {0, MATCH, TOP_BULGE, 0, 0};
     Decision_Record continue_from_top_bulge = {0, TOP_BULGE, TOP_BULGE, 0, 0};
@@ -305,7 +333,7 @@ Decision_Record score_top_bulge(SW_Entry **sw_matrix,
     //     -> previous mismatch is single: need to backtrack previous delG addition
     //                                     then extend to form internal loop
     //     -> previous mismatch part of loop: continue the internal loop
-    previous_decision_record = prev_entry.bind;
+    previous_decision_record = prev_bind;
     if (previous_decision_record.current_decision == MATCH)
     {
         continue_from_bind.top_loop_len = 1; // increment from previous 0
@@ -329,12 +357,11 @@ Decision_Record score_top_bulge(SW_Entry **sw_matrix,
         continue_from_bind.delG = previous_decision_record.delG \
                                   + internal_loop_score(continue_from_bind.top_loop_len,
                                                         continue_from_bind.bottom_loop_len);
-        }
     }
     // now handle continue from previous top_bulge: 2 cases
     // previous bulge has size 1: need to backtrack the special size one intervening delG addition
     // previous bulge size > 1: simply extend bulge size.
-    previous_decision_record = prev_entry.bottom_bulge;
+    previous_decision_record = prev_bulge;
     if (previous_decision_record.bottom_loop_len == 1 && previous_decision_record.top_loop_len == 0)
     {
         /* neighbour configuration:
@@ -384,9 +411,22 @@ Decision_Record score_top_bulge(SW_Entry **sw_matrix,
  */
 Decision_Record score_bottom_bulge(SW_Entry **sw_matrix, 
                                 int row, int col,
-                                char *ref, char *query)
+                                unsigned char *ref, unsigned char *query)
 {
     SW_Entry prev_entry = sw_matrix[row -1][col];
+    return bottom_bulge_continuation(prev_entry.bind,
+                                     prev_entry.bottom_bulge,
+                                     row, col, ref, query);
+}
+
+/* bottom_bulge_continuation:
+ * the work of score_bottom_bulge() given only the records
+ * of the previous (upper) entry it depends on. */
+Decision_Record bottom_bulge_continuation(Decision_Record prev_bind,
+                                          Decision_Record prev_bulge,
+                                          int row, int col,
+                                          unsigned char *ref, unsigned char *query)
+{
     Decision_Record previous_decision_record;
     Decision_Record continue_from_bind = {0, MATCH, BOTTOM_BULGE, 0, 0};
     Decision_Record continue_from_bottom_bulge = {0, BOTTOM_BULGE, BOTTOM_BULGE, 0, 0};
@@ -402,7 +442,7 @@ Decision_Record score_bottom_bulge(SW_Entry **sw_matrix,
     //     -> previous mismatch is single: need to backtrack previous delG addition
     //                                     then extend to form internal loop
     //     -> previous mismatch part of loop: continue the internal loop
-    previous_decision_record = prev_entry.bind;
+    previous_decision_record = prev_bind;
     if (previous_decision_record.current_decision == MATCH)
     {
         continue_from_bind.bottom_loop_len = 1;
@@ -425,12 +465,11 @@ Decision_Record score_bottom_bulge(SW_Entry **sw_matrix,
         continue_from_bind.delG = previous_decision_record.delG \
                                   + internal_loop_score(continue_from_bind.top_loop_len,
                                                         continue_from_bind.bottom_loop_len);
-        }
     }
     // now handle continue from previous bottom_bulge: 2 cases
     // previous bulge has size 1: need to backtrack the special size one intervening delG addition
     // previous bulge size > 1: simply extend bulge size.
-    previous_decision_record = prev_entry.bottom_bulge;
+    previous_decision_record = prev_bulge;
     if (previous_decision_record.bottom_loop_len == 1 && previous_decision_record.top_loop_len == 0)
     {
         /* neighbour configuration:
@@ -488,10 +527,24 @@ Decision_Record score_bottom_bulge(SW_Entry **sw_matrix,
  */
 Decision_Record score_stop(SW_Entry **sw_matrix, 
                            int row, int col,
-                           char *ref, char *query)
+                           unsigned char *ref, unsigned char *query)
 {
     SW_Entry prev_entry = sw_matrix[row -1][col -1];
-    Decision_Record previous_decision_record;
+    return stop_continuation(prev_entry.bind,
+                             prev_entry.top_bulge,
+                             prev_entry.bottom_bulge,
+                             row, col, ref, query);
+}
+
+/* stop_continuation:
+ * the work of score_stop() given only the 3 records
+ * of the previous (diagonal) entry it depends on. */
+Decision_Record stop_continuation(Decision_Record prev_bind,
+                                  Decision_Record prev_top_bulge,
+                                  Decision_Record prev_bottom_bulge,
+                                  int row, int col,
+                                  unsigned char *ref, unsigned char *query)
+{
     Decision_Record continue_from_bind = {0, MATCH, STOP, 0, 0};
     Decision_Record continue_from_top_bulge = {0, TOP_BULGE, STOP, 0, 0};
     Decision_Record continue_from_bottom_bulge = {0, BOTTOM_BULGE, STOP, 0, 0};
@@ -513,18 +566,18 @@ Decision_Record score_stop(SW_Entry **sw_matrix,
     //
     // Scheme 2: not counted as terminal.
     // In all cases, do nothing. (we will use this first ... )
-    continue_from_bind.previous_decision = prev_entry.bind.current_decision;
-    continue_from_bind.delG = prev_entry.bind.delG;
+    continue_from_bind.previous_decision = prev_bind.current_decision;
+    continue_from_bind.delG = prev_bind.delG;
 
     // handle continue from previous top_bulge.
     // !!! SAME SITUATION AS ABOVE.
     continue_from_top_bulge.previous_decision = TOP_BULGE;
-    continue_from_top_bulge.delG = prev_entry.top_bulge.delG;
+    continue_from_top_bulge.delG = prev_top_bulge.delG;
     
     // handle continue from previus bottom_bugle.
     // !!! SAME AS ABOVE
     continue_from_bottom_bulge.previous_decision = BOTTOM_BULGE;
-    continue_from_bottom_bulge.delG = prev_entry.bottom_bulge.delG;
+    continue_from_bottom_bulge.delG = prev_bottom_bulge.delG;
 
     Decision_Record three_continuation_records[] = {continue_from_bind,
                                                     continue_from_top_bulge,
@@ -0,0 +1,34 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/* Instruction set levels of the DP kernels, from the narrowest up.
+ * simd_level() is the widest one the host runs, probed with cpuid the
+ * first time it is asked for, unless the environment variable
+ * SIMD_LEVEL_ENV names another ("scalar", "sse2", "avx2", "avx512"),
+ * which is how a level is forced for testing. A forced level the host
+ * can't run is lowered to the host's, with a warning.
+ * Shared by swinc and swnn, which bind their kernels to the level
+ * once (see swinc_kernels() and duplex_kernels()). */
+enum
+{
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    NUM_SIMD_LEVEL
+};
+#define SIMD_LEVEL_ENV "SWINC_SIMD"
+
+/* the kernels wider than the build flags are compiled with target
+ * attributes, where the compiler can do so */
+#if defined(__SSE2__) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SIMD_WIDE_KERNELS
+#endif
+
+int simd_level(void);
+int detect_simd_level(void);
+int parse_simd_level(const char *name);
+const char *simd_level_name(int level);
+
+#endif /* SIMD_H */
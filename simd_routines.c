@@ -0,0 +1,97 @@
+/************************** SIMD ROUTINES **********************************
+ * The instruction set level the kernels are bound to (see simd.h).
+ *
+ * The level is worked out once per process, under pthread_once(), so
+ * that kernels bound lazily from several threads agree on it.
+ * __builtin_cpu_supports() also checks that the OS saves the wider
+ * registers, a CPU with AVX-512 under an OS that doesn't is AVX2.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "simd.h"
+
+static const char *level_names[NUM_SIMD_LEVEL] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+static int bound_level = SIMD_SCALAR;
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+
+static void bind_level(void);
+
+
+/* simd_level: the level the kernels should use, see simd.h */
+int simd_level(void)
+{
+    pthread_once(&level_once, bind_level);
+    return bound_level;
+}
+
+/* detect_simd_level: the widest level the host runs */
+int detect_simd_level(void)
+{
+#ifdef SIMD_WIDE_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SIMD_SSE2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+/* parse_simd_level: the level called name, -1 if there is none */
+int parse_simd_level(const char *name)
+{
+    int level;
+    for (level = 0; level < NUM_SIMD_LEVEL; level++)
+    {
+        if (strcmp(name, level_names[level]) == 0)
+        {
+            return level;
+        }
+    }
+    return -1;
+}
+
+const char *simd_level_name(int level)
+{
+    return (level >= 0 && level < NUM_SIMD_LEVEL) ? level_names[level] : "unknown";
+}
+
+
+/* bind_level: the host's level, or the one forced by SIMD_LEVEL_ENV */
+static void bind_level(void)
+{
+    int host_level = detect_simd_level();
+    const char *forced = getenv(SIMD_LEVEL_ENV);
+    bound_level = host_level;
+    if (forced == NULL || forced[0] == '\0')
+    {
+        return;
+    }
+    int level = parse_simd_level(forced);
+    if (level < 0)
+    {
+        fprintf(stderr, "warning: %s=%s is not scalar, sse2, avx2 or avx512,"
+                " using %s\n", SIMD_LEVEL_ENV, forced, level_names[host_level]);
+    }else if (level > host_level)
+    {
+        fprintf(stderr, "warning: %s=%s is not supported by this host,"
+                " using %s\n", SIMD_LEVEL_ENV, forced, level_names[host_level]);
+    }else
+    {
+        bound_level = level;
+    }
+}
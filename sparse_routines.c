@@ -0,0 +1,220 @@
+/************************ SPARSE POOL ROUTINES ******************************
+ * Pool alignment that streams out the entries of the interaction matrix
+ * worth looking at instead of filling interaction_matrix.
+ *
+ * The matrix is produced one row at a time (one primer against the
+ * reverse complements of the whole pool, in one swalign_batch() call)
+ * and a row is forgotten as soon as it has been filtered:
+ *   - every entry scoring at least filter.threshold is written out as
+ *     it is found,
+ *   - the filter.top_k best entries of the row are kept in a min-heap
+ *     and those that were not already written out follow at the end
+ *     of the row.
+ * Memory is linear in the size of the pool (its reverse complements and
+ * one row of scores, the scratch of the kernel in an arena reset after
+ * every row), so the primers are held in a growing array rather
+ * than in pool[] and the pool isn't bounded by MAX_POOL_SIZE.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+static int is_better_hit(Pool_Hit hit1, Pool_Hit hit2);
+static void sift_down(Pool_Hit *heap, int heap_size, int index);
+static void offer_hit(Pool_Hit *heap, int *heap_size, int top_k, Pool_Hit hit);
+static void write_hit(FILE *outfile, Pool_Hit hit);
+
+
+/* align_pool_sparse:
+ * align primers[i] to rc(primers[j]) for all i != j and write out,
+ * row after row, the entries kept by filter (see Sparse_Filter).
+ * Each line holds ref_index, query_index and score separated by tabs.
+ * Return the number of entries written. */
+long align_pool_sparse(char **primers, int num_primer,
+                       Score_Param score_param, Sparse_Filter filter,
+                       FILE *outfile)
+{
+    int top_k = (filter.top_k > 0) ? filter.top_k : 0;
+    char **queries = allocate(sizeof(char *) * (num_primer +1));
+    char **refs = allocate(sizeof(char *) * (num_primer +1));
+    float *scores = allocate(sizeof(float) * (num_primer +1));
+    Pool_Hit *heap = allocate(sizeof(Pool_Hit) * (top_k +1));
+    Arena *arena = create_arena(0);
+    int heap_size;
+    long num_written = 0;
+    int i, j;
+    Pool_Hit hit;
+
+    for (j = 0; j < num_primer; j++)
+    {
+        queries[j] = rev_complement(primers[j], KMER_SIZE);
+    }
+    for (i = 0; i < num_primer; i++)
+    {
+        for (j = 0; j < num_primer; j++)
+        {
+            refs[j] = primers[i];
+        }
+        swalign_batch_arena(refs, queries, num_primer, score_param,
+                            scores, arena);
+        arena_reset(arena);
+        heap_size = 0;
+        for (j = 0; j < num_primer; j++)
+        {
+            if (j == i)
+            {// no self-alignment, as in align_pool()
+                continue;
+            }
+            hit = (Pool_Hit) {i, j, scores[j]};
+            if (hit.score >= filter.threshold)
+            {
+                write_hit(outfile, hit);
+                num_written++;
+            }
+            offer_hit(heap, &heap_size, top_k, hit);
+        }
+        // the heap empties worst first, those above threshold are out already
+        while (heap_size > 0)
+        {
+            if (heap[0].score < filter.threshold)
+            {
+                write_hit(outfile, heap[0]);
+                num_written++;
+            }
+            heap[0] = heap[--heap_size];
+            sift_down(heap, heap_size, 0);
+        }
+    }
+
+    for (j = 0; j < num_primer; j++)
+    {
+        free(queries[j]);
+    }
+    free(queries);
+    free(refs);
+    free(scores);
+    free(heap);
+    free_arena(arena);
+    return num_written;
+}
+
+
+/* read_primers:
+ * get_primers() into an array that grows with the file instead of
+ * pool[]. Lines are read whole, however long, and blank lines are
+ * skipped. The number of primers is written into num_primer. The
+ * primers should be released with free_primers(). */
+char **read_primers(char *filename, int *num_primer)
+{
+    INSTRUMENT_START(parse_timer);
+    FILE *file_handle = fopen(filename, "r");
+    if (file_handle == NULL)
+    {
+        fprintf(stderr, "%s error:\nCannot open %s\n", PROGRAM_NAME, filename);
+        exit(EXIT_FAILURE);
+    }
+    int capacity = 64;
+    int count = 0;
+    char **primers = allocate(sizeof(char *) * capacity);
+    char *line = NULL;
+    size_t line_capacity = 0;
+    char *temp;
+    while (getline(&line, &line_capacity, file_handle) != -1)
+    {
+        temp = trim_whitespace(line); // remove left and right whitespaces
+        if (*temp == '\0')
+        {
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            primers = realloc(primers, sizeof(char *) * capacity);
+            if (primers == NULL)
+            {
+                error_handle(ERROR_MEM_ALLOC);
+                exit(ERROR_MEM_ALLOC);
+            }
+        }
+        primers[count] = allocate(strlen(temp) +1);
+        strcpy(primers[count], temp);
+        count++;
+    }
+    free(line);
+    fclose(file_handle);
+    *num_primer = count;
+    INSTRUMENT_PHASE(PHASE_PARSE, parse_timer);
+    return primers;
+}
+
+void free_primers(char **primers, int num_primer)
+{
+    int i;
+    for (i = 0; i < num_primer; i++)
+    {
+        free(primers[i]);
+    }
+    free(primers);
+}
+
+
+/* is_better_hit:
+ * higher score first, the lower query_index on ties
+ * so that the kept entries don't depend on the heap. */
+static int is_better_hit(Pool_Hit hit1, Pool_Hit hit2)
+{
+    if (hit1.score != hit2.score)
+    {
+        return hit1.score > hit2.score;
+    }
+    return hit1.query_index < hit2.query_index;
+}
+
+/* sift_down: restore the min-heap below index, worst hit on top */
+static void sift_down(Pool_Hit *heap, int heap_size, int index)
+{
+    int child;
+    Pool_Hit temp;
+    while ((child = 2 * index +1) < heap_size)
+    {
+        if (child +1 < heap_size && is_better_hit(heap[child], heap[child +1]))
+        {
+            child++;
+        }
+        if (!is_better_hit(heap[index], heap[child]))
+        {
+            break;
+        }
+        temp = heap[index];
+        heap[index] = heap[child];
+        heap[child] = temp;
+        index = child;
+    }
+}
+
+/* offer_hit: keep hit if it is among the top_k best seen so far */
+static void offer_hit(Pool_Hit *heap, int *heap_size, int top_k, Pool_Hit hit)
+{
+    int index, parent;
+    if (*heap_size < top_k)
+    {// sift up
+        index = (*heap_size)++;
+        while (index > 0 && is_better_hit(heap[parent = (index -1) / 2], hit))
+        {
+            heap[index] = heap[parent];
+            index = parent;
+        }
+        heap[index] = hit;
+    }else if (top_k > 0 && is_better_hit(hit, heap[0]))
+    {
+        heap[0] = hit;
+        sift_down(heap, *heap_size, 0);
+    }
+}
+
+static void write_hit(FILE *outfile, Pool_Hit hit)
+{
+    fprintf(outfile, "%d\t%d\t%.4f\n", hit.ref_index, hit.query_index, hit.score);
+}
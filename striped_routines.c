@@ -0,0 +1,367 @@
+/************************ STRIPED SW ROUTINES *******************************
+ * Score-only version of the swinc aligner using Farrar's striped layout
+ * (Farrar, M, "Striped Smith-Waterman speeds database searches six times
+ * over other SIMD implementations", Bioinformatics 23(2), 2007).
+ *
+ * The recurrence is exactly the one of fill_matrix() with
+ * row = query position, col = ref position:
+ *   M[row][col] = max(M, I, D)[row-1][col-1] + match or mismatch
+ *   I[row][col] = max(I[row-1][col] + gap_extension,
+ *                     M[row-1][col] + gap_open)
+ *   D[row][col] = max(D[row][col-1] + gap_extension,
+ *                     M[row][col-1] + gap_open)
+ * with all 3 records of the first row and first column set to 0.
+ * The best score is the maximum of max(M, I, D) over the matrix (or 0).
+ *
+ * The query runs down the vector, the ref is walked one column
+ * at a time. I (the vertical gap) is the only state with a
+ * dependency inside a column, it is first computed segment by
+ * segment and then fixed up by the "lazy-F" loop which carries
+ * the last segment over into the next lane until nothing changes.
+ * Since every cell is computed with the same additions and
+ * comparisons as the scalar path, the scores are identical.
+ *
+ * swalign_striped() keeps the profile of the last query of each thread
+ * (in thread specific data, released when the thread exits): the same
+ * query aligned to many refs has its profile built once, and a new
+ * query is built into the storage of the last one, so that swalign()
+ * doesn't go to the heap once the profile has grown to its queries.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "swinc.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+#define VECTOR_ALIGNMENT 16
+
+/* the profile swalign_striped() keeps for a thread, and a copy
+ * of the query it was built from */
+typedef struct {
+    Query_Profile *profile;
+    char *query;
+    size_t query_capacity;
+} Profile_Cache;
+
+static pthread_key_t profile_cache_key;
+static pthread_once_t profile_cache_once = PTHREAD_ONCE_INIT;
+
+static Query_Profile *cached_query_profile(char *query, Score_Param score_param);
+static void create_profile_cache_key(void);
+static void free_profile_cache(void *cache);
+static int same_score_param(Score_Param param1, Score_Param param2);
+static float *allocate_vectors(int num_vector);
+static __m128 shift_in(__m128 vector, __m128 lane0_value);
+
+
+/* init_query_profile:
+ * build the striped profile of query for the given scoring parameters.
+ * Positions beyond the end of the query are given -INFINITY so that
+ * the padding never contributes to a real cell. */
+Query_Profile *init_query_profile(char *query, Score_Param score_param)
+{
+    return build_query_profile(NULL, query, score_param);
+}
+
+/* build_query_profile:
+ * init_query_profile() into profile, whose storage is kept if it's
+ * large enough and grown otherwise. A new profile if profile is NULL. */
+Query_Profile *build_query_profile(Query_Profile *profile, char *query,
+                                   Score_Param score_param)
+{
+    if (profile == NULL)
+    {
+        profile = allocate(sizeof(Query_Profile));
+        profile->scores = NULL;
+        profile->columns = NULL;
+        profile->score_capacity = 0;
+        profile->column_capacity = 0;
+    }
+    int query_len = strlen(query);
+    int seg_len = (query_len + STRIPED_LANES -1) / STRIPED_LANES;
+    if (seg_len == 0)
+    {
+        seg_len = 1;
+    }
+    profile->query_len = query_len;
+    profile->seg_len = seg_len;
+    profile->score_param = score_param;
+
+    // block 0 is shared by all bases absent from the query
+    int i, lane, seg;
+    memset(profile->symbol_index, 0, sizeof(profile->symbol_index));
+    char symbols[256];
+    int num_symbol = 1;
+    for (i = 0; i < query_len; i++)
+    {
+        unsigned char base = query[i];
+        if (profile->symbol_index[base] == 0)
+        {
+            profile->symbol_index[base] = num_symbol;
+            symbols[num_symbol] = query[i];
+            num_symbol++;
+        }
+    }
+    profile->num_symbol = num_symbol;
+    if (num_symbol * seg_len > profile->score_capacity)
+    {
+        _mm_free(profile->scores);
+        profile->score_capacity = num_symbol * seg_len;
+        profile->scores = allocate_vectors(profile->score_capacity);
+    }
+    if (PROFILE_COLUMNS * seg_len > profile->column_capacity)
+    {
+        _mm_free(profile->columns);
+        profile->column_capacity = PROFILE_COLUMNS * seg_len;
+        profile->columns = allocate_vectors(profile->column_capacity);
+    }
+
+    int symbol;
+    float *block;
+    for (symbol = 0; symbol < num_symbol; symbol++)
+    {
+        block = profile->scores + symbol * seg_len * STRIPED_LANES;
+        for (seg = 0; seg < seg_len; seg++)
+        {
+            for (lane = 0; lane < STRIPED_LANES; lane++)
+            {
+                i = lane * seg_len + seg;
+                if (i >= query_len)
+                {
+                    block[seg * STRIPED_LANES + lane] = -INFINITY;
+                } else if (symbol != 0 && query[i] == symbols[symbol])
+                {
+                    block[seg * STRIPED_LANES + lane] = score_param.match_score;
+                } else
+                {
+                    block[seg * STRIPED_LANES + lane] = score_param.mismatch_penalty;
+                }
+            }
+        }
+    }
+    return profile;
+}
+
+void free_query_profile(Query_Profile *profile)
+{
+    _mm_free(profile->scores);
+    _mm_free(profile->columns);
+    free(profile);
+}
+
+
+/* swalign_striped:
+ * score-only equivalent of swalign() through the striped kernel,
+ * with the profile the thread kept of query if it was the last. */
+float swalign_striped(char *ref, char *query, Score_Param score_param)
+{
+    return swalign_profile(ref, cached_query_profile(query, score_param));
+}
+
+
+/* swalign_profile:
+ * return the best alignment score of ref against the query
+ * the profile was built from. The profile can be reused for
+ * any number of refs, by one thread at a time since the
+ * columns of the DP live in the profile. */
+float swalign_profile(char *ref, Query_Profile *profile)
+{
+    int ref_len = strlen(ref);
+    int seg_len = profile->seg_len;
+    if (ref_len == 0 || profile->query_len == 0)
+    {
+        return 0.0;
+    }
+    INSTRUMENT_START(fill_timer);
+    // H of previous and current column, M of previous column, D.
+    int column_size = seg_len * STRIPED_LANES;
+    float *h_store = profile->columns;
+    float *h_load = h_store + column_size;
+    float *m_store = h_load + column_size;
+    float *m_load = m_store + column_size;
+    float *d_column = m_load + column_size;
+    float *f_column = d_column + column_size;
+    float *temp;
+    // padding must not be picked up as the best score
+    float *valid = f_column + column_size;
+
+    register int col, seg;
+    int lane;
+    for (seg = 0; seg < seg_len; seg++)
+    {
+        for (lane = 0; lane < STRIPED_LANES; lane++)
+        {
+            valid[seg * STRIPED_LANES + lane] =
+                (lane * seg_len + seg < profile->query_len) ? 0.0 : -INFINITY;
+        }
+        // the first column is null entries
+        _mm_store_ps(h_load + seg * STRIPED_LANES, _mm_setzero_ps());
+        _mm_store_ps(m_load + seg * STRIPED_LANES, _mm_setzero_ps());
+        _mm_store_ps(d_column + seg * STRIPED_LANES, _mm_setzero_ps());
+    }
+
+    const __m128 v_gap_open = _mm_set1_ps(profile->score_param.gap_open_penalty);
+    const __m128 v_gap_extension = _mm_set1_ps(profile->score_param.gap_extension_penalty);
+    const __m128 v_neg_inf = _mm_set1_ps(-INFINITY);
+    // the null entry in the first row: I = max(0 + extension, 0 + open)
+    const __m128 v_first_row_f = shift_in(v_neg_inf,
+                                 _mm_max_ps(_mm_add_ps(_mm_setzero_ps(), v_gap_extension),
+                                            _mm_add_ps(_mm_setzero_ps(), v_gap_open)));
+    __m128 v_best = _mm_setzero_ps();
+    __m128 v_h, v_m, v_d, v_f, v_carry;
+    const float *block;
+
+    for (col = 0; col < ref_len; col++)
+    {
+        block = profile->scores + \
+                profile->symbol_index[(unsigned char) ref[col]] * seg_len * STRIPED_LANES;
+        // diagonal of the first segment comes from the last segment,
+        // the first row (all zeros) being shifted into lane 0.
+        v_h = shift_in(_mm_load_ps(h_load + (seg_len -1) * STRIPED_LANES),
+                       _mm_setzero_ps());
+        v_f = v_first_row_f;
+        for (seg = 0; seg < seg_len; seg++)
+        {
+            v_m = _mm_add_ps(v_h, _mm_load_ps(block + seg * STRIPED_LANES));
+            v_d = _mm_max_ps(_mm_add_ps(_mm_load_ps(d_column + seg * STRIPED_LANES),
+                                        v_gap_extension),
+                             _mm_add_ps(_mm_load_ps(m_load + seg * STRIPED_LANES),
+                                        v_gap_open));
+            _mm_store_ps(d_column + seg * STRIPED_LANES, v_d);
+            _mm_store_ps(m_store + seg * STRIPED_LANES, v_m);
+            _mm_store_ps(f_column + seg * STRIPED_LANES, v_f);
+            _mm_store_ps(h_store + seg * STRIPED_LANES,
+                         _mm_max_ps(_mm_max_ps(v_m, v_f), v_d));
+            // I of the next segment
+            v_f = _mm_max_ps(_mm_add_ps(v_f, v_gap_extension),
+                             _mm_add_ps(v_m, v_gap_open));
+            v_h = _mm_load_ps(h_load + seg * STRIPED_LANES);
+        }
+
+        // lazy-F: carry I of the last segment into the next lane
+        // and propagate it for as long as it improves anything.
+        v_carry = shift_in(v_f, v_neg_inf);
+        seg = 0;
+        v_f = _mm_load_ps(f_column);
+        while (_mm_movemask_ps(_mm_cmpgt_ps(v_carry, v_f)))
+        {
+            v_f = _mm_max_ps(v_f, v_carry);
+            _mm_store_ps(f_column + seg * STRIPED_LANES, v_f);
+            _mm_store_ps(h_store + seg * STRIPED_LANES,
+                         _mm_max_ps(_mm_load_ps(h_store + seg * STRIPED_LANES), v_f));
+            v_carry = _mm_add_ps(v_f, v_gap_extension);
+            if (++seg == seg_len)
+            {
+                seg = 0;
+                v_carry = shift_in(v_carry, v_neg_inf);
+            }
+            v_f = _mm_load_ps(f_column + seg * STRIPED_LANES);
+        }
+
+        for (seg = 0; seg < seg_len; seg++)
+        {
+            v_best = _mm_max_ps(v_best,
+                                _mm_add_ps(_mm_load_ps(h_store + seg * STRIPED_LANES),
+                                           _mm_load_ps(valid + seg * STRIPED_LANES)));
+        }
+        temp = h_load; h_load = h_store; h_store = temp;
+        temp = m_load; m_load = m_store; m_store = temp;
+    }
+
+    float lanes[STRIPED_LANES];
+    _mm_storeu_ps(lanes, v_best);
+    float best_score = 0.0;
+    for (lane = 0; lane < STRIPED_LANES; lane++)
+    {
+        best_score = (lanes[lane] > best_score) ? lanes[lane] : best_score;
+    }
+    INSTRUMENT_ALIGNMENT(fill_timer, 1, (long long) ref_len * profile->query_len);
+    return best_score;
+}
+
+
+/* cached_query_profile:
+ * the profile of query the calling thread keeps, rebuilt in place
+ * unless it was already the one of query and score_param */
+static Query_Profile *cached_query_profile(char *query, Score_Param score_param)
+{
+    pthread_once(&profile_cache_once, create_profile_cache_key);
+    Profile_Cache *cache = pthread_getspecific(profile_cache_key);
+    if (cache == NULL)
+    {
+        cache = allocate(sizeof(Profile_Cache));
+        cache->profile = NULL;
+        cache->query = NULL;
+        cache->query_capacity = 0;
+        pthread_setspecific(profile_cache_key, cache);
+    }
+    if (cache->profile != NULL && strcmp(cache->query, query) == 0 &&
+        same_score_param(cache->profile->score_param, score_param))
+    {
+        return cache->profile;
+    }
+    size_t query_size = strlen(query) +1;
+    if (query_size > cache->query_capacity)
+    {
+        free(cache->query);
+        cache->query_capacity = query_size;
+        cache->query = allocate(query_size);
+    }
+    memcpy(cache->query, query, query_size);
+    cache->profile = build_query_profile(cache->profile, query, score_param);
+    return cache->profile;
+}
+
+static void create_profile_cache_key(void)
+{
+    pthread_key_create(&profile_cache_key, free_profile_cache);
+}
+
+/* free_profile_cache: the destructor of a thread's Profile_Cache */
+static void free_profile_cache(void *arg)
+{
+    Profile_Cache *cache = arg;
+    if (cache->profile != NULL)
+    {
+        free_query_profile(cache->profile);
+    }
+    free(cache->query);
+    free(cache);
+}
+
+static int same_score_param(Score_Param param1, Score_Param param2)
+{
+    return param1.match_score == param2.match_score &&
+           param1.mismatch_penalty == param2.mismatch_penalty &&
+           param1.gap_open_penalty == param2.gap_open_penalty &&
+           param1.gap_extension_penalty == param2.gap_extension_penalty;
+}
+
+/* allocate_vectors: aligned storage for num_vector vectors */
+static float *allocate_vectors(int num_vector)
+{
+    float *vectors = _mm_malloc(sizeof(float) * STRIPED_LANES * num_vector,
+                                VECTOR_ALIGNMENT);
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 1);
+    if (vectors == NULL)
+    {
+        error_handle(ERROR_MEM_ALLOC);
+        exit(ERROR_MEM_ALLOC);
+    }
+    return vectors;
+}
+
+/* shift_in: move every lane up by one, lane 0 takes
+ * the value in lane 0 of lane0_value */
+static __m128 shift_in(__m128 vector, __m128 lane0_value)
+{
+    __m128 shifted = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(vector), 4));
+    return _mm_move_ss(shifted, lane0_value);
+}
+
+#endif /* __SSE2__ */
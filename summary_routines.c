@@ -0,0 +1,249 @@
+/************************** POOL SUMMARY ROUTINES **************************
+ * Per primer summaries of a pool alignment without the interaction
+ * matrix: every score is folded into the max, sum and count of its row
+ * (the primer as the ref) and of its column (the primer's reverse
+ * complement as the query) as soon as a row of the matrix comes out of
+ * swalign_batch(), and then forgotten. Memory is linear in the pool.
+ *
+ * The rows are cut into SUMMARY_NUM_CHUNK chunks of consecutive rows.
+ * A chunk's rows only ever add to their own row accumulators, while
+ * its contributions to the columns go into partials of the chunk's own.
+ * Workers take whole chunks, and once all are done the partials are
+ * added up chunk after chunk. Every sum is thus made of the same terms
+ * in the same order however many threads there are and whoever takes
+ * which chunk, and the summaries are the same bit for bit.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "swinc.h"
+
+#define SUMMARY_NUM_CHUNK 64
+
+/* what the workers share */
+typedef struct {
+    char **primers;
+    char **queries;
+    int num_primer;
+    int num_chunk;
+    Score_Param score_param;
+    Primer_Summary *summaries;
+    float *col_max;      // num_chunk x num_primer partials
+    double *col_sum;
+    int next_chunk;
+    pthread_mutex_t lock;
+} Summary_Work;
+
+static void *summarise_chunks(void *work);
+static void summarise_chunk(Summary_Work *work, int chunk, char **refs,
+                            float *scores, Arena *arena);
+
+
+/* summarise_pool:
+ * align primers[i] to rc(primers[j]) for all i != j as align_pool()
+ * does and fill summaries[i] with the max, sum and count of row i and
+ * column i. num_thread workers (0 for one per online CPU). */
+void summarise_pool(char **primers, int num_primer, Score_Param score_param,
+                    int num_thread, Primer_Summary *summaries)
+{
+    if (num_thread <= 0)
+    {
+        num_thread = sysconf(_SC_NPROCESSORS_ONLN);
+        num_thread = (num_thread > 0) ? num_thread : 1;
+    }
+    int num_chunk = (num_primer < SUMMARY_NUM_CHUNK) ? num_primer : SUMMARY_NUM_CHUNK;
+    size_t num_partial = (size_t) num_chunk * num_primer;
+    Summary_Work work = {.primers = primers, .queries = NULL,
+                         .num_primer = num_primer, .num_chunk = num_chunk,
+                         .score_param = score_param, .summaries = summaries,
+                         .col_max = NULL, .col_sum = NULL, .next_chunk = 0};
+    int i, j, chunk;
+
+    work.queries = allocate(sizeof(char *) * (num_primer +1));
+    work.col_max = allocate(sizeof(float) * (num_partial +1));
+    work.col_sum = allocate(sizeof(double) * (num_partial +1));
+    for (j = 0; j < num_primer; j++)
+    {
+        work.queries[j] = rev_complement(primers[j], KMER_SIZE);
+    }
+    pthread_mutex_init(&work.lock, NULL);
+
+    num_thread = (num_thread < num_chunk) ? num_thread : num_chunk;
+    if (num_thread <= 1)
+    {
+        summarise_chunks(&work);
+    }else
+    {
+        pthread_t *threads = allocate(sizeof(pthread_t) * num_thread);
+        for (i = 0; i < num_thread; i++)
+        {
+            if (pthread_create(&threads[i], NULL, summarise_chunks, &work) != 0)
+            {
+                fprintf(stderr, "%s error:\nCannot create thread %d\n",
+                        PROGRAM_NAME, i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (i = 0; i < num_thread; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        free(threads);
+    }
+
+    // reduce the column partials in chunk order
+    for (j = 0; j < num_primer; j++)
+    {
+        summaries[j].col_max = 0.0;
+        summaries[j].col_sum = 0.0;
+        summaries[j].col_count = num_primer -1;
+        for (chunk = 0; chunk < num_chunk; chunk++)
+        {
+            size_t index = (size_t) chunk * num_primer + j;
+            if (work.col_max[index] > summaries[j].col_max)
+            {
+                summaries[j].col_max = work.col_max[index];
+            }
+            summaries[j].col_sum += work.col_sum[index];
+        }
+    }
+
+    pthread_mutex_destroy(&work.lock);
+    for (j = 0; j < num_primer; j++)
+    {
+        free(work.queries[j]);
+    }
+    free(work.queries);
+    free(work.col_max);
+    free(work.col_sum);
+}
+
+/* summary_mean: the mean of a sum of count scores, 0 for none */
+float summary_mean(double sum, int count)
+{
+    return (count > 0) ? sum / count : 0.0;
+}
+
+/* write_pool_summary:
+ * a line per primer with its row max and mean and its column
+ * max and mean, separated by tabs, after a header line. */
+void write_pool_summary(FILE *outfile, char **primers, int num_primer,
+                        Primer_Summary *summaries, int precision)
+{
+    INSTRUMENT_START(output_timer);
+    Text_Buffer buffer;
+    init_text_buffer(&buffer, 0);
+    char *cursor;
+    int i;
+    fputs("primer\trow_max\trow_mean\tcol_max\tcol_mean\n", outfile);
+    for (i = 0; i < num_primer; i++)
+    {
+        // 4 numbers of at most 48 chars each
+        cursor = reserve_text(&buffer, strlen(primers[i]) + 4 * 48 + 8);
+        cursor += sprintf(cursor, "%s", primers[i]);
+        *cursor++ = '\t';
+        cursor += format_float(summaries[i].row_max, precision, cursor);
+        *cursor++ = '\t';
+        cursor += format_float(summary_mean(summaries[i].row_sum,
+                                            summaries[i].row_count),
+                               precision, cursor);
+        *cursor++ = '\t';
+        cursor += format_float(summaries[i].col_max, precision, cursor);
+        *cursor++ = '\t';
+        cursor += format_float(summary_mean(summaries[i].col_sum,
+                                            summaries[i].col_count),
+                               precision, cursor);
+        *cursor++ = '\n';
+        buffer.len = cursor - buffer.text;
+        if (buffer.len > 65536)
+        {
+            fwrite(buffer.text, 1, buffer.len, outfile);
+            buffer.len = 0;
+        }
+    }
+    fwrite(buffer.text, 1, buffer.len, outfile);
+    free_text_buffer(&buffer);
+    INSTRUMENT_PHASE(PHASE_OUTPUT, output_timer);
+}
+
+
+/* summarise_chunks: a worker, summarise chunks until none is left */
+static void *summarise_chunks(void *arg)
+{
+    Summary_Work *work = arg;
+    char **refs = allocate(sizeof(char *) * (work->num_primer +1));
+    float *scores = allocate(sizeof(float) * (work->num_primer +1));
+    Arena *arena = create_arena(0);
+    int chunk;
+    while (1)
+    {
+        pthread_mutex_lock(&work->lock);
+        chunk = work->next_chunk++;
+        pthread_mutex_unlock(&work->lock);
+        if (chunk >= work->num_chunk)
+        {
+            break;
+        }
+        summarise_chunk(work, chunk, refs, scores, arena);
+    }
+    free(refs);
+    free(scores);
+    free_arena(arena);
+    return NULL;
+}
+
+/* summarise_chunk:
+ * align the rows of chunk a row at a time, folding the scores
+ * into the rows' summaries and the chunk's column partials */
+static void summarise_chunk(Summary_Work *work, int chunk, char **refs,
+                            float *scores, Arena *arena)
+{
+    int num_primer = work->num_primer;
+    int first_row = (int) ((long) chunk * num_primer / work->num_chunk);
+    int last_row = (int) ((long) (chunk +1) * num_primer / work->num_chunk);
+    float *col_max = work->col_max + (size_t) chunk * num_primer;
+    double *col_sum = work->col_sum + (size_t) chunk * num_primer;
+    Primer_Summary *summary;
+    float score;
+    int i, j;
+    for (j = 0; j < num_primer; j++)
+    {
+        col_max[j] = 0.0;
+        col_sum[j] = 0.0;
+    }
+    for (i = first_row; i < last_row; i++)
+    {
+        for (j = 0; j < num_primer; j++)
+        {
+            refs[j] = work->primers[i];
+        }
+        swalign_batch_arena(refs, work->queries, num_primer,
+                            work->score_param, scores, arena);
+        arena_reset(arena);
+        summary = &work->summaries[i];
+        summary->row_max = 0.0;
+        summary->row_sum = 0.0;
+        summary->row_count = num_primer -1;
+        for (j = 0; j < num_primer; j++)
+        {
+            if (j == i)
+            {// no self-alignment, as in align_pool()
+                continue;
+            }
+            score = scores[j];
+            if (score > summary->row_max)
+            {
+                summary->row_max = score;
+            }
+            summary->row_sum += score;
+            if (score > col_max[j])
+            {
+                col_max[j] = score;
+            }
+            col_sum[j] += score;
+        }
+    }
+}
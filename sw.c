@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdio.h>
+#include "bench.h"
 
 #define TEST_REF ("AATTGGGGACAGGGGCTATATATCGATCGATGGCTAGCGGCGGCGCGCGGGGG"\
                   "GGGCTCATACAGTGACGTACGTAGCATGACTGCATGTACGTAGTGCTGCGGGG"\
@@ -18,10 +19,15 @@
 
 void print_matrix(float matrix[MAX_SEQ_LEN+1][MAX_SEQ_LEN+1], int nrow, int ncol);
 void align(char *ref, char *query);
+static void benchmark_align(void);
 static float sw_matrix[MAX_SEQ_LEN +1][MAX_SEQ_LEN +1] = {{0}};
 
 
 int main(int argc, char **argv){
+    if (argc > 1 && strcmp(argv[1], "-b") == 0){
+        benchmark_align();
+        return 0;
+    }
     char *ref, *query;
     ref = argv[1];
     query = argv[2];
@@ -36,6 +42,40 @@ int main(int argc, char **argv){
     return 0;
 }
 
+/* benchmark_align: time align() on random pairs, JSON on stdout */
+#define BENCH_NUM_PAIR 256
+static void benchmark_align(void){
+    static char refs[BENCH_NUM_PAIR][MAX_SEQ_LEN +1];
+    static char queries[BENCH_NUM_PAIR][MAX_SEQ_LEN +1];
+    Bench_Rng rng;
+    Bench_Json json;
+    int i, k, repeat;
+    double start;
+    seed_bench_rng(&rng, BENCH_SEED);
+    begin_bench_json(&json, stdout, "sw");
+    for (i = 0; i < BENCH_NUM_LEN; i++){
+        int seq_len = BENCH_SEQ_LENS[i];
+        for (k = 0; k < BENCH_NUM_PAIR; k++){
+            make_bench_primer(&rng, seq_len, 0.5, refs[k]);
+            make_bench_primer(&rng, seq_len, 0.5, queries[k]);
+        }
+        reset_peak_rss();
+        start = bench_seconds();
+        repeat = 0;
+        do {
+            for (k = 0; k < BENCH_NUM_PAIR; k++)
+                align(refs[k], queries[k]);
+            repeat++;
+        } while (bench_seconds() - start < BENCH_MIN_SECONDS);
+        Bench_Result result = {"align", "pairs", seq_len, 0,
+                               (long) repeat * BENCH_NUM_PAIR,
+                               (double) repeat * BENCH_NUM_PAIR * seq_len * seq_len,
+                               bench_seconds() - start, 0};
+        add_bench_result(&json, result);
+    }
+    end_bench_json(&json);
+}
+
 /*****************************************************************************/
 
 
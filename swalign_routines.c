@@ -0,0 +1,888 @@
+/************************** SWALIGN ROUTINES ********************************
+ * The pool alignment, the sw_matrix of a pair and the utilities of
+ * swinc, apart from main() in swinc.c so that the benchmarks and
+ * test_swinc.c link the same routines.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "swinc.h"
+
+float interaction_matrix[MAX_POOL_SIZE][MAX_POOL_SIZE];
+char pool[MAX_POOL_SIZE][MAX_SEQ_LEN];
+
+static SW_entry **allocate_sw_matrix(int nrow, int ncol);
+static void init_matrix(SW_entry **sw_matrix, int nrow, int ncol);
+static char best_state(SW_entry entry);
+static void print_record_matrix(SW_entry **sw_matrix, int nrow, int ncol,
+                                int which_record);
+static void write_rev_complement(char *seq, int result_len, char *result);
+
+
+/******************* pool alignment routines *******************************/
+/* align_pool:
+ * given an array of strings, pool, return a matrix of size
+ * |pool|x|pool| with matrix[i][j] representing the alignment score
+ * between string_i and string_j (a complete graph).
+ * The matrix will be symmetric and the diagonal element will be 0.0, i.e.
+ * by default we don't want information about self-alignment.
+ * A row of the matrix is aligned in one call to swalign_batch(), 
+ * which puts pairs of similar length side by side in vector lanes.
+ * Its scratch space comes from an arena reset after every row, so
+ * the rows after the first don't go to the heap.*/
+
+void align_pool(int pool_size, Score_Param score_param)
+{
+    int i, j;
+    char **queries = allocate(sizeof(char *) * pool_size);
+    char **refs = allocate(sizeof(char *) * pool_size);
+    Arena *arena = create_arena(0);
+    for (j = 0; j < pool_size; j++)
+    {
+        queries[j] = rev_complement(pool[j], KMER_SIZE);
+    }
+    for (i = 0; i < pool_size; i++)
+    {
+        for (j = 0; j < pool_size; j++)
+        {
+            refs[j] = pool[i];
+        }
+        swalign_batch_arena(refs, queries, pool_size,
+                            score_param, interaction_matrix[i], arena);
+        arena_reset(arena);
+        interaction_matrix[i][i] = 0.0;
+    }
+    for (j = 0; j < pool_size; j++)
+    {
+        free(queries[j]);
+    }
+    free(queries);
+    free(refs);
+    free_arena(arena);
+}
+
+
+/* align_pool_symmetric:
+ * align_pool() aligning each pair of primers once for both entries.
+ * interaction_matrix[j][i] is the opposite orientation of the duplex
+ * of interaction_matrix[i][j] (pool[j] on rc(pool[i]) is rc(pool[i])
+ * on pool[j] reverse complemented); swalign_batch_symmetric() gets it
+ * from the same sw_matrix. That needs the whole of both primers to be
+ * in the duplex and complements to be distinct, so primers longer than
+ * KMER_SIZE or with anything but A, C, G, T are aligned both ways.
+ * The reverse complements are made once, before the alignments.
+ * Row i of the upper triangle (j > i) is aligned at a time, its
+ * scratch space from an arena reset after the row as in align_pool().
+ * Each cell carries the records of both orientations and the kernel
+ * has BATCH_LANES lanes only, so this is no faster than align_pool()
+ * (about 0.7 to 0.9 of its throughput with SSE2, see swinc -b), which
+ * stays the one swinc runs. */
+void align_pool_symmetric(int pool_size, Score_Param score_param)
+{
+    int i, j, k, num_pair;
+    char **queries = allocate(sizeof(char *) * (pool_size +1));
+    int *symmetric = allocate(sizeof(int) * (pool_size +1));
+    char **refs = allocate(sizeof(char *) * (2 * pool_size +1));
+    char **pair_queries = allocate(sizeof(char *) * (2 * pool_size +1));
+    float *scores = allocate(sizeof(float) * (2 * pool_size +1));
+    float *reverse_scores = allocate(sizeof(float) * (pool_size +1));
+    Arena *arena = create_arena(0);
+    for (i = 0; i < pool_size; i++)
+    {
+        queries[i] = rev_complement(pool[i], KMER_SIZE);
+        symmetric[i] = (strlen(pool[i]) <= KMER_SIZE &&
+                        strspn(pool[i], "ACGT") == strlen(pool[i]));
+    }
+
+    for (i = 0; i < pool_size; i++)
+    {
+        interaction_matrix[i][i] = 0.0;
+        // both entries at once where possible
+        num_pair = 0;
+        for (j = i +1; j < pool_size; j++)
+        {
+            if (symmetric[i] && symmetric[j])
+            {
+                refs[num_pair] = pool[i];
+                pair_queries[num_pair++] = queries[j];
+            }
+        }
+        swalign_batch_symmetric_arena(refs, pair_queries, num_pair,
+                                      score_param, scores, reverse_scores,
+                                      arena);
+        arena_reset(arena);
+        k = 0;
+        for (j = i +1; j < pool_size; j++)
+        {
+            if (symmetric[i] && symmetric[j])
+            {
+                interaction_matrix[i][j] = scores[k];
+                interaction_matrix[j][i] = reverse_scores[k++];
+            }
+        }
+
+        // the rest, one entry per pair
+        num_pair = 0;
+        for (j = i +1; j < pool_size; j++)
+        {
+            if (!(symmetric[i] && symmetric[j]))
+            {
+                refs[num_pair] = pool[i];
+                pair_queries[num_pair++] = queries[j];
+                refs[num_pair] = pool[j];
+                pair_queries[num_pair++] = queries[i];
+            }
+        }
+        swalign_batch_arena(refs, pair_queries, num_pair, score_param,
+                            scores, arena);
+        arena_reset(arena);
+        k = 0;
+        for (j = i +1; j < pool_size; j++)
+        {
+            if (!(symmetric[i] && symmetric[j]))
+            {
+                interaction_matrix[i][j] = scores[k++];
+                interaction_matrix[j][i] = scores[k++];
+            }
+        }
+    }
+
+    for (i = 0; i < pool_size; i++)
+    {
+        free(queries[i]);
+    }
+    free(queries);
+    free(symmetric);
+    free(refs);
+    free(pair_queries);
+    free(scores);
+    free(reverse_scores);
+    free_arena(arena);
+}
+
+int get_primers(char *filename)
+{
+    INSTRUMENT_START(parse_timer);
+    FILE *file_handle = fopen(filename, "r");
+    int count = 0;
+    char buff[MAX_SEQ_LEN];
+    char *temp;
+    while ((temp = fgets(buff, MAX_SEQ_LEN, file_handle)) != NULL)
+    {
+        temp = trim_whitespace(temp); // remove left and right whitespaces
+        if (count <= MAX_POOL_SIZE)
+        {
+            strcpy(pool[count], temp);
+        }else
+        {
+            printf("Something's wrong");
+        }
+        count++;
+    }
+    fclose(file_handle);
+    INSTRUMENT_PHASE(PHASE_PARSE, parse_timer);
+    return count;
+}
+
+/******************** SW alignment algorithm ****************************/
+
+/* verbose_swalign:
+ * fill the sw_matrix of the ref and query of user_inputs,
+ * print it and return the best alignment score */
+float verbose_swalign(User_Inputs user_inputs)
+{
+    int nrow = strlen(user_inputs.query) +1;
+    int ncol = strlen(user_inputs.ref) +1;
+    SW_entry **sw_matrix = allocate_sw_matrix(nrow, ncol);
+    SW_Hit best_hit = fill_matrix(sw_matrix, 
+                                  user_inputs.ref, 
+                                  user_inputs.query, 
+                                  user_inputs.score_param);
+    print_sw_matrix(sw_matrix, nrow, ncol);
+    free(sw_matrix);
+    return best_hit.score;
+}
+
+/* swalign:
+ * a non-verbose sw aligner that return only the score
+ * of the best alignment.
+ * Since no decision is needed, the score is computed by the
+ * kernel bound to the host (the striped kernel where there are
+ * vectors, the linear memory one otherwise, see swinc_kernels()),
+ * neither keeps a sw_matrix.
+ * fill_matrix() remains the reference for the scores.
+ */
+float swalign(char *ref, char *query, Score_Param score_param)
+{
+    return swinc_kernels()->swalign(ref, query, score_param);
+}
+
+/* fill_matrix:
+ * fill the matrix with the the best scores and decisions that lead
+ * to those scores. It return the best score found in the matrix
+ * together with the entry it is found in (kept as the matrix is
+ * filled) and the state of its best record: 'M', 'I', 'D', or 'T'
+ * for a null entry. */
+SW_Hit fill_matrix(SW_entry **sw_matrix, 
+                   char *ref, char *query, 
+                   Score_Param score_param)
+{
+    register int row, col;
+    float new_score;
+    int ref_len = strlen(ref);
+    int query_len = strlen(query);
+    int nrow = query_len +1;
+    int ncol = ref_len +1;
+    //initiate the first row and first col to null entries.
+    init_matrix(sw_matrix, nrow, ncol);
+    // the first row is null entries, the last one is chosen
+    SW_Hit best_hit = {0.0, 0, ncol -1, 'T'};
+    for (row = 1; row < nrow; row++)
+    {
+        // so is the first col
+        if (best_hit.score <= 0.0)
+        {
+            best_hit = (SW_Hit) {0.0, row, 0, 'T'};
+        }
+        for (col = 1; col < ncol; col++)
+        {
+            new_score = score(sw_matrix, ref, query, row, col, score_param);
+            if (new_score >= best_hit.score)
+            {// bottom rightmost maximum will be chosen among equal maxima
+                best_hit = (SW_Hit) {new_score, row, col,
+                                     best_state(sw_matrix[row][col])};
+            }
+        }
+    }
+    return best_hit;
+}
+
+/* best_state:
+ * the state of the best record of entry as score() chooses it,
+ * 'M' for a match or mismatch, 'I' or 'D' */
+static char best_state(SW_entry entry)
+{
+    Decision_Record records[] = {entry.match_record,
+                                 entry.insert_record,
+                                 entry.delete_record};
+    char state = max_record(records, 3).decision[1];
+    return (state == 'X') ? 'M' : state;
+}
+
+
+/* allocate_sw_matrix:
+ * the row pointers and the rows in a single block, released
+ * with one free() of the matrix */
+static SW_entry **allocate_sw_matrix(int nrow, int ncol)
+{
+    register int row;
+    SW_entry **sw_matrix = allocate(sizeof(SW_entry *) * nrow +
+                                    sizeof(SW_entry) * nrow * ncol);
+    SW_entry *entries = (SW_entry *) (sw_matrix + nrow);
+    for (row = 0; row < nrow; row++)
+    {
+        sw_matrix[row] = entries + (size_t) row * ncol;
+    }
+    return sw_matrix;
+}
+
+
+/* init_matrix:
+ * initialise all of first row, first column of sw_matrix
+ * to null entries
+ */
+static void init_matrix(SW_entry **sw_matrix, int nrow, int ncol)
+{
+    register int row, col;
+    Decision_Record null_decision_record = {0, "TT"};
+    SW_entry null_entry = {
+                           null_decision_record,
+                           null_decision_record,
+                           null_decision_record
+                          };
+    for (row = 0, col = 0; col < ncol; col++)
+    {
+        sw_matrix[row][col] = null_entry;
+    }
+    for (col = 0, row = 0; row < nrow; row++)
+    {
+        sw_matrix[row][col] = null_entry;
+    }
+}
+
+
+
+/* score:
+ * for the specifed row and col in sw_matrix
+ * assign the best record of every decision and return
+ * the best of them */
+float score(SW_entry **sw_matrix, char *ref, char *query, 
+            int row, int col, Score_Param score_param)
+{
+    SW_entry new_entry = 
+                       {
+                           score_match_mismatch(sw_matrix, 
+                                                ref, query, 
+                                                row, col, 
+                                                score_param),
+                           score_insert(sw_matrix, row, col, score_param),
+                           score_delete(sw_matrix, row, col, score_param)
+                       };
+    Decision_Record records[] = {new_entry.match_record,
+                                 new_entry.insert_record,
+                                 new_entry.delete_record};
+    sw_matrix[row][col] = new_entry;
+    return max_record(records, 3).score;
+    /* there're 3 decision records in any sw_matrix entry
+     * the best score is return and kept track of so that
+     * we dont have to walk through 3mn decisions in mn entries to 
+     * track down the alignment score for a[1,m], b[1,n].*/
+}
+
+/* score_mm: score mismatch. Given the position of 
+ * an entry determine the score of the entry if the
+ * alignment arrive at the entry through a 
+ * match or mismatch (ie a diagonal movment
+ * in the matrix */
+Decision_Record score_match_mismatch(SW_entry **sw_matrix, 
+                                     char *ref, char *query, 
+                                     int row, int col, 
+                                     Score_Param score_param)
+{
+    SW_entry previous_entry = sw_matrix[row-1][col-1];
+    Decision_Record previous_records[] = {previous_entry.match_record,
+                                          previous_entry.insert_record,
+                                          previous_entry.delete_record};
+    Decision_Record max_prev_record = max_record(previous_records, 3);
+    Decision_Record match_mismatch_record;
+    match_mismatch_record.decision[0] = max_prev_record.decision[1];
+    match_mismatch_record.decision[2] = '\0';
+    if (ref[col -1] == query[row -1])
+    {
+        match_mismatch_record.score = max_prev_record.score + \
+                                      score_param.match_score;
+        match_mismatch_record.decision[1] = 'M';
+    } else
+    {
+        match_mismatch_record.score = max_prev_record.score + \
+                                      score_param.mismatch_penalty;
+        match_mismatch_record.decision[1] = 'X';
+    }
+    return match_mismatch_record;
+}
+
+/* score_insert: compute the score at the
+ * given position in the sw_matrix if 
+ * the arrival at the pos is by an insertion
+ * (a vertical movement in the matrix) */
+
+/* current insert can be a continuation of previous insert or
+ * from a previous match/mismatch situation. 
+ * If continue from insert, the penalty is for extending gap.
+ * If it is from match/mismatch, the penalty is for opening the gap.
+ * 
+ * The same is for deletion.
+ */
+Decision_Record score_insert(SW_entry **sw_matrix, 
+                             int row, int col, 
+                             Score_Param score_param)
+{
+    SW_entry prev_entry = sw_matrix[row -1][col];
+    // inspect the continuation from previous insertion first
+    Decision_Record insert_record = {prev_entry.insert_record.score + \
+                                       score_param.gap_extension_penalty,
+                                       "II"};
+    // now check if coming from match mismatch is better
+    float from_match_mismatch_score = prev_entry.match_record.score + \
+                                      score_param.gap_open_penalty;
+    if (from_match_mismatch_score > insert_record.score)
+    {
+        insert_record.score = from_match_mismatch_score;
+        insert_record.decision[0] = prev_entry.match_record.decision[1];
+    }
+    return insert_record;
+}
+
+
+/* score_delete: compute the score at the 
+ * given position in the sw_matrix if the
+ * one arrive at the position by deletion
+ * (a horizontal movement in the matrix) */
+Decision_Record score_delete(SW_entry **sw_matrix, 
+                             int row, int col,
+                             Score_Param score_param)
+{
+    SW_entry prev_entry = sw_matrix[row][col-1];
+    // inspect continuation from previous deletion first.
+    Decision_Record delete_record = {prev_entry.delete_record.score + \
+                                     score_param.gap_extension_penalty,
+                                     "DD"};
+    float from_match_mismatch_score = prev_entry.match_record.score + \
+                                      score_param.gap_open_penalty;
+    if (from_match_mismatch_score > delete_record.score)
+    {
+        delete_record.score = from_match_mismatch_score;
+        delete_record.decision[0] = prev_entry.match_record.decision[1];
+    }
+    return delete_record;
+}
+
+
+
+
+
+
+/***** Utilities *********/
+
+/* max_record:
+ * given a list of Decision_Record type, return the one with the
+ * maximum score, the first of them among equal maxima. */
+Decision_Record max_record(Decision_Record records[], int num_record)
+{
+    Decision_Record maximum = records[0];
+    register int i;
+    for (i = 1; i < num_record; i++)
+    {
+        if (records[i].score > maximum.score)
+        {
+            maximum = records[i];
+        }
+    }
+    return maximum;
+}
+
+
+/* print_sw_matrix:
+ * output a representation of sw_matrix.
+ * Since each entry consist of 3 separate decision
+ * we represent the whole matrix as 3 separate matrices
+ * each for insert, delete and match separately.
+ */
+void print_sw_matrix(SW_entry **sw_matrix, int nrow, int ncol)
+{
+    printf("Matrix for match/mismatch records\n");
+    print_record_matrix(sw_matrix, nrow, ncol, 0);
+    printf("Matrix for insert records\n");
+    print_record_matrix(sw_matrix, nrow, ncol, 1);
+    printf("Matrix for delete records\n");
+    print_record_matrix(sw_matrix, nrow, ncol, 2);
+}
+
+/* print_record_matrix:
+ * one of the 3 matrices of print_sw_matrix(): the match (0),
+ * insert (1) or delete (2) record of every entry */
+static void print_record_matrix(SW_entry **sw_matrix, int nrow, int ncol,
+                                int which_record)
+{
+    register int row, col;
+    Decision_Record record;
+    for (row = 0; row < nrow; row++)
+    {
+        for (col = 0; col < ncol; col++)
+        {
+            record = (which_record == 0) ? sw_matrix[row][col].match_record :
+                     (which_record == 1) ? sw_matrix[row][col].insert_record :
+                                           sw_matrix[row][col].delete_record;
+            printf("%.2f%s ", record.score, record.decision);
+        }
+        printf("\n");
+    }
+}
+
+
+/* print_alignment:
+ * print the best alignment of query to ref. The decisions are
+ * kept packed, one byte per entry, and decoded by the traceback. */
+void print_alignment(char *ref, char *query, Score_Param score_param)
+{
+    SW_Alignment alignment = align_packed(ref, query, score_param);
+    print_sw_alignment(&alignment, ref, query);
+    free_alignment(&alignment);
+}
+
+/* print_interaction_matrix:
+ * print the first nrow x ncol entries of interaction_matrix to stdout,
+ * a line per row: its primer, its scores, and their max and mean over
+ * all ncol columns, the diagonal included (REPORT_SUMMARY takes them
+ * so too, summarise_pool() leaves the diagonal out). A row is
+ * formatted with format_float() and written with one fwrite(). */
+void print_interaction_matrix(int nrow, int ncol)
+{
+    Text_Buffer buffer;
+    float max_interaction, temp;
+    float average_interaction;
+    char *cursor;
+    register int row, col;
+    init_text_buffer(&buffer, 0);
+    for (row = 0; row < nrow; row++)
+    {
+        buffer.len = 0;
+        cursor = reserve_text(&buffer, MAX_SEQ_LEN + 128 + ncol * 44);
+        cursor += sprintf(cursor, "%60s ", pool[row]);
+        max_interaction = 0.0;
+        for (col = 0; col < ncol; col++)
+        {
+            temp = interaction_matrix[row][col];
+            cursor += format_float(temp, REPORT_DEFAULT_PRECISION, cursor);
+            *cursor++ = ' ';
+            if (temp > max_interaction)
+            {
+                max_interaction = temp;
+            }
+        }
+        average_interaction = mean(interaction_matrix[row], ncol);
+        cursor += sprintf(cursor, "\t max= %.2f \tmean= %.2f\n", max_interaction,
+                          average_interaction);
+        fwrite(buffer.text, 1, cursor - buffer.text, stdout);
+    }
+    free_text_buffer(&buffer);
+}
+
+/* complement:
+ * given a nucleotide base letter,
+ * return its complement in upper case.
+ * return '\0' otherwise. */
+char complement(char base){
+    base = toupper(base);
+    switch (base)
+    {
+        case 'A':
+            return 'T';
+            break;
+        case 'T':
+            return 'A';
+            break;
+        case 'G':
+            return 'C';
+            break;
+        case 'C':
+            return 'G';
+            break;
+        default:
+            return 'N';
+            break;
+    }
+}
+
+/* rev_complement:
+ * return the reverse complement of the inpput seq but we
+ * only take the first result_len bases of the reverse
+ * complement sequence */
+char *rev_complement(char *seq, int result_len)
+{
+    char *result = allocate(sizeof(char) * (result_len+1));
+    write_rev_complement(seq, result_len, result);
+    return result;
+}
+
+/* arena_rev_complement: rev_complement() allocated from arena */
+char *arena_rev_complement(Arena *arena, char *seq, int result_len)
+{
+    char *result = arena_alloc(arena, sizeof(char) * (result_len+1));
+    write_rev_complement(seq, result_len, result);
+    return result;
+}
+
+/* write_rev_complement:
+ * the work of rev_complement(), result holds result_len +1 chars */
+static void write_rev_complement(char *seq, int result_len, char *result)
+{
+    INSTRUMENT_START(rev_complement_timer);
+    // if result_len should be smaller than seq_len
+    int seq_len = strlen(seq);
+    result_len = (seq_len < result_len)? seq_len : result_len;
+    int i;
+    for (i = 0; i < result_len; i++)
+    {
+        result[i] = complement(seq[seq_len-i-1]);
+    }
+    result[result_len] = '\0';
+    INSTRUMENT_PHASE(PHASE_REV_COMPLEMENT, rev_complement_timer);
+}
+
+/* mean:
+ * given a list of float of length list_len,
+ * compute and return their mean.*/
+float mean(float num_list[], int list_len)
+{
+    float result = 0.0;
+    register int i;
+    for (i = 0; i < list_len; i++)
+    {
+        result += num_list[i];
+    }
+    return result / (float) list_len;
+}
+
+/*trim_whitespace:
+ * remove the whitespaces from the beginning and
+ * end of input */
+char *trim_whitespace(char *input)
+{
+    while (isspace(*input)) input++;
+    int len = strlen(input);
+    if (len == 0)
+    { // nothing but whitespace
+        return input;
+    }
+    char *endpointer = input + len -1;
+    while (isspace(*endpointer) && endpointer != input) 
+        endpointer--;
+    if (input + len -1 != endpointer)
+    { // if trailing space exist
+        *(endpointer +1) = '\0'; // terminate string before space
+    }
+    return input;
+}
+
+
+
+
+
+void error_handle(int error_code)
+{
+    fprintf(stderr, "%s error:\n", PROGRAM_NAME);
+    switch (error_code)
+    {
+        case ERROR_MEM_ALLOC:
+            fprintf(stderr, "Memory allocation error");
+            break;
+    }
+}
+
+/* allocate:
+ * malloc() that doesn't come back empty handed: report the error
+ * and exit if there is no memory left. Counted as an allocation of
+ * the alignment paths. */
+void *allocate(size_t size)
+{
+    void *memory = malloc(size);
+    INSTRUMENT_COUNT(COUNTER_ALLOCATIONS, 1);
+    if (memory == NULL)
+    {
+        error_handle(ERROR_MEM_ALLOC);
+        exit(ERROR_MEM_ALLOC);
+    }
+    return memory;
+}
+
+
+
+/*************************************************
+ * Nearest Neighbour Thermodynamics Parameters *
+ * **********************************************/
+
+float Reaction_Temperature;
+
+Therm_Param Initialisation[] = {
+    {"init", 0, 0},
+    {"init_A/T", 2.3, 4.1},
+    {"init_G/C", 0.1, -2.8},
+    {"init_oneG/C", 0, 0},
+    {"init_allA/T", 0, 0},
+    {"init_5T/A", 0, 0},
+    {"sym", 0, -1.4},
+};
+
+Therm_Param Match[] = {
+    {"AA/TT", -7.9, -22.2},
+    {"AT/TA", -7.2, -20.4},
+    {"TA/AT", -7.2, -21.3},
+    {"CA/GT", -8.5, -22.7},
+    {"GT/CA", -8.4, -22.4},
+    {"CT/GA", -7.8, -21.0},
+    {"GA/CT", -8.2, -22.2},
+    {"CG/GC", -10.6, -27.2},
+    {"GC/CG", -9.8, -24.4},
+    {"GG/CC", -8.0, -19.9},
+};
+
+// Internal mismatch and inosine table {DNA}
+// Allawi & SantaLucia {1997}, Biochemistry 36, 10581-10594
+// Allawi & SantaLucia {1998}, Biochemistry 37, 9435-9444
+// Allawi & SantaLucia {1998}, Biochemistry 37, 2170-2179
+// Allawi & SantaLucia {1998}, Nucl Acids Res 26, 2694-2701
+// Peyret et al. {1999}, Biochemistry 38, 3468-3477
+// Watkins & SantaLucia {2005}, Nucl Acids Res 33, 6258-6267
+Therm_Param Internal_Mismatch[] = {
+    {"AG/TT", 1.0, 0.9},
+    {"AT/TG", -2.5, -8.3},
+    {"CG/GT", -4.1, -11.7},
+    {"CT/GG", -2.8, -8.0},
+    {"GG/CT", 3.3, 10.4},
+    {"GG/TT", 5.8, 16.3},
+    {"GT/CG", -4.4, -12.3},
+    {"GT/TG", 4.1, 9.5},
+    {"TG/AT", -0.1, -1.7},
+    {"TG/GT", -1.4, -6.2},
+    {"TT/AG", -1.3, -5.3},
+    {"AA/TG", -0.6, -2.3},
+    {"AG/TA", -0.7, -2.3},
+    {"CA/GG", -0.7, -2.3},
+    {"CG/GA", -4.0, -13.2},
+    {"GA/CG", -0.6, -1.0},
+    {"GG/CA", 0.5, 3.2},
+    {"TA/AG", 0.7, 0.7},
+    {"TG/AA", 3.0, 7.4},
+    {"AC/TT", 0.7, 0.2},
+    {"AT/TC", -1.2, -6.2},
+    {"CC/GT", -0.8, -4.5},
+    {"CT/GC", -1.5, -6.1},
+    {"GC/CT", 2.3, 5.4},
+    {"GT/CC", 5.2, 13.5},
+    {"TC/AT", 1.2, 0.7},
+    {"TT/AC", 1.0, 0.7},
+    {"AA/TC", 2.3, 4.6},
+    {"AC/TA", 5.3, 14.6},
+    {"CA/GC", 1.9, 3.7},
+    {"CC/GA", 0.6, -0.6},
+    {"GA/CC", 5.2, 14.2},
+    {"GC/CA", -0.7, -3.8},
+    {"TA/AC", 3.4, 8.0},
+    {"TC/AA", 7.6, 20.2},
+    {"AA/TA", 1.2, 1.7},
+    {"CA/GA", -0.9, -4.2},
+    {"GA/CA", -2.9, -9.8},
+    {"TA/AA", 4.7, 12.9},
+    {"AC/TC", 0.0, -4.4},
+    {"CC/GC", -1.5, -7.2},
+    {"GC/CC", 3.6, 8.9},
+    {"TC/AC", 6.1, 16.4},
+    {"AG/TG", -3.1, -9.5},
+    {"CG/GG", -4.9, -15.3},
+    {"GG/CG", -6.0, -15.8},
+    {"TG/AG", 1.6, 3.6},
+    {"AT/TT", -2.7, -10.8},
+    {"CT/GT", -5.0, -15.8},
+    {"GT/CT", -2.2, -8.4},
+    {"TT/AT", 0.2, -1.5},
+    {"AI/TC", -8.9, -25.5},
+    {"TI/AC", -5.9, -17.4},
+    {"AC/TI", -8.8, -25.4},
+    {"TC/AI", -4.9, -13.9},
+    {"CI/GC", -5.4, -13.7},
+    {"GI/CC", -6.8, -19.1},
+    {"CC/GI", -8.3, -23.8},
+    {"GC/CI", -5.0, -12.6},
+    {"AI/TA", -8.3, -25.0},
+    {"TI/AA", -3.4, -11.2},
+    {"AA/TI", -0.7, -2.6},
+    {"TA/AI", -1.3, -4.6},
+    {"CI/GA", 2.6, 8.9},
+    {"GI/CA", -7.8, -21.1},
+    {"CA/GI", -7.0, -20.0},
+    {"GA/CI", -7.6, -20.2},
+    {"AI/TT", 0.49, -0.7},
+    {"TI/AT", -6.5, -22.0},
+    {"AT/TI", -5.6, -18.7},
+    {"TT/AI", -0.8, -4.3},
+    {"CI/GT", -1.0, -2.4},
+    {"GI/CT", -3.5, -10.6},
+    {"CT/GI", 0.1, -1.0},
+    {"GT/CI", -4.3, -12.1},
+    {"AI/TG", -4.9, -15.8},
+    {"TI/AG", -1.9, -8.5},
+    {"AG/TI", 0.1, -1.8},
+    {"TG/AI", 1.0, 1.0},
+    {"CI/GG", 7.1, 21.3},
+    {"GI/CG", -1.1, -3.2},
+    {"CG/GI", 5.8, 16.9},
+    {"GG/CI", -7.6, -22.0},
+    {"AI/TI", -3.3, -11.9},
+    {"TI/AI", 0.1, -2.3},
+    {"CI/GI", 1.3, 3.0},
+    {"GI/CI", -0.5, -1.3},
+};
+
+// Terminal mismatch table (DNA)
+// SantaLucia & Peyret (2001) Patent Application WO 01/94611
+Therm_Param Terminal_Mismatch[] = {
+    {"AA/TA", -3.1, -7.8},
+    {"TA/AA", -2.5, -6.3},
+    {"CA/GA", -4.3, -10.7},
+    {"GA/CA", -8.0, -22.5},
+    {"AC/TC", -0.1, 0.5},
+    {"TC/AC", -0.7, -1.3},
+    {"CC/GC", -2.1, -5.1},
+    {"GC/CC", -3.9, -10.6},
+    {"AG/TG", -1.1, -2.1},
+    {"TG/AG", -1.1, -2.7},
+    {"CG/GG", -3.8, -9.5},
+    {"GG/CG", -0.7, -19.2},
+    {"AT/TT", -2.4, -6.5},
+    {"TT/AT", -3.2, -8.9},
+    {"CT/GT", -6.1, -16.9},
+    {"GT/CT", -7.4, -21.2},
+    {"AA/TC", -1.6, -4.0},
+    {"AC/TA", -1.8, -3.8},
+    {"CA/GC", -2.6, -5.9},
+    {"CC/GA", -2.7, -6.0},
+    {"GA/CC", -5.0, -13.8},
+    {"GC/CA", -3.2, -7.1},
+    {"TA/AC", -2.3, -5.9},
+    {"TC/AA", -2.7, -7.0},
+    {"AC/TT", -0.9, -1.7},
+    {"AT/TC", -2.3, -6.3},
+    {"CC/GT", -3.2, -8.0},
+    {"CT/GC", -3.9, -10.6},
+    {"GC/CT", -4.9, -13.5},
+    {"GT/CC", -3.0, -7.8},
+    {"TC/AT", -2.5, -6.3},
+    {"TT/AC", -0.7, -1.2},
+    {"AA/TG", -1.9, -4.4},
+    {"AG/TA", -2.5, -5.9},
+    {"CA/GG", -3.9, -9.6},
+    {"CG/GA", -6.0, -15.5},
+    {"GA/CG", -4.3, -11.1},
+    {"GG/CA", -4.6, -11.4},
+    {"TA/AG", -2.0, -4.7},
+    {"TG/AA", -2.4, -5.8},
+    {"AG/TT", -3.2, -8.7},
+    {"AT/TG", -3.5, -9.4},
+    {"CG/GT", -3.8, -9.0},
+    {"CT/GG", -6.6, -18.7},
+    {"GG/CT", -5.7, -15.9},
+    {"GT/CG", -5.9, -16.1},
+    {"TG/AT", -3.9, -10.5},
+    {"TT/AG", -3.6, -9.8},
+};
+
+// Dangling ends table {DNA}
+// Bommarito et al. {2000}, Nucl Acids Res 28, 1929-1934
+Therm_Param Dangling_End[] = {
+    {"AA/.T", 0.2, 2.3},
+    {"AC/.G", -6.3, -17.1},
+    {"AG/.C", -3.7, -10.0},
+    {"AT/.A", -2.9, -7.6},
+    {"CA/.T", 0.6, 3.3},
+    {"CC/.G", -4.4, -12.6},
+    {"CG/.C", -4.0, -11.9},
+    {"CT/.A", -4.1, -13.0},
+    {"GA/.T", -1.1, -1.6},
+    {"GC/.G", -5.1, -14.0},
+    {"GG/.C", -3.9, -10.9},
+    {"GT/.A", -4.2, -15.0},
+    {"TA/.T", -6.9, -20.0},
+    {"TC/.G", -4.0, -10.9},
+    {"TG/.C", -4.9, -13.8},
+    {"TT/.A", -0.2, -0.5},
+    {".A/AT", -0.7, -0.8},
+    {".C/AG", -2.1, -3.9},
+    {".G/AC", -5.9, -16.5},
+    {".T/AA", -0.5, -1.1},
+    {".A/CT", 4.4, 14.9},
+    {".C/CG", -0.2, -0.1},
+    {".G/CC", -2.6, -7.4},
+    {".T/CA", 4.7, 14.2},
+    {".A/GT", -1.6, -3.6},
+    {".C/GG", -3.9, -11.2},
+    {".G/GC", -3.2, -10.4},
+    {".T/GA", -4.1, -13.1},
+    {".A/TT", 2.9, 10.4},
+    {".C/TG", -4.4, -13.1},
+    {".G/TC", -5.2, -15.0},
+    {".T/TA", -3.8, -12.6},
+};
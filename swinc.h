@@ -1,3 +1,10 @@
+#ifndef SWINC_H
+#define SWINC_H
+
+#include "arena.h"
+#include "instrument.h"
+#include "simd.h"
+
 
 /* maximum primer + heel length acceptable 
  * kmer size is the number of bases from the 
@@ -13,6 +20,9 @@
 #define DEFAULT_MISMATCH_PENALTY -1.0
 #define DEFAULT_GAP_OPEN_PENALTY -2.0
 #define DEFAULT_GAP_EXTENSION_PENALTY DEFAULT_GAP_OPEN_PENALTY
+// the runs align_pool_prefiltered() is benchmarked with (-n, -a)
+#define DEFAULT_MIN_RUN 7
+#define DEFAULT_MIN_ANCHORED_RUN 4
 // if not specified, extending a gap cost as much as opening a gap
 
 /* a record of the parameters that will be used in scoring */
@@ -31,6 +41,9 @@ typedef struct {
     char *primer_filename;
     Score_Param score_param;
     int verbose_flag;
+    int benchmark_flag;
+    int min_run;
+    int min_anchored_run;
 } User_Inputs;
 
 
@@ -50,7 +63,7 @@ typedef struct {
  *   be 2.3. */
 typedef struct {
     float score;
-    char *decision;
+    char decision[3];
 } Decision_Record;
 
 
@@ -69,13 +82,24 @@ typedef struct {
 
 
 
+/* the best score of an alignment, the sw_matrix entry it ends
+ * in (row is in query, col is in ref) and the state of its best
+ * record there: 'M', 'I', 'D', or 'T' for a null entry. */
+typedef struct {
+    float score;
+    int row;
+    int col;
+    char state;
+} SW_Hit;
+
 /***** Routines for sw alignment *************/
 float swalign(char *ref, char *query, Score_Param score_param);
-float fill_matrix(SW_entry **sw_matrix, 
-                  char *ref, char *query, 
-                  Score_Param score_param);
+SW_Hit fill_matrix(SW_entry **sw_matrix, 
+                   char *ref, char *query, 
+                   Score_Param score_param);
 float score(SW_entry **sw_matrix, 
             char *ref, char *query,
+            int row, int col,
             Score_Param score_param);
 Decision_Record score_match_mismatch(SW_entry **sw_matrix,
                               char *ref, char *query,
@@ -87,29 +111,368 @@ Decision_Record score_insert(SW_entry **sw_matrix,
 Decision_Record score_delete(SW_entry **sw_matrix,
                       int row, int col,
                       Score_Param score_param);
-float penalise_gap(int gap_len);
-SW_entry max(SW_entry list[], int list_len);
+Decision_Record max_record(Decision_Record records[], int num_record);
+float verbose_swalign(User_Inputs user_inputs);
+
+
+/***** Striped (vectorised) score-only sw alignment **********/
+/* Number of float lanes in a vector of the striped kernel. 
+ * The query is cut into STRIPED_LANES segments of seg_len
+ * bases, query position i lives in lane i / seg_len of 
+ * vector i % seg_len (Farrar's striped layout). */
+#define STRIPED_LANES 4
+
+/* The query profile holds the match/mismatch score of every
+ * query position against every base that can occur in ref, 
+ * laid out in striped order, so that the inner loop does a
+ * single aligned load instead of comparing bases.
+ * symbol_index maps a ref base to its block of seg_len vectors,
+ * block 0 is for bases that don't occur in the query at all.
+ * columns is the scratch space of swalign_profile(),
+ * PROFILE_COLUMNS columns of seg_len vectors. score_capacity
+ * and column_capacity are the vectors allocated for each, a
+ * profile rebuilt for another query only grows them. */
+#define PROFILE_COLUMNS 7
+typedef struct {
+    int query_len;
+    int seg_len;
+    int num_symbol;
+    unsigned char symbol_index[256];
+    float *scores;
+    float *columns;
+    int score_capacity;
+    int column_capacity;
+    Score_Param score_param;
+} Query_Profile;
+
+Query_Profile *init_query_profile(char *query, Score_Param score_param);
+Query_Profile *build_query_profile(Query_Profile *profile, char *query,
+                                   Score_Param score_param);
+void free_query_profile(Query_Profile *profile);
+float swalign_striped(char *ref, char *query, Score_Param score_param);
+float swalign_profile(char *ref, Query_Profile *profile);
+
+
+/***** Batched (inter-sequence) score-only sw alignment ******/
+/* Number of (ref, query) pairs aligned side by side,
+ * in SSE, AVX2 and AVX-512 registers */
+#define BATCH_LANES 4
+#define BATCH_LANES_AVX2 8
+#define BATCH_LANES_AVX512 16
+
+void swalign_batch(char **refs, char **queries, int num_pair,
+                   Score_Param score_param, float *scores);
+void swalign_batch_arena(char **refs, char **queries, int num_pair,
+                         Score_Param score_param, float *scores,
+                         Arena *arena);
+void swalign_batch_symmetric(char **refs, char **queries, int num_pair,
+                             Score_Param score_param,
+                             float *scores, float *reverse_scores);
+void swalign_batch_symmetric_arena(char **refs, char **queries, int num_pair,
+                                   Score_Param score_param,
+                                   float *scores, float *reverse_scores,
+                                   Arena *arena);
+void swalign_batch_scalar(char **refs, char **queries, int num_pair,
+                          Score_Param score_param, float *scores,
+                          Arena *arena);
+void swalign_batch_sse(char **refs, char **queries, int num_pair,
+                       Score_Param score_param, float *scores,
+                       Arena *arena);
+void swalign_batch_avx2(char **refs, char **queries, int num_pair,
+                        Score_Param score_param, float *scores,
+                        Arena *arena);
+void swalign_batch_avx512(char **refs, char **queries, int num_pair,
+                          Score_Param score_param, float *scores,
+                          Arena *arena);
+
+
+/***** Bit-parallel complementarity prefilter **************/
+/* a sequence of at most PACKED_MAX_LEN bases as bit planes of the
+ * codes A 0, C 1, G 2, T 3: base k is bit k of low (code & 1) and
+ * high (code >> 1), and of valid if it's one of A, C, G, T */
+#define PACKED_MAX_LEN 64
+typedef struct {
+    unsigned long long low;
+    unsigned long long high;
+    unsigned long long valid;
+    int len;
+} Packed_Seq;
+
+/* the longest run of matches without a gap of a pair, and the
+ * longest one at the 3' end of either primer */
+typedef struct {
+    int longest_run;
+    int anchored_run;
+} Dimer_Runs;
+
+/* the pairs taken for dimers: those with a run of min_run matches
+ * (0 for all pairs), or of min_anchored_run at a 3' end (0 for none) */
+typedef struct {
+    int min_run;
+    int min_anchored_run;
+} Dimer_Prefilter;
+
+/* PREFILTER_LANES refs screened side by side: ref_bases[code][lane]
+ * the bases of code in the ref of lane (codes 4 to 7 are anything
+ * but A, C, G and T, matching nothing), last_base[lane] its 3' base */
+#define PREFILTER_LANES 8
+#define PREFILTER_CODES 8
+typedef struct {
+    unsigned long long ref_bases[PREFILTER_CODES][PREFILTER_LANES];
+    unsigned long long last_base[PREFILTER_LANES];
+    int num_lane;
+} Prefilter_Lanes;
+
+int pack_sequence(const char *seq, Packed_Seq *packed);
+Dimer_Runs dimer_runs(const Packed_Seq *ref, const Packed_Seq *query);
+int passes_prefilter(Dimer_Runs runs, Dimer_Prefilter prefilter);
+void load_prefilter_lanes(const Packed_Seq *refs, int num_ref,
+                          Prefilter_Lanes *lanes);
+unsigned screen_dimers(const Prefilter_Lanes *lanes, const Packed_Seq *query,
+                       Dimer_Prefilter prefilter);
+unsigned screen_dimers_scalar(const Prefilter_Lanes *lanes,
+                              const Packed_Seq *query,
+                              Dimer_Prefilter prefilter);
+unsigned screen_dimers_avx2(const Prefilter_Lanes *lanes,
+                            const Packed_Seq *query,
+                            Dimer_Prefilter prefilter);
+unsigned screen_dimers_avx512(const Prefilter_Lanes *lanes,
+                              const Packed_Seq *query,
+                              Dimer_Prefilter prefilter);
+
+
+/***** Kernels bound to the instruction set level ***********/
+/* swalign(), swalign_batch_arena() and screen_dimers() call through
+ * this table, bound once to simd_level() (see simd.h). batch_lanes is
+ * the number of pairs side by side in the batch kernel. */
+typedef struct {
+    int level;
+    int batch_lanes;
+    float (*swalign)(char *ref, char *query, Score_Param score_param);
+    void (*swalign_batch)(char **refs, char **queries, int num_pair,
+                          Score_Param score_param, float *scores,
+                          Arena *arena);
+    unsigned (*screen_dimers)(const Prefilter_Lanes *lanes,
+                              const Packed_Seq *query,
+                              Dimer_Prefilter prefilter);
+} Swinc_Kernels;
+
+const Swinc_Kernels *swinc_kernels(void);
+
+
+/***** Linear memory score-only sw alignment ****************/
+SW_Hit swalign_linear(char *ref, char *query, Score_Param score_param);
+
+
+/***** Linear space sw alignment with traceback *************/
+/* an alignment of query[query_start, query_end) to 
+ * ref[ref_start, ref_end). path holds one decision per
+ * column of the alignment, from start to end: 'M' match, 
+ * 'X' mismatch, 'I' insertion (gap in ref), 'D' deletion
+ * (gap in query). */
+typedef struct {
+    float score;
+    int ref_start;
+    int ref_end;
+    int query_start;
+    int query_end;
+    int path_len;
+    char *path;
+} SW_Alignment;
+
+SW_Alignment align_linear_space(char *ref, char *query, Score_Param score_param);
+void free_alignment(SW_Alignment *alignment);
+void print_sw_alignment(SW_Alignment *alignment, char *ref, char *query);
+
+
+/***** sw alignment with a packed traceback matrix **********/
+SW_Alignment align_packed(char *ref, char *query, Score_Param score_param);
+SW_Alignment align_packed_arena(char *ref, char *query,
+                                Score_Param score_param, Arena *arena);
+
+
+/***** Alignment reports ************************************/
+/* chars format_cigar() may write for a path of path_len:
+ * one op per column at worst, 2 clips and the '\0' */
+#define CIGAR_MAX_LEN(path_len) (2 * (path_len) + 25)
+
+/* text appended to by the formatting routines, text[len] is '\0' */
+typedef struct {
+    char *text;
+    size_t len;
+    size_t capacity;
+} Text_Buffer;
+
+int format_cigar(SW_Alignment *alignment, int query_len, char *cigar);
+void format_gapped(SW_Alignment *alignment, char *ref, char *query,
+                   char *ref_string, char *query_string);
+void init_text_buffer(Text_Buffer *buffer, size_t capacity);
+void free_text_buffer(Text_Buffer *buffer);
+char *reserve_text(Text_Buffer *buffer, size_t len);
 
 
 
 /******* Variables for pool alignment *****/
-float interaction_matrix[MAX_POOL_SIZE][MAX_POOL_SIZE];
-char pool[MAX_POOL_SIZE][MAX_SEQ_LEN];
+extern float interaction_matrix[MAX_POOL_SIZE][MAX_POOL_SIZE];
+extern char pool[MAX_POOL_SIZE][MAX_SEQ_LEN];
 /******* Routines for pool alignment ******/
-void align_pool(int pool_size);
+void align_pool(int pool_size, Score_Param score_param);
+void align_pool_symmetric(int pool_size, Score_Param score_param);
 int get_primers(char *filename);
 
+/* How align_pool_parallel() spreads the work:
+ * num_thread workers (0 for one per online CPU), worker k
+ * bound to CPU k if pin_threads is set, and square tiles of
+ * tile_size primers each way (0 for POOL_TILE_SIZE). */
+#define POOL_TILE_SIZE 64
+typedef struct {
+    int num_thread;
+    int pin_threads;
+    int tile_size;
+} Pool_Schedule;
+
+void align_pool_parallel(int pool_size, Score_Param score_param,
+                         Pool_Schedule schedule);
+
+/******* Sparse pool alignment ************/
+/* an entry of the interaction matrix: the duplex of
+ * primers[ref_index] with rc(primers[query_index]) */
+typedef struct {
+    int ref_index;
+    int query_index;
+    float score;
+} Pool_Hit;
+
+/* the entries align_pool_sparse() writes out: all those scoring
+ * at least threshold, and the top_k best of every row (0 for none) */
+typedef struct {
+    int top_k;
+    float threshold;
+} Sparse_Filter;
+
+long align_pool_sparse(char **primers, int num_primer,
+                       Score_Param score_param, Sparse_Filter filter,
+                       FILE *outfile);
+char **read_primers(char *filename, int *num_primer);
+void free_primers(char **primers, int num_primer);
+
+
+/******* Prefiltered pool alignment *******/
+/* align_pool() with the pairs failing a Dimer_Prefilter left out */
+long align_pool_prefiltered(int pool_size, Score_Param score_param,
+                            Dimer_Prefilter prefilter);
+
+/******* Interaction matrix files *********/
+/* a file written by align_pool_to_file(), mapped read only.
+ * pool_hash is hash_pool() of the primers it was made from. */
+typedef struct {
+    int num_primer;
+    int tile_size;
+    int num_tile_col;
+    unsigned long long pool_hash;
+    Score_Param score_param;
+    const float *scores;
+    void *map;
+    size_t map_len;
+} Interaction_File;
+
+unsigned long long hash_pool(char **primers, int num_primer);
+void align_pool_to_file(char **primers, int num_primer,
+                        Score_Param score_param, int tile_size,
+                        char *filename);
+Interaction_File *open_interaction_file(char *filename);
+Interaction_File *open_pool_interaction_file(char *filename, char **primers,
+                                             int num_primer);
+float interaction_score(Interaction_File *file, int i, int j);
+void close_interaction_file(Interaction_File *file);
+
+/******* Interaction matrix reports ******/
+/* what write_interaction_report() writes: scores separated by
+ * tabs or commas, or the max and mean of every row over all its
+ * columns. Scores have precision digits after the point; rows are
+ * formatted by num_thread threads (0 or 1 for the calling thread
+ * alone). */
+typedef enum {
+    REPORT_TSV,
+    REPORT_CSV,
+    REPORT_SUMMARY
+} Report_Format;
+
+#define REPORT_DEFAULT_PRECISION 2
+typedef struct {
+    Report_Format format;
+    int precision;
+    int num_thread;
+} Report_Options;
+
+int format_float(float value, int precision, char *text);
+void write_interaction_report(FILE *outfile, const float *matrix,
+                              size_t row_stride, char **names,
+                              int nrow, int ncol, Report_Options options);
+
+/******* Pool summaries ******************/
+/* the scores of a primer in the interaction matrix, without the
+ * self-alignment: row as the ref, col as the (rc) query */
+typedef struct {
+    float row_max;
+    double row_sum;
+    int row_count;
+    float col_max;
+    double col_sum;
+    int col_count;
+} Primer_Summary;
+
+void summarise_pool(char **primers, int num_primer, Score_Param score_param,
+                    int num_thread, Primer_Summary *summaries);
+float summary_mean(double sum, int count);
+void write_pool_summary(FILE *outfile, char **primers, int num_primer,
+                        Primer_Summary *summaries, int precision);
+
+/******* Benchmarks (swinc -b) ***********/
+void run_swinc_benchmarks(FILE *outfile, Dimer_Prefilter prefilter);
+
+/******* Reentrant alignment API **********/
+/* the state of one thread's alignments: scoring parameters,
+ * the last query and its profile (kernel scratch included),
+ * and the arena of everything that lives for one alignment */
+typedef struct {
+    Score_Param score_param;
+    char *query;
+    Query_Profile *profile;
+    Arena *arena;
+} SW_Aligner;
+
+/* a pool of primers, primers[i] and its reverse complement
+ * rc_primers[i] for i < num_primer */
+typedef struct {
+    int num_primer;
+    int capacity;
+    char **primers;
+    char **rc_primers;
+} Primer_Pool;
+
+SW_Aligner *create_aligner(Score_Param score_param);
+void free_aligner(SW_Aligner *aligner);
+float aligner_score(SW_Aligner *aligner, char *ref, char *query);
+SW_Alignment aligner_align(SW_Aligner *aligner, char *ref, char *query);
+void format_alignments(SW_Aligner *aligner, char **refs, char **queries,
+                       int num_pair, Text_Buffer *buffer);
+Primer_Pool *create_primer_pool(void);
+int add_primer(Primer_Pool *primer_pool, char *primer);
+void free_primer_pool(Primer_Pool *primer_pool);
+void align_primer_pool(SW_Aligner *aligner, Primer_Pool *primer_pool,
+                       float *matrix);
+
 
 
 
 
 /**** Utilities Routines *****/
-void print_sw_matrix(int nrow, int ncol);
-void print_alignment(int nrow, int ncol);
-char *prepend_char(char *string, char c);
-int *best_entry(int nrow, int ncol);
+void print_sw_matrix(SW_entry **sw_matrix, int nrow, int ncol);
+void print_alignment(char *ref, char *query, Score_Param score_param);
 void print_interaction_matrix(int nrow, int ncol);
 char *rev_complement(char *seq, int result_len);
+char *arena_rev_complement(Arena *arena, char *seq, int result_len);
 float mean(float num_list[], int list_len);
 char *trim_whitespace(char *input);
 User_Inputs parse_args(int argc, char **argv);
@@ -121,16 +484,8 @@ enum
     ERROR_MEM_ALLOC = 1
 };
 
-void error_handle(int error_code)
-{
-    fprintf(stderr, "%s error:\n", PROGRAM_NAME);
-    switch (error_code)
-    {
-        case ERROR_MEM_ALLOC:
-            fprintf(stderr, "Memory allocation error");
-            break;
-    }
-}
+void error_handle(int error_code);
+void *allocate(size_t size);
 
 
 
@@ -142,219 +497,19 @@ void error_handle(int error_code)
  * **********************************************/
 
 #define ABSOLUTE_ZERO_OFFSET 273.15
-float Reaction_Temperature;
+extern float Reaction_Temperature;
 
 typedef struct {
     char *neighbour;
-    float dH_dS[2];
+    float delH;
+    float delS;
 } Therm_Param;
 
-Therm_Param Initialisation[] = {
-    "init", {0, 0}, 
-    "init_A/T", {2.3, 4.1}, 
-    "init_G/C", {0.1, -2.8},
-    "init_oneG/C", {0, 0}, 
-    "init_allA/T", {0, 0}, 
-    "init_5T/A", {0, 0},
-    "sym", {0, -1.4},
-};
+extern Therm_Param Initialisation[];
+extern Therm_Param Match[];
+extern Therm_Param Internal_Mismatch[];
+extern Therm_Param Terminal_Mismatch[];
+extern Therm_Param Dangling_End[];
 
-Therm_Param Match[] = {
-    "AA/TT", {-7.9, -22.2}, 
-    "AT/TA", {-7.2, -20.4}, 
-    "TA/AT", {-7.2, -21.3},
-    "CA/GT", {-8.5, -22.7}, 
-    "GT/CA", {-8.4, -22.4}, 
-    "CT/GA", {-7.8, -21.0},
-    "GA/CT", {-8.2, -22.2}, 
-    "CG/GC", {-10.6, -27.2}, 
-    "GC/CG", {-9.8, -24.4},
-    "GG/CC", {-8.0, -19.9}
-};
-
-// Internal mismatch and inosine table {DNA}
-// Allawi & SantaLucia {1997}, Biochemistry 36, 10581-10594
-// Allawi & SantaLucia {1998}, Biochemistry 37, 9435-9444
-// Allawi & SantaLucia {1998}, Biochemistry 37, 2170-2179
-// Allawi & SantaLucia {1998}, Nucl Acids Res 26, 2694-2701
-// Peyret et al. {1999}, Biochemistry 38, 3468-3477
-// Watkins & SantaLucia {2005}, Nucl Acids Res 33, 6258-6267
-Therm_Param Internal_Mismatch[] = {
-    "AG/TT", {1.0, 0.9}, 
-    "AT/TG", {-2.5, -8.3}, 
-    "CG/GT", {-4.1, -11.7},
-    "CT/GG", {-2.8, -8.0}, 
-    "GG/CT", {3.3, 10.4}, 
-    "GG/TT", {5.8, 16.3},
-    "GT/CG", {-4.4, -12.3}, 
-    "GT/TG", {4.1, 9.5}, 
-    "TG/AT", {-0.1, -1.7},
-    "TG/GT", {-1.4, -6.2},
-    "TT/AG", {-1.3, -5.3},
-    "AA/TG", {-0.6, -2.3},
-    "AG/TA", {-0.7, -2.3},
-    "CA/GG", {-0.7, -2.3},
-    "CG/GA", {-4.0, -13.2},
-    "GA/CG", {-0.6, -1.0},
-    "GG/CA", {0.5, 3.2},
-    "TA/AG", {0.7, 0.7},
-    "TG/AA", {3.0, 7.4},
-    "AC/TT", {0.7, 0.2},
-    "AT/TC", {-1.2, -6.2},
-    "CC/GT", {-0.8, -4.5},
-    "CT/GC", {-1.5, -6.1},
-    "GC/CT", {2.3, 5.4},
-    "GT/CC", {5.2, 13.5},
-    "TC/AT", {1.2, 0.7},
-    "TT/AC", {1.0, 0.7},
-    "AA/TC", {2.3, 4.6}, 
-    "AC/TA", {5.3, 14.6}, 
-    "CA/GC", {1.9, 3.7},
-    "CC/GA", {0.6, -0.6}, 
-    "GA/CC", {5.2, 14.2}, 
-    "GC/CA", {-0.7, -3.8},
-    "TA/AC", {3.4, 8.0}, 
-    "TC/AA", {7.6, 20.2},
-    "AA/TA", {1.2, 1.7}, 
-    "CA/GA", {-0.9, -4.2}, 
-    "GA/CA", {-2.9, -9.8},
-    "TA/AA", {4.7, 12.9}, 
-    "AC/TC", {0.0, -4.4}, 
-    "CC/GC", {-1.5, -7.2},
-    "GC/CC", {3.6, 8.9}, 
-    "TC/AC", {6.1, 16.4}, 
-    "AG/TG", {-3.1, -9.5},
-    "CG/GG", {-4.9, -15.3}, 
-    "GG/CG", {-6.0, -15.8}, 
-    "TG/AG", {1.6, 3.6},
-    "AT/TT", {-2.7, -10.8}, 
-    "CT/GT", {-5.0, -15.8}, 
-    "GT/CT", {-2.2, -8.4},
-    "TT/AT", {0.2, -1.5},
-    "AI/TC", {-8.9, -25.5}, 
-    "TI/AC", {-5.9, -17.4}, 
-    "AC/TI", {-8.8, -25.4},
-    "TC/AI", {-4.9, -13.9}, 
-    "CI/GC", {-5.4, -13.7}, 
-    "GI/CC", {-6.8, -19.1},
-    "CC/GI", {-8.3, -23.8}, 
-    "GC/CI", {-5.0, -12.6},
-    "AI/TA", {-8.3, -25.0}, 
-    "TI/AA", {-3.4, -11.2}, 
-    "AA/TI", {-0.7, -2.6},
-    "TA/AI", {-1.3, -4.6}, 
-    "CI/GA", {2.6, 8.9}, 
-    "GI/CA", {-7.8, -21.1},
-    "CA/GI", {-7.0, -20.0}, 
-    "GA/CI", {-7.6, -20.2},
-    "AI/TT", {0.49, -0.7}, 
-    "TI/AT", {-6.5, -22.0}, 
-    "AT/TI", {-5.6, -18.7},
-    "TT/AI", {-0.8, -4.3}, 
-    "CI/GT", {-1.0, -2.4}, 
-    "GI/CT", {-3.5, -10.6},
-    "CT/GI", {0.1, -1.0}, 
-    "GT/CI", {-4.3, -12.1},
-    "AI/TG", {-4.9, -15.8}, 
-    "TI/AG", {-1.9, -8.5}, 
-    "AG/TI", {0.1, -1.8},
-    "TG/AI", {1.0, 1.0}, 
-    "CI/GG", {7.1, 21.3}, 
-    "GI/CG", {-1.1, -3.2},
-    "CG/GI", {5.8, 16.9}, 
-    "GG/CI", {-7.6, -22.0},
-    "AI/TI", {-3.3, -11.9}, 
-    "TI/AI", {0.1, -2.3}, 
-    "CI/GI", {1.3, 3.0},
-    "GI/CI", {-0.5, -1.3}
-};
 
-// Terminal mismatch table (DNA)
-// SantaLucia & Peyret (2001) Patent Application WO 01/94611
-Therm_Param Terminal_Mismatch[] = {
-    "AA/TA", {-3.1, -7.8}, 
-    "TA/AA", {-2.5, -6.3}, 
-    "CA/GA", {-4.3, -10.7},
-    "GA/CA", {-8.0, -22.5},
-    "AC/TC", {-0.1, 0.5}, 
-    "TC/AC", {-0.7, -1.3}, 
-    "CC/GC", {-2.1, -5.1},
-    "GC/CC", {-3.9, -10.6},
-    "AG/TG", {-1.1, -2.1}, 
-    "TG/AG", {-1.1, -2.7}, 
-    "CG/GG", {-3.8, -9.5},
-    "GG/CG", {-0.7, -19.2},
-    "AT/TT", {-2.4, -6.5}, 
-    "TT/AT", {-3.2, -8.9}, 
-    "CT/GT", {-6.1, -16.9},
-    "GT/CT", {-7.4, -21.2},
-    "AA/TC", {-1.6, -4.0}, 
-    "AC/TA", {-1.8, -3.8}, 
-    "CA/GC", {-2.6, -5.9},
-    "CC/GA", {-2.7, -6.0}, 
-    "GA/CC", {-5.0, -13.8},
-    "GC/CA", {-3.2, -7.1},
-    "TA/AC", {-2.3, -5.9},
-    "TC/AA", {-2.7, -7.0},
-    "AC/TT", {-0.9, -1.7},
-    "AT/TC", {-2.3, -6.3}, 
-    "CC/GT", {-3.2, -8.0},
-    "CT/GC", {-3.9, -10.6}, 
-    "GC/CT", {-4.9, -13.5}, 
-    "GT/CC", {-3.0, -7.8},
-    "TC/AT", {-2.5, -6.3}, 
-    "TT/AC", {-0.7, -1.2},
-    "AA/TG", {-1.9, -4.4}, 
-    "AG/TA", {-2.5, -5.9}, 
-    "CA/GG", {-3.9, -9.6},
-    "CG/GA", {-6.0, -15.5}, 
-    "GA/CG", {-4.3, -11.1}, 
-    "GG/CA", {-4.6, -11.4},
-    "TA/AG", {-2.0, -4.7}, 
-    "TG/AA", {-2.4, -5.8},
-    "AG/TT", {-3.2, -8.7}, 
-    "AT/TG", {-3.5, -9.4}, 
-    "CG/GT", {-3.8, -9.0},
-    "CT/GG", {-6.6, -18.7}, 
-    "GG/CT", {-5.7, -15.9}, 
-    "GT/CG", {-5.9, -16.1},
-    "TG/AT", {-3.9, -10.5}, 
-    "TT/AG", {-3.6, -9.8}
-};
-
-// Dangling ends table {DNA}
-// Bommarito et al. {2000}, Nucl Acids Res 28, 1929-1934
-Therm_Param Dangling_End[] = {
-    "AA/.T", {0.2, 2.3}, 
-    "AC/.G", {-6.3, -17.1}, 
-    "AG/.C", {-3.7, -10.0},
-    "AT/.A", {-2.9, -7.6}, 
-    "CA/.T", {0.6, 3.3},
-    "CC/.G", {-4.4, -12.6},
-    "CG/.C", {-4.0, -11.9},
-    "CT/.A", {-4.1, -13.0},
-    "GA/.T", {-1.1, -1.6},
-    "GC/.G", {-5.1, -14.0},
-    "GG/.C", {-3.9, -10.9},
-    "GT/.A", {-4.2, -15.0},
-    "TA/.T", {-6.9, -20.0},
-    "TC/.G", {-4.0, -10.9},
-    "TG/.C", {-4.9, -13.8},
-    "TT/.A", {-0.2, -0.5},
-    ".A/AT", {-0.7, -0.8},
-    ".C/AG", {-2.1, -3.9},
-    ".G/AC", {-5.9, -16.5},
-    ".T/AA", {-0.5, -1.1},
-    ".A/CT", {4.4, 14.9},
-    ".C/CG", {-0.2, -0.1},
-    ".G/CC", {-2.6, -7.4},
-    ".T/CA", {4.7, 14.2},
-    ".A/GT", {-1.6, -3.6},
-    ".C/GG", {-3.9, -11.2},
-    ".G/GC", {-3.2, -10.4},
-    ".T/GA", {-4.1, -13.1},
-    ".A/TT", {2.9, 10.4},
-    ".C/TG", {-4.4, -13.1},
-    ".G/TC", {-5.2, -15.0},
-    ".T/TA", {-3.8, -12.6}
-};
+#endif /* SWINC_H */
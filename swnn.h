@@ -2,6 +2,10 @@
  * !! Put summary of the various 
  * !! names, variables and routine defined here.
  */
+#include "arena.h"
+#include "instrument.h"
+#include "simd.h"
+
 #define TRUE 1
 #define FALSE 0
 #define MATCH 'M'
@@ -12,6 +16,27 @@
 
 #define ABSOLUTE_ZERO_OFFSET 273.15
 
+/* Bases are encoded once, when a sequence enters the DP (see
+ * encode_sequence()), into CODE_BITS bit codes. A, C, G and T get
+ * their digit in the internal nn data so that complementary codes
+ * are those that XOR to 3; inosine and the '.' of a dangling end
+ * follow. Anything else is refused at encoding. */
+#define CODE_BITS 3
+#define CODE_A 0
+#define CODE_C 1
+#define CODE_G 2
+#define CODE_T 3
+#define CODE_I 4
+#define CODE_DOT 5
+#define CODE_INVALID 7
+#define IS_COMPLEMENT(code1, code2) \
+    ((((code1) ^ (code2)) == 3) && (((code1) | (code2)) <= CODE_T))
+/* the 4 codes of a Neighbour side by side, top5 first */
+#define NN_CODE_INDEX(top5, top3, bottom3, bottom5) \
+    (((top5) << (3 * CODE_BITS)) | ((top3) << (2 * CODE_BITS)) | \
+     ((bottom3) << CODE_BITS) | (bottom5))
+#define NUM_NN_CODE (1 << (4 * CODE_BITS))
+
 #define INTERNAL_A 0
 #define INTERNAL_C 1
 #define INTERNAL_G 2
@@ -71,9 +96,10 @@ typedef struct
 } Coord;
 
 
-/* The structure that represent the a NN pairing. 
+/* The structure that represent the a NN pairing,
+ * bases are encoded (CODE_A, ..., CODE_DOT). 
  * e.g. Given:
- * top5 = 'A', top3 = 'G', bottom3 = 'T', bottom5 = 'C'
+ * top5 = CODE_A, top3 = CODE_G, bottom3 = CODE_T, bottom5 = CODE_C
  * We have the following binding:
  * 5'-AG-3'
  *    ||
@@ -100,38 +126,198 @@ typedef struct {
     float delS;
 } Therm_Param;
 
+/* The delG of every nn data record at one reaction temperature
+ * (Celsius) and salt concentration (mMol), indexed by NN_CODE_INDEX()
+ * of the neighbour (0.0 where there's no record).
+ * Computed once by init_thermo_context(), so that a lookup in the
+ * DP is a single load; changing conditions is changing context.
+ * A table is NUM_NN_CODE floats (16 KB) for 256 or 625 records. */
+typedef struct {
+    float temperature;
+    float salt_concentration;
+    float delG_internal[NUM_NN_CODE];
+    float delG_terminal[NUM_NN_CODE];
+    float delG_init_AT;
+    float delG_init_GC;
+} Thermo_Context;
+
+
+
+/* The lowest delG of a duplex and the entry and decision it ends
+ * in. Kept by the fills as they go: over the whole sw_matrix as
+ * find_best_entry_coord() picks it, or over the last row and column
+ * as find_best_decision() does by the score-only duplex DP (see
+ * duplex_score_routines.c). */
+typedef struct
+{
+    float delG;
+    Coord coord;
+} Duplex_Hit;
+
+/* Structure of arrays layout of the sw_matrix.
+ * Every field of the record of every decision lives in its own
+ * contiguous array of nrow x ncol entries (row major), so a pass
+ * over the matrix only streams the fields it actually reads.
+ * Loop lengths are kept in a byte, so the sequences are at most
+ * MAX_DUPLEX_MATRIX_LEN bases (a loop is never longer than its
+ * strand); previous and current decision are packed into one
+ * byte as 2 decision codes (see DECISION_CODE_BITS). */
+#define MAX_DUPLEX_MATRIX_LEN 255
+#define NUM_DECISION 4
+#define DECISION_CODE_BITS 3
+enum
+{
+    DECISION_BIND = 0,
+    DECISION_TOP_BULGE = 1,
+    DECISION_BOTTOM_BULGE = 2,
+    DECISION_STOP = 3
+};
+
+typedef struct
+{
+    int nrow;
+    int ncol;
+    float *delG[NUM_DECISION];
+    unsigned char *top_loop_len[NUM_DECISION];
+    unsigned char *bottom_loop_len[NUM_DECISION];
+    unsigned char *decisions[NUM_DECISION];
+    Duplex_Hit lowest;   // as find_best_entry_coord() finds it, kept by the fill
+} Duplex_Matrix;
+
+/* What the fused duplex kernel looks up, fetched once per fill:
+ * the internal nn delG table of the thermo context and the loop
+ * scores that don't depend on the records (see
+ * duplex_kernel_routines.c). */
+typedef struct
+{
+    const float *delG_internal;
+    float bulge_one;            // bulge_score(1)
+    float top_bulge_two;        // internal_loop_score(2, 0)
+    float bottom_bulge_two;     // internal_loop_score(0, 2)
+} Duplex_Constants;
+
+/* The bound of the pruned duplex screen (see duplex_score_routines.c):
+ * the nn delG table, loop scores and first column entries of the
+ * thermo context the floors of the entries of a duplex are made
+ * from. Made once for a screen, for sequences of at most max_len
+ * bases. */
+typedef struct
+{
+    float threshold;            // pairs that can't go below it are pruned
+    int max_len;
+    Duplex_Constants constants;
+    float restart_floor;        // lowest record of a first column entry, or 0
+    float loop_floor;           // lowest internal_loop_score(), or 0
+} Duplex_Bound;
+
+/* The duplex kernel bound to simd_level() (see simd.h): the fill
+ * of complete_duplex_matrix_soa() and complete_duplex_matrix_arena().
+ * The cells are nearest neighbour table lookups, the scalar fill is
+ * bound at every level until a vector kernel comes. */
+typedef struct
+{
+    int level;
+    void (*fill)(Duplex_Matrix *matrix, unsigned char *ref, unsigned char *query);
+} Duplex_Kernels;
+
 
 
 /************************** ALIGNMENT ROUTINES ******************************/
-SW_Entry **complete_duplex_matrix(char *ref, char *query);
-SW_Entry **initialise_duplex_matrix(char *ref, char *query);
+SW_Entry **complete_duplex_matrix(char *ref, char *query, Duplex_Hit *lowest);
+SW_Entry **initialise_duplex_matrix(unsigned char *ref, unsigned char *query,
+                                    int nrow, int ncol);
 SW_Entry compute_entry(SW_Entry **sw_matrix, 
                        int row, int col, 
-                       char *ref, char *query);
+                       unsigned char *ref, unsigned char *query);
+Coord find_best_decision(SW_Entry **sw_matrix, int nrow, int ncol);
 Coord find_best_entry_coord(SW_Entry **sw_matrix, int nrow, int ncol);
 
+Duplex_Matrix *allocate_duplex_matrix(int nrow, int ncol);
+Duplex_Matrix *arena_duplex_matrix(Arena *arena, int nrow, int ncol);
+void free_duplex_matrix(Duplex_Matrix *matrix);
+Decision_Record get_duplex_record(Duplex_Matrix *matrix,
+                                  int row, int col, int decision);
+void set_duplex_record(Duplex_Matrix *matrix,
+                       int row, int col, int decision,
+                       Decision_Record record);
+Duplex_Matrix *complete_duplex_matrix_soa(char *ref, char *query);
+Duplex_Matrix *complete_duplex_matrix_at(char *ref, char *query,
+                                         const Thermo_Context *context);
+Duplex_Matrix *complete_duplex_matrix_arena(char *ref, char *query,
+                                            Arena *arena);
+Coord find_best_duplex_coord(Duplex_Matrix *matrix);
+const Duplex_Kernels *duplex_kernels(void);
+void init_duplex_constants(Duplex_Constants *constants);
+void fuse_duplex_row(const Duplex_Constants *constants,
+                     unsigned char *ref, unsigned char *query,
+                     int row, int ncol, const SW_Entry *up_row,
+                     SW_Entry *entries, Duplex_Hit *lowest);
+void keep_lowest_record(const SW_Entry *entry, int row, int col,
+                        Duplex_Hit *lowest);
+Duplex_Hit score_duplex(char *ref, char *query);
+Duplex_Hit score_duplex_arena(char *ref, char *query, Arena *arena);
+void init_duplex_bound(Duplex_Bound *bound, float threshold, int max_len);
+int prune_duplex_arena(char *ref, char *query, const Duplex_Bound *bound,
+                       Arena *arena, Duplex_Hit *hit);
+int screen_duplex_pool(char **primers, int num_primer,
+                       const Duplex_Bound *bound, Arena *arena, float *delGs);
+
 /************************** SCORING ROUTINES ******************************/
 Decision_Record score_bind(SW_Entry **sw_matrix,
                             int row, int col,
-                            char *ref, char *query);
+                            unsigned char *ref, unsigned char *query);
 Decision_Record score_top_bulge(SW_Entry **sw_matrix,
                                 int row, int col,
-                                char *ref, char *query);
+                                unsigned char *ref, unsigned char *query);
 Decision_Record score_bottom_bulge(SW_Entry **sw_matrix,
                                    int row, int col,
-                                   char *ref, char *query);
+                                   unsigned char *ref, unsigned char *query);
 Decision_Record score_stop(SW_Entry **sw_matrix,
                            int row, int col,
-                           char *ref, char *query);
+                           unsigned char *ref, unsigned char *query);
+Decision_Record bind_continuation(Decision_Record prev_bind,
+                                  Decision_Record prev_top_bulge,
+                                  Decision_Record prev_bottom_bulge,
+                                  int row, int col,
+                                  unsigned char *ref, unsigned char *query);
+Decision_Record top_bulge_continuation(Decision_Record prev_bind,
+                                       Decision_Record prev_bulge,
+                                       int row, int col,
+                                       unsigned char *ref, unsigned char *query);
+Decision_Record bottom_bulge_continuation(Decision_Record prev_bind,
+                                          Decision_Record prev_bulge,
+                                          int row, int col,
+                                          unsigned char *ref, unsigned char *query);
+Decision_Record stop_continuation(Decision_Record prev_bind,
+                                  Decision_Record prev_top_bulge,
+                                  Decision_Record prev_bottom_bulge,
+                                  int row, int col,
+                                  unsigned char *ref, unsigned char *query);
+SW_Entry _handle_first_entry(unsigned char first_ref, unsigned char first_query);
+SW_Entry _handle_init_row_col(Neighbour nn_config);
+SW_Entry **_allocate_matrix(int nrow, int ncol);
 
 /********************** THERMODYNAMICS ROUTINES ****************************/
 float internal_loop_score(int top_loop_len, int bottom_loop_len);
 float bulge_score(int loop_len);
 int _get_index_internal(Neighbour nn_config);
 int _get_index_terminal(Neighbour nn_config);
+void init_thermo_context(Thermo_Context *context,
+                         float temperature, float salt_concentration);
+void set_thermo_context(const Thermo_Context *context);
+const Thermo_Context *thermo_context(void);
+extern __thread const Thermo_Context *GLOBAL_thermo_context;
 float get_delG_internal(Neighbour nn_config);
 float get_delG_terminal(Neighbour nn_config);
-float init_delG(char base);
+float init_delG(unsigned char base);
+
+/************************** ENCODING ROUTINES ******************************/
+unsigned char encode_base(char base);
+unsigned char *encode_sequence(char *seq);
+unsigned char *arena_encode_sequence(Arena *arena, char *seq);
+
+/************************** BENCHMARK ROUTINES *****************************/
+void run_swnn_benchmarks(FILE *outfile);
 
 /************************** UTILITIES ROUTINES ******************************/
 char complement(char base);
@@ -0,0 +1,1579 @@
+/************************** SWINC EQUIVALENCE TESTS *************************
+ * Every swinc engine against a naive DP of the same recurrences (three
+ * full matrices, M from the best of the diagonal, I from above, D from
+ * the left), on random pairs of 1 to TEST_MAX_LEN bases and a few of
+ * TEST_LONG_LEN, with TEST_NUM_PARAM scoring schemes:
+ *   - swalign() (fill_matrix()) and swalign_linear(), score and end
+ *     (of the scores above 0),
+ *   - swalign_striped(),
+ *   - swalign_batch() and the batch kernel of every level the host runs,
+ *   - aligner_score() of an SW_Aligner, on queries repeated and not,
+ *     and of two aligners in two threads at once (with swalign()),
+ *   - align_linear_space() (Hirschberg) and align_packed(): the score,
+ *     and a path that scores it between the ends it claims,
+ * and on random pools of TEST_POOL_SIZE primers:
+ *   - align_pool(), align_pool_symmetric() and align_pool_parallel()
+ *     against the naive interaction matrix,
+ *   - summarise_pool() against the max and sum of its rows and columns,
+ *   - align_pool_prefiltered() against align_pool() on the pairs it
+ *     does not prune,
+ * and the screen kernel of every level the host runs against
+ * dimer_runs() and passes_prefilter(), on random refs and queries of
+ * 1 to PACKED_MAX_LEN bases with runs planted at the 3' ends.
+ * Interaction matrix files are written, mapped and looked up against
+ * the naive matrix, and files with a wrong magic, version, byte order,
+ * pool or length are turned down.
+ * align_pool_sparse() is checked against the naive matrix for the
+ * entries it keeps (ties on the lower query_index), and read_primers()
+ * on a file of blank, padded and long lines.
+ * format_cigar(), format_gapped() and format_alignments() are compared
+ * with golden text, on paths with leading and trailing gaps and clips.
+ * The arena is checked for alignment, overflow blocks and reuse once
+ * it has grown to its high water mark.
+ * format_float() is compared with printf("%.*f"), and the reports of
+ * write_interaction_report() and print_interaction_matrix() with the
+ * text the old printf() loop of print_interaction_matrix() wrote.
+ * Scores are compared exactly: with whole scores every engine's sums
+ * are exact. The engines bound by swinc_kernels() are the ones of
+ * SWINC_SIMD, make test runs this at every level.
+ * Exits with EXIT_FAILURE if any check fails.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "swinc.h"
+
+#define TEST_SEED 20240601
+#define TEST_NUM_PAIR 2000
+#define TEST_MAX_LEN 80
+#define TEST_NUM_LONG_PAIR 8
+#define TEST_LONG_LEN 400
+#define TEST_POOL_SIZE 150
+#define TEST_NUM_PARAM 2
+#define TEST_NUM_SCREEN_SEQ 61 // not a multiple of PREFILTER_LANES
+#define TEST_NUM_PREFILTER 5
+#define TEST_NUM_FLOAT 20000
+#define TEST_REPORT_ROWS 600 // more than 2 blocks of rows
+#define TEST_REPORT_COLS 7
+#define TEST_SPARSE_POOL_SIZE 60
+#define TEST_NUM_SPARSE_FILTER 6
+
+static const Score_Param test_params[TEST_NUM_PARAM] = {
+    {DEFAULT_MATCH_SCORE, DEFAULT_MISMATCH_PENALTY,
+     DEFAULT_GAP_OPEN_PENALTY, DEFAULT_GAP_EXTENSION_PENALTY},
+    {2.0, -1.0, -3.0, -1.0}
+};
+
+// the defaults, no anchored runs, anchored runs longer than min_run,
+// every pair, and runs of a base
+static const Dimer_Prefilter test_prefilters[TEST_NUM_PREFILTER] = {
+    {DEFAULT_MIN_RUN, DEFAULT_MIN_ANCHORED_RUN}, {5, 0}, {3, 6}, {0, 0}, {1, 1}
+};
+
+/* the pairs every pair check runs on */
+typedef struct {
+    char **refs;
+    char **queries;
+    int num_pair;
+} Test_Pairs;
+
+/* the pairs a thread of check_aligner_threads() scores, and the
+ * naive scores of its parameters */
+typedef struct {
+    Test_Pairs *pairs;
+    int param;
+    const float *expected;
+    int num_fail;
+} Aligner_Job;
+
+static int check_full_matrix(Test_Pairs *pairs);
+static int check_striped(Test_Pairs *pairs);
+static int check_batch(Test_Pairs *pairs);
+static int check_alignments(Test_Pairs *pairs);
+static int check_aligner(Test_Pairs *pairs);
+static int check_aligner_threads(Test_Pairs *pairs);
+static void *run_aligner_job(void *arg);
+static int check_pools(void);
+static int check_summaries(void);
+static int check_screens(void);
+static int check_prefiltered_pool(void);
+static int check_matrix_file(void);
+static int check_bad_matrix_files(void);
+static int check_sparse(void);
+static int check_read_primers(void);
+static int check_alignment_reports(void);
+static int check_arena(void);
+static int check_format_float(void);
+static int check_reports(void);
+static SW_Hit reference_hit(char *ref, char *query, Score_Param score_param);
+static float *reference_matrix(char **primers, int num_primer,
+                               Score_Param score_param);
+static int same_alignment(SW_Alignment *alignment, char *ref, char *query,
+                          Score_Param score_param, float expected);
+static void make_pairs(Test_Pairs *pairs);
+static void free_pairs(Test_Pairs *pairs);
+static void make_pool(char **primers, int num_primer);
+static void random_sequence(char *seq, int len);
+static void make_screen_seqs(char (*refs)[PACKED_MAX_LEN +1],
+                             char (*queries)[PACKED_MAX_LEN +1], int num_seq);
+static void plant_run(char *ref, char *query);
+static void old_report(Text_Buffer *text, char **names, int nrow, int ncol,
+                       Report_Options options);
+static void append_text(Text_Buffer *text, const char *format, ...);
+static char *read_back(FILE *file);
+static void write_bytes(const char *filename, const char *bytes, size_t len);
+static int silence_stderr(void);
+static void restore_stderr(int saved_stderr);
+static int report(const char *name, int num_fail, int num_test);
+
+
+int main(void)
+{
+    Test_Pairs pairs;
+    int num_fail = 0;
+    INSTRUMENT_INIT();
+    printf("kernels of level %s\n", simd_level_name(swinc_kernels()->level));
+    srand(TEST_SEED);
+    make_pairs(&pairs);
+    num_fail += check_full_matrix(&pairs);
+    num_fail += check_striped(&pairs);
+    num_fail += check_batch(&pairs);
+    num_fail += check_alignments(&pairs);
+    num_fail += check_aligner(&pairs);
+    num_fail += check_aligner_threads(&pairs);
+    num_fail += check_pools();
+    num_fail += check_summaries();
+    num_fail += check_screens();
+    num_fail += check_prefiltered_pool();
+    num_fail += check_matrix_file();
+    num_fail += check_bad_matrix_files();
+    num_fail += check_sparse();
+    num_fail += check_read_primers();
+    num_fail += check_alignment_reports();
+    num_fail += check_arena();
+    num_fail += check_format_float();
+    num_fail += check_reports();
+    free_pairs(&pairs);
+    return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* check_full_matrix: swalign(), the best of fill_matrix(), and
+ * swalign_linear() against the naive DP, score and end */
+static int check_full_matrix(Test_Pairs *pairs)
+{
+    SW_Hit expected, hit;
+    int k, param;
+    int num_fail = 0, num_linear_fail = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            expected = reference_hit(pairs->refs[k], pairs->queries[k],
+                                     test_params[param]);
+            num_fail += swalign(pairs->refs[k], pairs->queries[k],
+                                test_params[param]) != expected.score;
+            hit = swalign_linear(pairs->refs[k], pairs->queries[k],
+                                 test_params[param]);
+            // a score of 0 or less has no end to agree on
+            num_linear_fail += hit.score != expected.score ||
+                               (expected.score > 0.0 &&
+                                (hit.row != expected.row || hit.col != expected.col));
+        }
+    }
+    report("swalign() == naive DP", num_fail, TEST_NUM_PARAM * pairs->num_pair);
+    report("swalign_linear() == naive DP, score and end", num_linear_fail,
+           TEST_NUM_PARAM * pairs->num_pair);
+    return num_fail + num_linear_fail;
+}
+
+/* check_striped: the striped kernel against the naive DP */
+static int check_striped(Test_Pairs *pairs)
+{
+#ifdef __SSE2__
+    int k, param;
+    int num_fail = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            num_fail += swalign_striped(pairs->refs[k], pairs->queries[k],
+                                        test_params[param]) !=
+                        reference_hit(pairs->refs[k], pairs->queries[k],
+                                      test_params[param]).score;
+        }
+    }
+    return report("swalign_striped() == naive DP", num_fail,
+                  TEST_NUM_PARAM * pairs->num_pair);
+#else
+    return report("swalign_striped() (not built)", 0, 0);
+#endif
+}
+
+/* check_batch: swalign_batch() (the bound kernel) and the batch
+ * kernel of every level up to the host's against the naive DP */
+static int check_batch(Test_Pairs *pairs)
+{
+    typedef void (*Batch_Kernel)(char **refs, char **queries, int num_pair,
+                                 Score_Param score_param, float *scores,
+                                 Arena *arena);
+    Batch_Kernel batch_kernels[NUM_SIMD_LEVEL] = {swalign_batch_scalar};
+    const char *names[NUM_SIMD_LEVEL +1] = {
+        "swalign_batch_scalar() == naive DP", "swalign_batch_sse() == naive DP",
+        "swalign_batch_avx2() == naive DP", "swalign_batch_avx512() == naive DP",
+        "swalign_batch() == naive DP"
+    };
+#ifdef __SSE2__
+    batch_kernels[SIMD_SSE2] = swalign_batch_sse;
+#endif
+#ifdef SIMD_WIDE_KERNELS
+    batch_kernels[SIMD_AVX2] = swalign_batch_avx2;
+    batch_kernels[SIMD_AVX512] = swalign_batch_avx512;
+#endif
+    float *scores = allocate(sizeof(float) * pairs->num_pair);
+    float *expected = allocate(sizeof(float) * TEST_NUM_PARAM * pairs->num_pair);
+    Arena *arena = create_arena(0);
+    int k, param, level, num_level_fail;
+    int num_fail = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            expected[param * pairs->num_pair + k] =
+                reference_hit(pairs->refs[k], pairs->queries[k],
+                              test_params[param]).score;
+        }
+    }
+    // level NUM_SIMD_LEVEL is swalign_batch(), the others their kernel
+    for (level = 0; level <= NUM_SIMD_LEVEL; level++)
+    {
+        if (level < NUM_SIMD_LEVEL &&
+            (level > detect_simd_level() || batch_kernels[level] == NULL))
+        {
+            continue;
+        }
+        num_level_fail = 0;
+        for (param = 0; param < TEST_NUM_PARAM; param++)
+        {
+            if (level == NUM_SIMD_LEVEL)
+            {
+                swalign_batch(pairs->refs, pairs->queries, pairs->num_pair,
+                              test_params[param], scores);
+            }else
+            {
+                batch_kernels[level](pairs->refs, pairs->queries, pairs->num_pair,
+                                     test_params[param], scores, arena);
+                arena_reset(arena);
+            }
+            for (k = 0; k < pairs->num_pair; k++)
+            {
+                num_level_fail += scores[k] != expected[param * pairs->num_pair + k];
+            }
+        }
+        num_fail += report(names[level], num_level_fail,
+                           TEST_NUM_PARAM * pairs->num_pair);
+    }
+    free(scores);
+    free(expected);
+    free_arena(arena);
+    return num_fail;
+}
+
+/* check_alignments: align_linear_space() and align_packed() give the
+ * score of the naive DP and a path scoring it */
+static int check_alignments(Test_Pairs *pairs)
+{
+    SW_Alignment alignment;
+    float expected;
+    int k, param;
+    int num_hirschberg_fail = 0, num_packed_fail = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            expected = reference_hit(pairs->refs[k], pairs->queries[k],
+                                     test_params[param]).score;
+            alignment = align_linear_space(pairs->refs[k], pairs->queries[k],
+                                           test_params[param]);
+            num_hirschberg_fail += !same_alignment(&alignment, pairs->refs[k],
+                                                   pairs->queries[k],
+                                                   test_params[param], expected);
+            free_alignment(&alignment);
+            alignment = align_packed(pairs->refs[k], pairs->queries[k],
+                                     test_params[param]);
+            num_packed_fail += !same_alignment(&alignment, pairs->refs[k],
+                                               pairs->queries[k],
+                                               test_params[param], expected);
+            free_alignment(&alignment);
+        }
+    }
+    report("align_linear_space() == naive DP, path scores it",
+           num_hirschberg_fail, TEST_NUM_PARAM * pairs->num_pair);
+    report("align_packed() == naive DP, path scores it",
+           num_packed_fail, TEST_NUM_PARAM * pairs->num_pair);
+    return num_hirschberg_fail + num_packed_fail;
+}
+
+/* check_aligner:
+ * aligner_score() against the naive DP and swalign(), with the kernels
+ * of the level make test runs this at: each pair in turn, then each of
+ * the first queries against num_repeat refs in a row (its profile
+ * reused) */
+static int check_aligner(Test_Pairs *pairs)
+{
+    const int num_repeat = 10;
+    SW_Aligner *aligner;
+    float expected, score;
+    int k, repeat, ref, param;
+    int num_fail = 0, num_test = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        aligner = create_aligner(test_params[param]);
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            expected = reference_hit(pairs->refs[k], pairs->queries[k],
+                                     test_params[param]).score;
+            score = aligner_score(aligner, pairs->refs[k], pairs->queries[k]);
+            num_fail += score != expected ||
+                        score != swalign(pairs->refs[k], pairs->queries[k],
+                                         test_params[param]);
+            num_test++;
+        }
+        for (k = 0; k < TEST_NUM_PAIR / num_repeat; k++)
+        {
+            for (repeat = 0; repeat < num_repeat; repeat++)
+            {
+                ref = (k + repeat * 97) % pairs->num_pair;
+                expected = reference_hit(pairs->refs[ref], pairs->queries[k],
+                                         test_params[param]).score;
+                num_fail += aligner_score(aligner, pairs->refs[ref],
+                                          pairs->queries[k]) != expected;
+                num_test++;
+            }
+        }
+        free_aligner(aligner);
+    }
+    char name[80];
+    snprintf(name, sizeof(name), "aligner_score() == swalign() == naive DP, %s",
+             simd_level_name(swinc_kernels()->level));
+    return report(name, num_fail, num_test);
+}
+
+/* check_aligner_threads:
+ * two threads, each with its aligner and its parameters, scoring all
+ * the pairs at once with aligner_score() and swalign() */
+static int check_aligner_threads(Test_Pairs *pairs)
+{
+    Aligner_Job jobs[TEST_NUM_PARAM];
+    pthread_t threads[TEST_NUM_PARAM];
+    float *expected = allocate(sizeof(float) * TEST_NUM_PARAM * pairs->num_pair);
+    int k, param;
+    int num_fail = 0;
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            expected[param * pairs->num_pair + k] =
+                reference_hit(pairs->refs[k], pairs->queries[k],
+                              test_params[param]).score;
+        }
+        jobs[param] = (Aligner_Job) {pairs, param,
+                                     expected + param * pairs->num_pair, 0};
+    }
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        if (pthread_create(&threads[param], NULL, run_aligner_job, &jobs[param]) != 0)
+        {
+            fprintf(stderr, "Cannot create thread %d\n", param);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        pthread_join(threads[param], NULL);
+        num_fail += jobs[param].num_fail;
+    }
+    free(expected);
+    return report("aligner_score(), swalign() in 2 threads == naive DP", num_fail,
+                  2 * TEST_NUM_PARAM * pairs->num_pair);
+}
+
+static void *run_aligner_job(void *arg)
+{
+    Aligner_Job *job = arg;
+    Test_Pairs *pairs = job->pairs;
+    SW_Aligner *aligner = create_aligner(test_params[job->param]);
+    int k, repeat;
+    for (repeat = 0; repeat < 2; repeat++)
+    {
+        for (k = 0; k < pairs->num_pair; k++)
+        {
+            job->num_fail += (repeat == 0) ?
+                aligner_score(aligner, pairs->refs[k], pairs->queries[k]) != job->expected[k] :
+                swalign(pairs->refs[k], pairs->queries[k],
+                        test_params[job->param]) != job->expected[k];
+        }
+    }
+    free_aligner(aligner);
+    return NULL;
+}
+
+/* check_pools: the pool engines' interaction_matrix against the naive
+ * one, for one primer and a pool of TEST_POOL_SIZE */
+static int check_pools(void)
+{
+    const char *names[] = {
+        "align_pool() == naive matrix", "align_pool_symmetric() == naive matrix",
+        "align_pool_parallel(), 1 thread == naive matrix",
+        "align_pool_parallel(), 3 threads, tiles of 16 == naive matrix"
+    };
+    Pool_Schedule schedules[] = {{1, 0, 0}, {3, 0, 16}};
+    const int pool_sizes[] = {1, TEST_POOL_SIZE};
+    char *primers[TEST_POOL_SIZE];
+    int engine, size, param, i, j, num_primer, num_engine_fail;
+    int num_fail = 0;
+    for (engine = 0; engine < 4; engine++)
+    {
+        num_engine_fail = 0;
+        for (size = 0; size < 2; size++)
+        {
+            num_primer = pool_sizes[size];
+            make_pool(primers, num_primer);
+            for (param = 0; param < TEST_NUM_PARAM; param++)
+            {
+                float *expected = reference_matrix(primers, num_primer,
+                                                   test_params[param]);
+                memset(interaction_matrix, 0xff, sizeof(interaction_matrix[0]) * num_primer);
+                switch (engine)
+                {
+                    case 0:
+                        align_pool(num_primer, test_params[param]);
+                        break;
+                    case 1:
+                        align_pool_symmetric(num_primer, test_params[param]);
+                        break;
+                    default:
+                        align_pool_parallel(num_primer, test_params[param],
+                                            schedules[engine -2]);
+                        break;
+                }
+                for (i = 0; i < num_primer; i++)
+                {
+                    for (j = 0; j < num_primer; j++)
+                    {
+                        num_engine_fail += interaction_matrix[i][j] !=
+                                           expected[i * num_primer + j];
+                    }
+                }
+                free(expected);
+            }
+            for (i = 0; i < num_primer; i++)
+            {
+                free(primers[i]);
+            }
+        }
+        num_fail += report(names[engine], num_engine_fail,
+                           TEST_NUM_PARAM * (1 + TEST_POOL_SIZE * TEST_POOL_SIZE));
+    }
+    return num_fail;
+}
+
+/* check_summaries: summarise_pool(), by 1 and 4 threads, against the
+ * rows and columns of the naive matrix without the diagonal */
+static int check_summaries(void)
+{
+    char *primers[TEST_POOL_SIZE];
+    Primer_Summary summaries[TEST_POOL_SIZE];
+    Primer_Summary expected;
+    const int num_threads[] = {1, 4};
+    int param, thread, i, j;
+    int num_fail = 0;
+    make_pool(primers, TEST_POOL_SIZE);
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        float *matrix = reference_matrix(primers, TEST_POOL_SIZE, test_params[param]);
+        for (thread = 0; thread < 2; thread++)
+        {
+            summarise_pool(primers, TEST_POOL_SIZE, test_params[param],
+                           num_threads[thread], summaries);
+            for (i = 0; i < TEST_POOL_SIZE; i++)
+            {
+                expected = (Primer_Summary) {0.0, 0.0, TEST_POOL_SIZE -1,
+                                             0.0, 0.0, TEST_POOL_SIZE -1};
+                for (j = 0; j < TEST_POOL_SIZE; j++)
+                {
+                    if (j == i)
+                    {
+                        continue;
+                    }
+                    float row_score = matrix[i * TEST_POOL_SIZE + j];
+                    float col_score = matrix[j * TEST_POOL_SIZE + i];
+                    expected.row_max = (row_score > expected.row_max) ?
+                                       row_score : expected.row_max;
+                    expected.col_max = (col_score > expected.col_max) ?
+                                       col_score : expected.col_max;
+                    expected.row_sum += row_score;
+                    expected.col_sum += col_score;
+                }
+                num_fail += summaries[i].row_max != expected.row_max ||
+                            summaries[i].row_sum != expected.row_sum ||
+                            summaries[i].row_count != expected.row_count ||
+                            summaries[i].col_max != expected.col_max ||
+                            summaries[i].col_sum != expected.col_sum ||
+                            summaries[i].col_count != expected.col_count;
+            }
+        }
+        free(matrix);
+    }
+    for (i = 0; i < TEST_POOL_SIZE; i++)
+    {
+        free(primers[i]);
+    }
+    return report("summarise_pool(), 1 and 4 threads == naive matrix", num_fail,
+                  2 * TEST_NUM_PARAM * TEST_POOL_SIZE);
+}
+
+
+/* check_screens:
+ * the screen kernel of every level, and screen_dimers(), against
+ * passes_prefilter() of dimer_runs() for every ref and query of
+ * TEST_NUM_SCREEN_SEQ, the refs PREFILTER_LANES at a time (fewer
+ * in the last lanes) */
+static int check_screens(void)
+{
+    typedef unsigned (*Screen_Kernel)(const Prefilter_Lanes *lanes,
+                                      const Packed_Seq *query,
+                                      Dimer_Prefilter prefilter);
+    Screen_Kernel screen_kernels[NUM_SIMD_LEVEL +1] = {
+        screen_dimers_scalar, screen_dimers_scalar, NULL, NULL, screen_dimers
+    };
+    const char *names[NUM_SIMD_LEVEL +1] = {
+        "screen_dimers_scalar() == dimer_runs()", "",
+        "screen_dimers_avx2() == dimer_runs()",
+        "screen_dimers_avx512() == dimer_runs()",
+        "screen_dimers() == dimer_runs()"
+    };
+#ifdef SIMD_WIDE_KERNELS
+    screen_kernels[SIMD_AVX2] = screen_dimers_avx2;
+    screen_kernels[SIMD_AVX512] = screen_dimers_avx512;
+#endif
+    char refs[TEST_NUM_SCREEN_SEQ][PACKED_MAX_LEN +1];
+    char queries[TEST_NUM_SCREEN_SEQ][PACKED_MAX_LEN +1];
+    Packed_Seq packed_refs[TEST_NUM_SCREEN_SEQ];
+    Packed_Seq packed_queries[TEST_NUM_SCREEN_SEQ];
+    Prefilter_Lanes lanes;
+    unsigned expected, screened;
+    int level, filter, i, j, lane, num_lane, num_level_fail;
+    int num_fail = 0;
+    make_screen_seqs(refs, queries, TEST_NUM_SCREEN_SEQ);
+    for (i = 0; i < TEST_NUM_SCREEN_SEQ; i++)
+    {
+        pack_sequence(refs[i], &packed_refs[i]);
+        pack_sequence(queries[i], &packed_queries[i]);
+    }
+    // level SIMD_SSE2 runs the scalar kernel, NUM_SIMD_LEVEL is screen_dimers()
+    for (level = 0; level <= NUM_SIMD_LEVEL; level++)
+    {
+        if (level == SIMD_SSE2 || screen_kernels[level] == NULL ||
+            (level < NUM_SIMD_LEVEL && level > detect_simd_level()))
+        {
+            continue;
+        }
+        num_level_fail = 0;
+        for (filter = 0; filter < TEST_NUM_PREFILTER; filter++)
+        {
+            for (i = 0; i < TEST_NUM_SCREEN_SEQ; i += PREFILTER_LANES)
+            {
+                num_lane = (TEST_NUM_SCREEN_SEQ - i < PREFILTER_LANES) ?
+                           TEST_NUM_SCREEN_SEQ - i : PREFILTER_LANES;
+                load_prefilter_lanes(packed_refs + i, num_lane, &lanes);
+                for (j = 0; j < TEST_NUM_SCREEN_SEQ; j++)
+                {
+                    expected = 0;
+                    for (lane = 0; lane < num_lane; lane++)
+                    {
+                        expected |= (unsigned) passes_prefilter(
+                                        dimer_runs(&packed_refs[i + lane],
+                                                   &packed_queries[j]),
+                                        test_prefilters[filter]) << lane;
+                    }
+                    screened = screen_kernels[level](&lanes, &packed_queries[j],
+                                                     test_prefilters[filter]);
+                    num_level_fail += screened != expected;
+                }
+            }
+        }
+        num_fail += report(names[level], num_level_fail,
+                           TEST_NUM_PREFILTER * TEST_NUM_SCREEN_SEQ *
+                           ((TEST_NUM_SCREEN_SEQ + PREFILTER_LANES -1) / PREFILTER_LANES));
+    }
+    return num_fail;
+}
+
+/* check_prefiltered_pool:
+ * align_pool_prefiltered() gives the scores of align_pool() to the
+ * pairs passing the prefilter, 0 to the others and the diagonal, and
+ * counts the others as pruned */
+static int check_prefiltered_pool(void)
+{
+    char *primers[TEST_POOL_SIZE];
+    Packed_Seq packed_refs[TEST_POOL_SIZE], packed_queries[TEST_POOL_SIZE];
+    float *expected = allocate(sizeof(float) * TEST_POOL_SIZE * TEST_POOL_SIZE);
+    char *query;
+    long num_pruned, num_expected_pruned;
+    int param, filter, i, j, passes;
+    int num_fail = 0;
+    make_pool(primers, TEST_POOL_SIZE);
+    for (i = 0; i < TEST_POOL_SIZE; i++)
+    {
+        pack_sequence(primers[i], &packed_refs[i]);
+        query = rev_complement(primers[i], KMER_SIZE);
+        pack_sequence(query, &packed_queries[i]);
+        free(query);
+    }
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        align_pool(TEST_POOL_SIZE, test_params[param]);
+        for (i = 0; i < TEST_POOL_SIZE; i++)
+        {
+            memcpy(expected + i * TEST_POOL_SIZE, interaction_matrix[i],
+                   sizeof(float) * TEST_POOL_SIZE);
+        }
+        for (filter = 0; filter < TEST_NUM_PREFILTER; filter++)
+        {
+            num_pruned = align_pool_prefiltered(TEST_POOL_SIZE, test_params[param],
+                                                test_prefilters[filter]);
+            num_expected_pruned = 0;
+            for (i = 0; i < TEST_POOL_SIZE; i++)
+            {
+                for (j = 0; j < TEST_POOL_SIZE; j++)
+                {
+                    passes = passes_prefilter(dimer_runs(&packed_refs[i],
+                                                         &packed_queries[j]),
+                                              test_prefilters[filter]);
+                    num_expected_pruned += (i != j && !passes);
+                    num_fail += interaction_matrix[i][j] !=
+                                ((i != j && passes) ? expected[i * TEST_POOL_SIZE + j] : 0.0);
+                }
+            }
+            num_fail += num_pruned != num_expected_pruned;
+        }
+    }
+    for (i = 0; i < TEST_POOL_SIZE; i++)
+    {
+        free(primers[i]);
+    }
+    free(expected);
+    return report("align_pool_prefiltered() == align_pool() where not pruned",
+                  num_fail, TEST_NUM_PARAM * TEST_NUM_PREFILTER *
+                  (TEST_POOL_SIZE * TEST_POOL_SIZE +1));
+}
+
+
+/* check_matrix_file:
+ * align_pool_to_file(), open_pool_interaction_file() and
+ * interaction_score() against the naive matrix, for one primer and
+ * a pool of TEST_POOL_SIZE in tiles dividing it or not (and the
+ * default tile size) */
+static int check_matrix_file(void)
+{
+    const int pool_sizes[] = {1, TEST_POOL_SIZE};
+    const int tile_sizes[] = {16, 7, TEST_POOL_SIZE, 0};
+    char filename[] = "/tmp/test_swinc_XXXXXX";
+    char *primers[TEST_POOL_SIZE];
+    Interaction_File *file;
+    int size, tile, i, j, num_primer;
+    int num_fail = 0, num_test = 0;
+    close(mkstemp(filename));
+    for (size = 0; size < 2; size++)
+    {
+        num_primer = pool_sizes[size];
+        make_pool(primers, num_primer);
+        float *expected = reference_matrix(primers, num_primer, test_params[1]);
+        for (tile = 0; tile < 4; tile++)
+        {
+            align_pool_to_file(primers, num_primer, test_params[1],
+                               tile_sizes[tile], filename);
+            file = open_pool_interaction_file(filename, primers, num_primer);
+            num_test += 1 + num_primer * num_primer;
+            if (file == NULL)
+            {
+                num_fail += 1 + num_primer * num_primer;
+                continue;
+            }
+            num_fail += file->num_primer != num_primer ||
+                        file->tile_size != ((tile_sizes[tile] > 0) ?
+                                            tile_sizes[tile] : POOL_TILE_SIZE) ||
+                        file->score_param.match_score != test_params[1].match_score ||
+                        file->score_param.gap_extension_penalty !=
+                        test_params[1].gap_extension_penalty;
+            for (i = 0; i < num_primer; i++)
+            {
+                for (j = 0; j < num_primer; j++)
+                {
+                    num_fail += interaction_score(file, i, j) !=
+                                expected[i * num_primer + j];
+                }
+            }
+            close_interaction_file(file);
+        }
+        free(expected);
+        for (i = 0; i < num_primer; i++)
+        {
+            free(primers[i]);
+        }
+    }
+    unlink(filename);
+    return report("align_pool_to_file(), mapped == naive matrix", num_fail, num_test);
+}
+
+/* check_bad_matrix_files:
+ * a good file is opened, and copies of it with a wrong magic, version
+ * or byte order, cut short, or opened for another pool are not */
+static int check_bad_matrix_files(void)
+{
+    // the offsets of the fields in the header of the file format
+    enum {MAGIC_OFFSET = 0, VERSION_OFFSET = 8, BYTE_ORDER_OFFSET = 12};
+    const int num_primer = 40;
+    char filename[] = "/tmp/test_swinc_XXXXXX";
+    char *primers[40];
+    char *swapped;
+    Interaction_File *file;
+    FILE *handle;
+    char *bytes;
+    long len;
+    int i, saved_stderr;
+    int num_fail = 0;
+    uint32_t field;
+    close(mkstemp(filename));
+    make_pool(primers, num_primer);
+    align_pool_to_file(primers, num_primer, test_params[0], 16, filename);
+    handle = fopen(filename, "rb");
+    fseek(handle, 0, SEEK_END);
+    len = ftell(handle);
+    rewind(handle);
+    bytes = allocate(len);
+    num_fail += fread(bytes, 1, len, handle) != (size_t) len;
+    fclose(handle);
+
+    saved_stderr = silence_stderr();
+    file = open_pool_interaction_file(filename, primers, num_primer);
+    num_fail += file == NULL;
+    if (file != NULL)
+    {
+        close_interaction_file(file);
+    }
+    // another pool: a primer changed, the primers in another order, one less
+    primers[3][0] = (primers[3][0] == 'A') ? 'C' : 'A';
+    num_fail += open_pool_interaction_file(filename, primers, num_primer) != NULL;
+    primers[3][0] = (primers[3][0] == 'A') ? 'C' : 'A';
+    swapped = primers[0];
+    primers[0] = primers[1];
+    primers[1] = swapped;
+    num_fail += open_pool_interaction_file(filename, primers, num_primer) != NULL;
+    primers[1] = primers[0];
+    primers[0] = swapped;
+    num_fail += open_pool_interaction_file(filename, primers, num_primer -1) != NULL;
+
+    bytes[MAGIC_OFFSET] ^= 1;
+    write_bytes(filename, bytes, len);
+    num_fail += open_interaction_file(filename) != NULL;
+    bytes[MAGIC_OFFSET] ^= 1;
+    memcpy(&field, bytes + VERSION_OFFSET, sizeof(field));
+    field++;
+    memcpy(bytes + VERSION_OFFSET, &field, sizeof(field));
+    write_bytes(filename, bytes, len);
+    num_fail += open_interaction_file(filename) != NULL;
+    field--;
+    memcpy(bytes + VERSION_OFFSET, &field, sizeof(field));
+    memcpy(&field, bytes + BYTE_ORDER_OFFSET, sizeof(field));
+    field = __builtin_bswap32(field);
+    memcpy(bytes + BYTE_ORDER_OFFSET, &field, sizeof(field));
+    write_bytes(filename, bytes, len);
+    num_fail += open_interaction_file(filename) != NULL;
+    field = __builtin_bswap32(field);
+    memcpy(bytes + BYTE_ORDER_OFFSET, &field, sizeof(field));
+    // the last score missing, the header cut short, nothing
+    write_bytes(filename, bytes, len - sizeof(float));
+    num_fail += open_interaction_file(filename) != NULL;
+    write_bytes(filename, bytes, 32);
+    num_fail += open_interaction_file(filename) != NULL;
+    write_bytes(filename, bytes, 0);
+    num_fail += open_interaction_file(filename) != NULL;
+    // and the copy as written is still good
+    write_bytes(filename, bytes, len);
+    file = open_interaction_file(filename);
+    num_fail += file == NULL;
+    if (file != NULL)
+    {
+        close_interaction_file(file);
+    }
+    restore_stderr(saved_stderr);
+
+    unlink(filename);
+    free(bytes);
+    for (i = 0; i < num_primer; i++)
+    {
+        free(primers[i]);
+    }
+    return report("open_interaction_file() turns down bad files", num_fail, 11);
+}
+
+/* check_sparse:
+ * the entries align_pool_sparse() writes for a pool with copies of
+ * primers (so that scores tie): each entry of the naive matrix off the
+ * diagonal scoring at least the threshold or among the top_k of its
+ * row, ranked by score then query_index, written once with its score,
+ * and nothing else */
+static int check_sparse(void)
+{
+    // threshold only, top_k only (threshold above every score), none,
+    // top_k past the row, both, and ties at the threshold
+    const Sparse_Filter filters[TEST_NUM_SPARSE_FILTER] = {
+        {0, 6.0}, {3, 1e9}, {0, 1e9}, {TEST_SPARSE_POOL_SIZE +5, 1e9},
+        {2, 7.0}, {1, 1.0}
+    };
+    const int num_primer = TEST_SPARSE_POOL_SIZE;
+    char *primers[TEST_SPARSE_POOL_SIZE];
+    char *seen = allocate(num_primer * num_primer);
+    FILE *file;
+    char *text, *line;
+    float score, expected;
+    long num_written, num_line;
+    int param, filter, i, j, other, rank, read_len, kept;
+    int num_fail = 0;
+    make_pool(primers, num_primer);
+    for (i = 1; i < num_primer; i += 7)
+    {
+        strcpy(primers[i], primers[i -1]);
+    }
+    for (param = 0; param < TEST_NUM_PARAM; param++)
+    {
+        float *matrix = reference_matrix(primers, num_primer, test_params[param]);
+        for (filter = 0; filter < TEST_NUM_SPARSE_FILTER; filter++)
+        {
+            file = tmpfile();
+            num_written = align_pool_sparse(primers, num_primer, test_params[param],
+                                            filters[filter], file);
+            text = read_back(file);
+            memset(seen, 0, num_primer * num_primer);
+            num_line = 0;
+            for (line = text; *line != '\0'; line += read_len)
+            {
+                if (sscanf(line, "%d\t%d\t%f\n%n", &i, &j, &score, &read_len) != 3 ||
+                    i < 0 || i >= num_primer || j < 0 || j >= num_primer)
+                {
+                    num_fail++;
+                    break;
+                }
+                num_line++;
+                num_fail += i == j || seen[i * num_primer + j]++ > 0 ||
+                            score != matrix[i * num_primer + j];
+            }
+            num_fail += num_line != num_written;
+            // and every entry that should be there is
+            for (i = 0; i < num_primer; i++)
+            {
+                for (j = 0; j < num_primer; j++)
+                {
+                    if (j == i)
+                    {
+                        continue;
+                    }
+                    expected = matrix[i * num_primer + j];
+                    rank = 0;
+                    for (other = 0; other < num_primer; other++)
+                    {
+                        rank += other != i &&
+                                (matrix[i * num_primer + other] > expected ||
+                                 (matrix[i * num_primer + other] == expected &&
+                                  other < j));
+                    }
+                    kept = expected >= filters[filter].threshold ||
+                           rank < filters[filter].top_k;
+                    num_fail += kept != seen[i * num_primer + j];
+                }
+            }
+            free(text);
+        }
+        free(matrix);
+    }
+    for (i = 0; i < num_primer; i++)
+    {
+        free(primers[i]);
+    }
+    free(seen);
+    return report("align_pool_sparse() == naive matrix, filtered", num_fail,
+                  TEST_NUM_PARAM * TEST_NUM_SPARSE_FILTER * num_primer * num_primer);
+}
+
+/* check_read_primers:
+ * read_primers() of a file with blank and whitespace lines, padded
+ * primers, one longer than MAX_SEQ_LEN and no newline at the end */
+static int check_read_primers(void)
+{
+    char long_primer[4 * MAX_SEQ_LEN +1];
+    char filename[] = "/tmp/test_swinc_XXXXXX";
+    int fd = mkstemp(filename);
+    FILE *file = fdopen(fd, "w");
+    char **primers;
+    int num_primer;
+    int num_fail = 0;
+    random_sequence(long_primer, sizeof(long_primer) -1);
+    fprintf(file, "\nACGTACGT\n\n   \n\tTTGACC  \r\n%s\n \n\nGGCA", long_primer);
+    fclose(file);
+    primers = read_primers(filename, &num_primer);
+    unlink(filename);
+    num_fail += num_primer != 4;
+    if (num_primer == 4)
+    {
+        num_fail += strcmp(primers[0], "ACGTACGT") != 0;
+        num_fail += strcmp(primers[1], "TTGACC") != 0;
+        num_fail += strcmp(primers[2], long_primer) != 0;
+        num_fail += strcmp(primers[3], "GGCA") != 0;
+    }
+    free_primers(primers, num_primer);
+    return report("read_primers(), blank, padded and long lines", num_fail, 5);
+}
+
+
+/* check_alignment_reports:
+ * the CIGAR and gapped strings of alignments made up to start and end
+ * in gaps of either kind, with and without clips, and the lines
+ * format_alignments() writes for pairs whose alignments are known */
+static int check_alignment_reports(void)
+{
+    typedef struct {
+        char *ref;
+        char *query;
+        SW_Alignment alignment;
+        char *cigar;
+        char *gapped_ref;
+        char *gapped_query;
+    } Golden_Alignment;
+    const Golden_Alignment goldens[] = {
+        {"GGACGTAA", "TTACGTCC", {4.0, 2, 6, 2, 6, 4, "MMMM"},
+         "2S4=2S", "ACGT", "ACGT"},
+        // a leading insert, a trailing delete, a clip at the end
+        {"CAACGTTT", "TTAAGGCA", {-3.0, 1, 7, 0, 6, 8, "IIMMXMDD"},
+         "2I2=1X1=2D2S", "--AACGTT", "TTAAGG--"},
+        // a leading delete, a trailing insert, clips at both ends
+        {"TACGTACGTACGT", "GGGACGTACGTACGTCAAAA",
+         {8.0, 0, 13, 3, 16, 14, "DMMMMMMMMMMMMI"},
+         "3S1D12=1I4S", "TACGTACGTACGT-", "-ACGTACGTACGTC"},
+        // nothing aligned
+        {"TTTTT", "GGGGG", {0.0, 0, 0, 0, 0, 0, ""}, "5S", "", ""}
+    };
+    const int num_golden = sizeof(goldens) / sizeof(goldens[0]);
+    char *refs[] = {"ACGTACGT", "AAAAGGGGCCCC", "ACGTACGTGACGTACGT", "TTTTTTTT"};
+    char *queries[] = {"ACGTACGT", "CCGGGGTT", "ACGTACGTACGTACGT", "GGGG"};
+    const char *expected_lines =
+        "0\t8.0000\t0\t8\t0\t8\t8=\tACGTACGT\tACGTACGT\n"
+        "1\t2.0000\t2\t8\t0\t6\t2X4=2S\tAAGGGG\tCCGGGG\n"
+        "2\t14.0000\t0\t17\t0\t16\t8=1D8=\tACGTACGTGACGTACGT\tACGTACGT-ACGTACGT\n"
+        "3\t0.0000\t0\t0\t4\t4\t4S\t\t\n";
+    char cigar[CIGAR_MAX_LEN(32)];
+    char ref_string[32], query_string[32];
+    SW_Alignment alignment;
+    Text_Buffer buffer;
+    SW_Aligner *aligner = create_aligner(test_params[0]);
+    int k, len;
+    int num_fail = 0, num_batch_fail = 0;
+    for (k = 0; k < num_golden; k++)
+    {
+        alignment = goldens[k].alignment;
+        len = format_cigar(&alignment, strlen(goldens[k].query), cigar);
+        format_gapped(&alignment, goldens[k].ref, goldens[k].query,
+                      ref_string, query_string);
+        num_fail += len != (int) strlen(cigar) ||
+                    strcmp(cigar, goldens[k].cigar) != 0 ||
+                    strcmp(ref_string, goldens[k].gapped_ref) != 0 ||
+                    strcmp(query_string, goldens[k].gapped_query) != 0;
+    }
+    // appended after what the buffer holds
+    init_text_buffer(&buffer, 16);
+    strcpy(buffer.text, "head\n");
+    buffer.len = strlen(buffer.text);
+    format_alignments(aligner, refs, queries, 4, &buffer);
+    num_batch_fail += strncmp(buffer.text, "head\n", 5) != 0 ||
+                      strcmp(buffer.text + 5, expected_lines) != 0 ||
+                      buffer.len != strlen(buffer.text);
+    free_text_buffer(&buffer);
+    free_aligner(aligner);
+    report("format_cigar(), format_gapped() == golden", num_fail, num_golden);
+    report("format_alignments() == golden", num_batch_fail, 1);
+    return num_fail + num_batch_fail;
+}
+
+/* check_arena:
+ * an arena of a small block, through rounds of the same allocations
+ * of odd sizes, some larger than the block: every allocation is
+ * ARENA_ALIGNMENT aligned and doesn't overlap the others, those that
+ * don't fit overflow into blocks of their own, and after a reset the
+ * block holds the high water mark so that the next rounds don't go to
+ * the heap and hand out memory of the block only */
+static int check_arena(void)
+{
+    const size_t sizes[] = {1, 7, 16, 33, 1000, 3, 250, 4096, 17, 0, 5};
+    const int num_alloc = sizeof(sizes) / sizeof(sizes[0]);
+    Arena *arena = create_arena(100);
+    unsigned char *memory[sizeof(sizes) / sizeof(sizes[0])];
+    long num_heap_alloc;
+    size_t k, total = 0;
+    int round, i;
+    int num_fail = 0, num_test = 0;
+    for (i = 0; i < num_alloc; i++)
+    {
+        total += (sizes[i] + ARENA_ALIGNMENT -1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    }
+    for (round = 0; round < 3; round++)
+    {
+        num_heap_alloc = arena->num_heap_alloc;
+        for (i = 0; i < num_alloc; i++)
+        {
+            memory[i] = arena_alloc(arena, sizes[i]);
+            memset(memory[i], i +1, sizes[i]);
+            num_fail += (size_t) memory[i] % ARENA_ALIGNMENT != 0;
+            if (round > 0)
+            {// from the block alone
+                num_fail += memory[i] < (unsigned char *) arena->memory ||
+                            memory[i] + sizes[i] > (unsigned char *) arena->memory +
+                                                   arena->size;
+            }
+            num_test += 1 + (round > 0);
+        }
+        for (i = 0; i < num_alloc; i++)
+        {// nothing written over by a later allocation
+            for (k = 0; k < sizes[i]; k++)
+            {
+                num_fail += memory[i][k] != i +1;
+            }
+            num_test++;
+        }
+        num_fail += arena->high_water != total;
+        // the first round overflows (1000 bytes in a block of 112), the others don't
+        num_fail += (round == 0) ? (arena->overflow == NULL ||
+                                    arena->num_heap_alloc == num_heap_alloc) :
+                                   (arena->overflow != NULL ||
+                                    arena->num_heap_alloc != num_heap_alloc);
+        num_test += 2;
+        arena_reset(arena);
+        num_fail += arena->used != 0 || arena->size < total;
+        num_test++;
+    }
+    char *copy = arena_strdup(arena, "ACGT");
+    num_fail += strcmp(copy, "ACGT") != 0 || (size_t) copy % ARENA_ALIGNMENT != 0;
+    num_test++;
+    free_arena(arena);
+    return report("arena: aligned, overflows, reused after reset", num_fail, num_test);
+}
+
+/* check_format_float:
+ * format_float() against snprintf("%.*f") at every precision, on
+ * the edge values (signed zeros, rounding across a digit, halves,
+ * magnitudes past the integer path, NaN and infinities) and on
+ * random floats of every magnitude */
+static int check_format_float(void)
+{
+    const float edge_values[] = {
+        0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 0.125, -0.125, 2.5, 0.005, -0.004,
+        9.99995, -9.99995, 9.5, 99.999999, 0.000001, -0.0000004,
+        123456.789, 1e17, -1e17, 1e18, 3e38, -3e38, 1.17549435e-38,
+        NAN, -NAN, INFINITY, -INFINITY
+    };
+    const int num_edge = sizeof(edge_values) / sizeof(edge_values[0]);
+    char text[64], expected[64];
+    float value;
+    int k, precision, len;
+    int num_fail = 0;
+    for (k = 0; k < num_edge + TEST_NUM_FLOAT; k++)
+    {
+        if (k < num_edge)
+        {
+            value = edge_values[k];
+        }else
+        {// a sign, a magnitude from 10^-8 to 10^20 and a fraction
+            value = ((rand() % 2) ? -1.0 : 1.0) * powf(10.0, rand() % 29 - 8) *
+                    ((float) rand() / RAND_MAX);
+        }
+        for (precision = 0; precision <= 6; precision++)
+        {
+            len = format_float(value, precision, text);
+            snprintf(expected, sizeof(expected), "%.*f", precision, value);
+            num_fail += len != (int) strlen(text) || strcmp(text, expected) != 0;
+        }
+    }
+    return report("format_float() == printf(\"%.*f\")", num_fail,
+                  7 * (num_edge + TEST_NUM_FLOAT));
+}
+
+/* check_reports:
+ * write_interaction_report() in every format, by 1 and 3 threads,
+ * with and without names (one longer than MAX_SEQ_LEN), and
+ * print_interaction_matrix(), against the text of old_report() on
+ * TEST_REPORT_ROWS rows of interaction_matrix */
+static int check_reports(void)
+{
+    const Report_Format formats[] = {REPORT_TSV, REPORT_CSV, REPORT_SUMMARY};
+    const int num_threads[] = {1, 3};
+    char *names[TEST_REPORT_ROWS];
+    char long_name[3 * MAX_SEQ_LEN];
+    Text_Buffer expected;
+    Report_Options options;
+    FILE *file;
+    char *text;
+    int format, thread, named, i, j, saved_stdout;
+    int num_fail = 0, num_print_fail = 0;
+    for (i = 0; i < TEST_REPORT_ROWS; i++)
+    {
+        random_sequence(pool[i], 10 + rand() % (MAX_SEQ_LEN - 10));
+        names[i] = pool[i];
+        for (j = 0; j < TEST_REPORT_COLS; j++)
+        {// whole, half and random scores, a few below 0
+            interaction_matrix[i][j] = (i == j) ? 0.0 :
+                                       (rand() % 3 == 0) ? (rand() % 41 - 8) * 0.5 :
+                                       (float) rand() / RAND_MAX * 30.0 - 5.0;
+        }
+    }
+    random_sequence(long_name, sizeof(long_name) -1);
+    names[1] = long_name;
+    init_text_buffer(&expected, 0);
+    for (format = 0; format < 3; format++)
+    {
+        for (thread = 0; thread < 2; thread++)
+        {
+            for (named = 0; named < 2; named++)
+            {
+                options = (Report_Options) {formats[format],
+                                            REPORT_DEFAULT_PRECISION + thread,
+                                            num_threads[thread]};
+                file = tmpfile();
+                write_interaction_report(file, &interaction_matrix[0][0],
+                                         MAX_POOL_SIZE, (named) ? names : NULL,
+                                         TEST_REPORT_ROWS, TEST_REPORT_COLS,
+                                         options);
+                text = read_back(file);
+                expected.len = 0;
+                old_report(&expected, (named) ? names : NULL,
+                           TEST_REPORT_ROWS, TEST_REPORT_COLS, options);
+                num_fail += strcmp(text, expected.text) != 0;
+                free(text);
+            }
+        }
+    }
+
+    // print_interaction_matrix() writes to stdout
+    file = tmpfile();
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(fileno(file), STDOUT_FILENO);
+    print_interaction_matrix(TEST_REPORT_ROWS, TEST_REPORT_COLS);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    text = read_back(file);
+    expected.len = 0;
+    for (i = 0; i < TEST_REPORT_ROWS; i++)
+    {
+        float max_interaction = 0.0;
+        append_text(&expected, "%60s ", pool[i]);
+        for (j = 0; j < TEST_REPORT_COLS; j++)
+        {
+            append_text(&expected, "%.2f ", interaction_matrix[i][j]);
+            max_interaction = (interaction_matrix[i][j] > max_interaction) ?
+                              interaction_matrix[i][j] : max_interaction;
+        }
+        append_text(&expected, "\t max= %.2f \tmean= %.2f\n", max_interaction,
+                    mean(interaction_matrix[i], TEST_REPORT_COLS));
+    }
+    num_print_fail += strcmp(text, expected.text) != 0;
+    free(text);
+    free_text_buffer(&expected);
+    report("write_interaction_report() == old printf() text", num_fail, 12);
+    report("print_interaction_matrix() == old printf() text", num_print_fail, 1);
+    return num_fail + num_print_fail;
+}
+
+
+/* reference_hit:
+ * the best score of query against ref by the naive DP, and where it
+ * ends: the last (row, then col) of the entries scoring it, (0, 0)
+ * if nothing scores above 0. I and D are 0 on the edge, as M is. */
+static SW_Hit reference_hit(char *ref, char *query, Score_Param score_param)
+{
+    int nrow = strlen(query) +1;
+    int ncol = strlen(ref) +1;
+    float *match = calloc((size_t) 3 * nrow * ncol, sizeof(float));
+    float *insert = match + (size_t) nrow * ncol;
+    float *delete = insert + (size_t) nrow * ncol;
+    SW_Hit hit = {0.0, 0, 0, 'T'};
+    float diagonal, best;
+    int row, col, here;
+    if (match == NULL)
+    {
+        error_handle(ERROR_MEM_ALLOC);
+        exit(ERROR_MEM_ALLOC);
+    }
+    for (row = 1; row < nrow; row++)
+    {
+        for (col = 1; col < ncol; col++)
+        {
+            here = row * ncol + col;
+            diagonal = match[here - ncol -1];
+            diagonal = (insert[here - ncol -1] > diagonal) ? insert[here - ncol -1] : diagonal;
+            diagonal = (delete[here - ncol -1] > diagonal) ? delete[here - ncol -1] : diagonal;
+            match[here] = diagonal + ((ref[col -1] == query[row -1]) ?
+                                      score_param.match_score :
+                                      score_param.mismatch_penalty);
+            insert[here] = (match[here - ncol] + score_param.gap_open_penalty >
+                            insert[here - ncol] + score_param.gap_extension_penalty) ?
+                           match[here - ncol] + score_param.gap_open_penalty :
+                           insert[here - ncol] + score_param.gap_extension_penalty;
+            delete[here] = (match[here -1] + score_param.gap_open_penalty >
+                            delete[here -1] + score_param.gap_extension_penalty) ?
+                           match[here -1] + score_param.gap_open_penalty :
+                           delete[here -1] + score_param.gap_extension_penalty;
+            best = match[here];
+            best = (insert[here] > best) ? insert[here] : best;
+            best = (delete[here] > best) ? delete[here] : best;
+            if (best > 0.0 && best >= hit.score)
+            {
+                hit.score = best;
+                hit.row = row;
+                hit.col = col;
+            }
+        }
+    }
+    free(match);
+    return hit;
+}
+
+/* reference_matrix:
+ * the interaction matrix of primers by the naive DP, row major,
+ * primers[i] against rc(primers[j]) and 0 on the diagonal */
+static float *reference_matrix(char **primers, int num_primer,
+                               Score_Param score_param)
+{
+    float *matrix = allocate(sizeof(float) * num_primer * num_primer);
+    char *query;
+    int i, j;
+    for (j = 0; j < num_primer; j++)
+    {
+        query = rev_complement(primers[j], KMER_SIZE);
+        for (i = 0; i < num_primer; i++)
+        {
+            matrix[i * num_primer + j] = (i == j) ? 0.0 :
+                                         reference_hit(primers[i], query,
+                                                       score_param).score;
+        }
+        free(query);
+    }
+    return matrix;
+}
+
+/* same_alignment:
+ * alignment scores expected, and its path walks from its start to
+ * its end in ref and query scoring it. A run of gaps costs the gap
+ * open penalty then the extension penalty per gap, but one from the
+ * edge of the matrix, where I and D are 0 as M is, the better of the
+ * two from the start. */
+static int same_alignment(SW_Alignment *alignment, char *ref, char *query,
+                          Score_Param score_param, float expected)
+{
+    int ref_pos = alignment->ref_start, query_pos = alignment->query_start;
+    int ref_len = strlen(ref), query_len = strlen(query);
+    float path_score = 0.0;
+    float edge_gap = (score_param.gap_extension_penalty > score_param.gap_open_penalty) ?
+                     score_param.gap_extension_penalty : score_param.gap_open_penalty;
+    char previous = 'M';
+    int k;
+    if (alignment->score != expected)
+    {
+        return 0;
+    }
+    if (ref_pos < 0 || query_pos < 0 || alignment->ref_end > ref_len ||
+        alignment->query_end > query_len)
+    {
+        return 0;
+    }
+    for (k = 0; k < alignment->path_len; k++)
+    {
+        switch (alignment->path[k])
+        {
+            case 'M':
+            case 'X':
+                if (ref_pos >= ref_len || query_pos >= query_len ||
+                    (ref[ref_pos] == query[query_pos]) != (alignment->path[k] == 'M'))
+                {
+                    return 0;
+                }
+                path_score += (alignment->path[k] == 'M') ?
+                              score_param.match_score : score_param.mismatch_penalty;
+                ref_pos++;
+                query_pos++;
+                break;
+            case 'I':
+                path_score += (k == 0) ? edge_gap :
+                              (previous == 'I') ? score_param.gap_extension_penalty :
+                                                  score_param.gap_open_penalty;
+                query_pos++;
+                break;
+            case 'D':
+                path_score += (k == 0) ? edge_gap :
+                              (previous == 'D') ? score_param.gap_extension_penalty :
+                                                  score_param.gap_open_penalty;
+                ref_pos++;
+                break;
+            default:
+                return 0;
+        }
+        previous = alignment->path[k];
+    }
+    return ref_pos == alignment->ref_end && query_pos == alignment->query_end &&
+           path_score == expected;
+}
+
+
+/* make_pairs: TEST_NUM_PAIR pairs of 1 to TEST_MAX_LEN bases, then
+ * TEST_NUM_LONG_PAIR of TEST_LONG_LEN, one in 4 with the query a
+ * mutated copy of a piece of the ref */
+static void make_pairs(Test_Pairs *pairs)
+{
+    int k, i, len;
+    pairs->num_pair = TEST_NUM_PAIR + TEST_NUM_LONG_PAIR;
+    pairs->refs = allocate(sizeof(char *) * pairs->num_pair);
+    pairs->queries = allocate(sizeof(char *) * pairs->num_pair);
+    for (k = 0; k < pairs->num_pair; k++)
+    {
+        pairs->refs[k] = allocate(TEST_LONG_LEN +1);
+        pairs->queries[k] = allocate(TEST_LONG_LEN +1);
+        len = (k < TEST_NUM_PAIR) ? 1 + rand() % TEST_MAX_LEN : TEST_LONG_LEN;
+        random_sequence(pairs->refs[k], len);
+        len = (k < TEST_NUM_PAIR) ? 1 + rand() % TEST_MAX_LEN : TEST_LONG_LEN;
+        random_sequence(pairs->queries[k], len);
+        if (rand() % 4 == 0)
+        {
+            len = strlen(pairs->refs[k]);
+            len = (len < (int) strlen(pairs->queries[k])) ? len : (int) strlen(pairs->queries[k]);
+            memcpy(pairs->queries[k], pairs->refs[k], len);
+            for (i = 0; i < len; i += 1 + rand() % 8)
+            {
+                pairs->queries[k][i] = "ACGT"[rand() % 4];
+            }
+        }
+    }
+}
+
+static void free_pairs(Test_Pairs *pairs)
+{
+    int k;
+    for (k = 0; k < pairs->num_pair; k++)
+    {
+        free(pairs->refs[k]);
+        free(pairs->queries[k]);
+    }
+    free(pairs->refs);
+    free(pairs->queries);
+}
+
+/* make_pool:
+ * num_primer primers of 10 to MAX_SEQ_LEN -1 bases into primers and
+ * pool[], one in 5 ending in the reverse complement of the 3' end of
+ * the one before so that some pairs form dimers */
+static void make_pool(char **primers, int num_primer)
+{
+    char *tail;
+    int i, len, tail_len;
+    for (i = 0; i < num_primer; i++)
+    {
+        len = 10 + rand() % (MAX_SEQ_LEN - 10);
+        primers[i] = allocate(MAX_SEQ_LEN);
+        random_sequence(primers[i], len);
+        if (i > 0 && rand() % 5 == 0)
+        {
+            tail = rev_complement(primers[i -1], 8);
+            tail_len = strlen(tail);
+            memcpy(primers[i] + len - tail_len, tail, tail_len);
+            free(tail);
+        }
+        strcpy(pool[i], primers[i]);
+    }
+}
+
+/* make_screen_seqs:
+ * num_seq refs and queries of 1 to PACKED_MAX_LEN bases, one in 4 of
+ * the edge lengths 1, 2, PACKED_MAX_LEN -1 or PACKED_MAX_LEN, with an
+ * N now and then; query i has a run of ref i planted in it */
+static void make_screen_seqs(char (*refs)[PACKED_MAX_LEN +1],
+                             char (*queries)[PACKED_MAX_LEN +1], int num_seq)
+{
+    const int edge_lens[] = {1, 2, PACKED_MAX_LEN -1, PACKED_MAX_LEN};
+    int i, len;
+    for (i = 0; i < 2 * num_seq; i++)
+    {
+        char *seq = (i < num_seq) ? refs[i] : queries[i - num_seq];
+        len = (rand() % 4 == 0) ? edge_lens[rand() % 4] : 1 + rand() % PACKED_MAX_LEN;
+        random_sequence(seq, len);
+        if (rand() % 8 == 0)
+        {
+            seq[rand() % len] = 'N';
+        }
+    }
+    for (i = 0; i < num_seq; i++)
+    {
+        plant_run(refs[i], queries[i]);
+    }
+}
+
+/* plant_run:
+ * copy a run of ref into query: from query base 0, to the ref's last
+ * base, both, or anywhere */
+static void plant_run(char *ref, char *query)
+{
+    int ref_len = strlen(ref);
+    int query_len = strlen(query);
+    int max_len = (ref_len < query_len) ? ref_len : query_len;
+    int run_len = 1 + rand() % ((max_len < 10) ? max_len : 10);
+    int ref_start = rand() % (ref_len - run_len +1);
+    int query_start = rand() % (query_len - run_len +1);
+    switch (rand() % 4)
+    {
+        case 0: // anchored at query base 0
+            query_start = 0;
+            break;
+        case 1: // anchored at the ref's last base
+            ref_start = ref_len - run_len;
+            break;
+        case 2: // both
+            query_start = 0;
+            ref_start = ref_len - run_len;
+            break;
+        default:
+            break;
+    }
+    memcpy(query + query_start, ref + ref_start, run_len);
+}
+
+/* old_report:
+ * the report of options.format as the old print_interaction_matrix()
+ * made its values: printf("%.*f"), the max from 0.0 over all columns
+ * and mean() over ncol */
+static void old_report(Text_Buffer *text, char **names, int nrow, int ncol,
+                       Report_Options options)
+{
+    char separator = (options.format == REPORT_CSV) ? ',' : '\t';
+    float max_interaction;
+    int row, col;
+    if (options.format == REPORT_SUMMARY)
+    {
+        append_text(text, "primer\tmax\tmean\n");
+    }else
+    {
+        append_text(text, "primer");
+        for (col = 0; col < ncol; col++)
+        {
+            (names) ? append_text(text, "%c%s", separator, names[col]) :
+                      append_text(text, "%c%d", separator, col);
+        }
+        append_text(text, "\n");
+    }
+    for (row = 0; row < nrow; row++)
+    {
+        (names) ? append_text(text, "%s", names[row]) :
+                  append_text(text, "%d", row);
+        max_interaction = 0.0;
+        for (col = 0; col < ncol; col++)
+        {
+            if (options.format != REPORT_SUMMARY)
+            {
+                append_text(text, "%c%.*f", separator, options.precision,
+                            interaction_matrix[row][col]);
+            }
+            max_interaction = (interaction_matrix[row][col] > max_interaction) ?
+                              interaction_matrix[row][col] : max_interaction;
+        }
+        if (options.format == REPORT_SUMMARY)
+        {
+            append_text(text, "\t%.*f\t%.*f", options.precision, max_interaction,
+                        options.precision, mean(interaction_matrix[row], ncol));
+        }
+        append_text(text, "\n");
+    }
+}
+
+/* append_text: printf() at the end of text */
+static void append_text(Text_Buffer *text, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char *cursor = reserve_text(text, len);
+    va_start(args, format);
+    vsnprintf(cursor, len +1, format, args);
+    va_end(args);
+    text->len += len;
+}
+
+/* read_back: the whole of file, closed, as a string */
+static char *read_back(FILE *file)
+{
+    fflush(file);
+    long len = ftell(file);
+    char *text = allocate(len +1);
+    rewind(file);
+    text[fread(text, 1, len, file)] = '\0';
+    fclose(file);
+    return text;
+}
+
+/* write_bytes: filename holding the len bytes of bytes only */
+static void write_bytes(const char *filename, const char *bytes, size_t len)
+{
+    FILE *file = fopen(filename, "wb");
+    fwrite(bytes, 1, len, file);
+    fclose(file);
+}
+
+/* silence_stderr: send stderr to /dev/null, return the saved one */
+static int silence_stderr(void)
+{
+    int saved_stderr = dup(STDERR_FILENO);
+    int null_file = open("/dev/null", O_WRONLY);
+    fflush(stderr);
+    dup2(null_file, STDERR_FILENO);
+    close(null_file);
+    return saved_stderr;
+}
+
+static void restore_stderr(int saved_stderr)
+{
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+}
+
+static void random_sequence(char *seq, int len)
+{
+    register int i;
+    for (i = 0; i < len; i++)
+    {
+        seq[i] = "ACGT"[rand() % 4];
+    }
+    seq[len] = '\0';
+}
+
+/* report: print the outcome of a check, return its number of failures */
+static int report(const char *name, int num_fail, int num_test)
+{
+    printf("%-64s %s (%d/%d failed)\n", name, (num_fail == 0) ? "ok" : "FAIL",
+           num_fail, num_test);
+    return num_fail;
+}
@@ -0,0 +1,461 @@
+/************************** SWNN EQUIVALENCE TESTS **************************
+ * Every duplex engine against the one it replaced, on random duplexes
+ * (of A, C, G, T and some I) of 1 to TEST_MAX_LEN bases:
+ *   - the fused kernel of complete_duplex_matrix() against compute_entry(),
+ *   - complete_duplex_matrix_soa() and complete_duplex_matrix_arena()
+ *     against complete_duplex_matrix(), record by record, also on
+ *     duplexes of MAX_DUPLEX_MATRIX_LEN bases (loop lengths in a byte),
+ *   - the lowest record kept by the fills against find_best_entry_coord(),
+ *   - score_duplex() and score_duplex_arena() against find_best_decision(),
+ *   - prune_duplex_arena() and screen_duplex_pool() against score_duplex(),
+ * and the tables of init_thermo_context() against the per-call delG
+ * formula they replaced, record by record, at two reaction conditions.
+ * Records are compared exactly: the engines do the same float operations
+ * in the same order. Exits with EXIT_FAILURE if any check fails.
+ ****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swnn.h"
+
+#define TEST_SEED 20240601
+#define TEST_NUM_DUPLEX 2000
+#define TEST_MAX_LEN 60
+#define TEST_NUM_LONG_DUPLEX 8
+#define TEST_POOL_SIZE 24
+#define TEST_POOL_LEN 24
+
+static const float test_thresholds[] = {-9000.0, -6000.0, -3000.0};
+#define NUM_TEST_THRESHOLD (sizeof(test_thresholds) / sizeof(test_thresholds[0]))
+
+// reaction temperature (Celsius) and salt concentration (mMol)
+static const float test_conditions[][2] = {{60.0, 50.0}, {37.0, 150.0}};
+#define NUM_TEST_CONDITION (sizeof(test_conditions) / sizeof(test_conditions[0]))
+
+static int check_fused_kernel(void);
+static int check_soa_matrix(void);
+static int check_lowest_record(void);
+static int check_score_duplex(void);
+static int check_pruned_screen(void);
+static int check_thermo_context(void);
+static int check_nn_table(const float *table, const Therm_Param *records,
+                          const char *alphabet, float temperature);
+static SW_Entry **reference_matrix(char *ref, char *query);
+static Duplex_Hit lowest_end_record(SW_Entry **sw_matrix, int nrow, int ncol);
+static int same_record(Decision_Record first, Decision_Record second);
+static int same_hit(Duplex_Hit first, Duplex_Hit second);
+static int same_coord(Coord first, Coord second);
+static void random_duplex(char *ref, char *query, int max_len);
+static void random_sequence(char *seq, int len, const char *alphabet);
+static int report(const char *name, int num_fail, int num_test);
+
+
+int main(void)
+{
+    int num_fail = 0;
+    INSTRUMENT_INIT();
+    duplex_kernels();
+    num_fail += check_fused_kernel();
+    num_fail += check_soa_matrix();
+    num_fail += check_lowest_record();
+    num_fail += check_score_duplex();
+    num_fail += check_pruned_screen();
+    num_fail += check_thermo_context();
+    return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* check_fused_kernel: complete_duplex_matrix() against a fill by
+ * compute_entry() */
+static int check_fused_kernel(void)
+{
+    char ref[TEST_MAX_LEN +1], query[TEST_MAX_LEN +1];
+    int nrow, ncol, row, col, test;
+    int num_fail = 0;
+    srand(TEST_SEED);
+    for (test = 0; test < TEST_NUM_DUPLEX; test++)
+    {
+        random_duplex(ref, query, TEST_MAX_LEN);
+        nrow = strlen(query);
+        ncol = strlen(ref);
+        SW_Entry **expected = reference_matrix(ref, query);
+        SW_Entry **sw_matrix = complete_duplex_matrix(ref, query, NULL);
+        int same = 1;
+        for (row = 0; row < nrow && same; row++)
+        {
+            for (col = 0; col < ncol && same; col++)
+            {
+                same = same_record(sw_matrix[row][col].bind, expected[row][col].bind) &&
+                       same_record(sw_matrix[row][col].top_bulge, expected[row][col].top_bulge) &&
+                       same_record(sw_matrix[row][col].bottom_bulge, expected[row][col].bottom_bulge) &&
+                       same_record(sw_matrix[row][col].stop, expected[row][col].stop);
+            }
+        }
+        num_fail += !same;
+        free(sw_matrix);
+        free(expected);
+    }
+    return report("fused kernel == compute_entry()", num_fail, TEST_NUM_DUPLEX);
+}
+
+/* check_soa_matrix: the structure of arrays fills, malloc'd and from
+ * an arena, against complete_duplex_matrix() */
+static int check_soa_matrix(void)
+{
+    char ref[MAX_DUPLEX_MATRIX_LEN +1], query[MAX_DUPLEX_MATRIX_LEN +1];
+    int nrow, ncol, row, col, test, decision;
+    int num_fail = 0;
+    Arena *arena = create_arena(0);
+    srand(TEST_SEED +1);
+    for (test = 0; test < TEST_NUM_DUPLEX + TEST_NUM_LONG_DUPLEX; test++)
+    {
+        if (test < TEST_NUM_DUPLEX)
+        {
+            random_duplex(ref, query, TEST_MAX_LEN);
+        } else
+        {
+            random_sequence(ref, MAX_DUPLEX_MATRIX_LEN, "ACGT");
+            random_sequence(query, MAX_DUPLEX_MATRIX_LEN, "ACGT");
+        }
+        nrow = strlen(query);
+        ncol = strlen(ref);
+        SW_Entry **sw_matrix = complete_duplex_matrix(ref, query, NULL);
+        Duplex_Matrix *matrix = complete_duplex_matrix_soa(ref, query);
+        Duplex_Matrix *arena_matrix = complete_duplex_matrix_arena(ref, query, arena);
+        int same = 1;
+        for (row = 0; row < nrow && same; row++)
+        {
+            for (col = 0; col < ncol && same; col++)
+            {
+                SW_Entry entry = sw_matrix[row][col];
+                Decision_Record records[NUM_DECISION] = {entry.bind, entry.top_bulge,
+                                                         entry.bottom_bulge, entry.stop};
+                for (decision = 0; decision < NUM_DECISION; decision++)
+                {
+                    same = same &&
+                           same_record(get_duplex_record(matrix, row, col, decision),
+                                       records[decision]) &&
+                           same_record(get_duplex_record(arena_matrix, row, col, decision),
+                                       records[decision]);
+                }
+            }
+        }
+        num_fail += !same;
+        free(sw_matrix);
+        free_duplex_matrix(matrix);
+        arena_reset(arena);
+    }
+    free_arena(arena);
+    return report("complete_duplex_matrix_soa/arena() == complete_duplex_matrix()",
+                  num_fail, TEST_NUM_DUPLEX + TEST_NUM_LONG_DUPLEX);
+}
+
+/* check_lowest_record: the lowest record kept during the fills against
+ * the rescan of the whole matrix */
+static int check_lowest_record(void)
+{
+    char ref[TEST_MAX_LEN +1], query[TEST_MAX_LEN +1];
+    int nrow, ncol, test;
+    int num_fail = 0;
+    Duplex_Hit lowest;
+    Arena *arena = create_arena(0);
+    srand(TEST_SEED +2);
+    for (test = 0; test < TEST_NUM_DUPLEX; test++)
+    {
+        random_duplex(ref, query, TEST_MAX_LEN);
+        nrow = strlen(query);
+        ncol = strlen(ref);
+        SW_Entry **sw_matrix = complete_duplex_matrix(ref, query, &lowest);
+        Coord expected = find_best_entry_coord(sw_matrix, nrow, ncol);
+        Duplex_Matrix *matrix = complete_duplex_matrix_arena(ref, query, arena);
+        num_fail += !(same_coord(lowest.coord, expected) &&
+                      same_coord(matrix->lowest.coord, expected) &&
+                      lowest.delG == matrix->lowest.delG);
+        free(sw_matrix);
+        arena_reset(arena);
+    }
+    free_arena(arena);
+    return report("lowest record of the fill == find_best_entry_coord()",
+                  num_fail, TEST_NUM_DUPLEX);
+}
+
+/* check_score_duplex: the score-only rolling rows against
+ * find_best_decision() on the whole matrix */
+static int check_score_duplex(void)
+{
+    char ref[TEST_MAX_LEN +1], query[TEST_MAX_LEN +1];
+    int nrow, ncol, test;
+    int num_fail = 0;
+    Arena *arena = create_arena(0);
+    srand(TEST_SEED +3);
+    for (test = 0; test < TEST_NUM_DUPLEX; test++)
+    {
+        random_duplex(ref, query, TEST_MAX_LEN);
+        nrow = strlen(query);
+        ncol = strlen(ref);
+        SW_Entry **sw_matrix = complete_duplex_matrix(ref, query, NULL);
+        Duplex_Hit expected = lowest_end_record(sw_matrix, nrow, ncol);
+        Duplex_Hit hit = score_duplex(ref, query);
+        Duplex_Hit arena_hit = score_duplex_arena(ref, query, arena);
+        num_fail += !(same_hit(hit, expected) && same_hit(arena_hit, expected));
+        free(sw_matrix);
+        arena_reset(arena);
+    }
+    free_arena(arena);
+    return report("score_duplex() == find_best_decision()", num_fail, TEST_NUM_DUPLEX);
+}
+
+/* check_pruned_screen: a pruned duplex can't go below the threshold,
+ * one that isn't pruned has the hit of score_duplex(); the same for
+ * the pairs of a pool screen. A duplex isn't pruned at a threshold
+ * just above its lowest delG either, where the bound is the tightest. */
+static int check_pruned_screen(void)
+{
+    char ref[TEST_MAX_LEN +1], query[TEST_MAX_LEN +1];
+    char *primers[TEST_POOL_SIZE];
+    float delGs[TEST_POOL_SIZE * TEST_POOL_SIZE];
+    int test, i, j, num_pruned, num_nan;
+    int num_fail = 0;
+    int num_test = 0;
+    size_t threshold;
+    Duplex_Bound bound;
+    Duplex_Hit hit, pruned_hit;
+    Arena *arena = create_arena(0);
+    srand(TEST_SEED +4);
+    for (i = 0; i < TEST_POOL_SIZE; i++)
+    {
+        primers[i] = malloc(TEST_POOL_LEN +1);
+        random_sequence(primers[i], TEST_POOL_LEN, "ACGT");
+    }
+    for (threshold = 0; threshold < NUM_TEST_THRESHOLD; threshold++)
+    {
+        init_duplex_bound(&bound, test_thresholds[threshold], TEST_MAX_LEN);
+        for (test = 0; test < TEST_NUM_DUPLEX; test++, num_test++)
+        {
+            random_duplex(ref, query, TEST_MAX_LEN);
+            hit = score_duplex(ref, query);
+            if (prune_duplex_arena(ref, query, &bound, arena, &pruned_hit))
+            {
+                num_fail += (hit.delG < bound.threshold);
+            } else
+            {
+                num_fail += !same_hit(hit, pruned_hit);
+            }
+            arena_reset(arena);
+        }
+        for (test = 0; test < TEST_NUM_DUPLEX; test++, num_test++)
+        {
+            random_duplex(ref, query, TEST_MAX_LEN);
+            hit = score_duplex(ref, query);
+            bound.threshold = hit.delG + 1.0;
+            num_fail += prune_duplex_arena(ref, query, &bound, arena, &pruned_hit) ||
+                        !same_hit(hit, pruned_hit);
+            arena_reset(arena);
+        }
+        bound.threshold = test_thresholds[threshold];
+        num_pruned = screen_duplex_pool(primers, TEST_POOL_SIZE, &bound, arena, delGs);
+        num_nan = 0;
+        for (i = 0; i < TEST_POOL_SIZE; i++)
+        {
+            for (j = 0; j < TEST_POOL_SIZE; j++)
+            {
+                if (i == j)
+                {
+                    continue;
+                }
+                hit = score_duplex(primers[i], primers[j]);
+                if (isnan(delGs[i * TEST_POOL_SIZE + j]))
+                {
+                    num_nan++;
+                    num_fail += (hit.delG < bound.threshold);
+                } else
+                {
+                    num_fail += (delGs[i * TEST_POOL_SIZE + j] != hit.delG);
+                }
+                num_test++;
+            }
+        }
+        num_fail += (num_nan != num_pruned);
+    }
+    for (i = 0; i < TEST_POOL_SIZE; i++)
+    {
+        free(primers[i]);
+    }
+    free_arena(arena);
+    return report("prune_duplex_arena(), screen_duplex_pool() == score_duplex()",
+                  num_fail, num_test);
+}
+
+/* check_thermo_context:
+ * both nn tables and the initiation delGs of init_thermo_context()
+ * against the formula get_delG_internal(), get_delG_terminal() and
+ * init_delG() applied per call, at each of test_conditions */
+static int check_thermo_context(void)
+{
+    extern const Therm_Param GLOBAL_nn_data_internal[];
+    extern const Therm_Param GLOBAL_nn_data_terminal[];
+    extern const Therm_Param GLOBAL_init_GC;
+    extern const Therm_Param GLOBAL_init_AT;
+    Thermo_Context *context = malloc(sizeof(Thermo_Context));
+    float temperature;
+    int condition;
+    int num_fail = 0;
+    for (condition = 0; condition < NUM_TEST_CONDITION; condition++)
+    {
+        temperature = test_conditions[condition][0];
+        init_thermo_context(context, temperature, test_conditions[condition][1]);
+        num_fail += check_nn_table(context->delG_internal, GLOBAL_nn_data_internal,
+                                   "ACGT", temperature);
+        num_fail += check_nn_table(context->delG_terminal, GLOBAL_nn_data_terminal,
+                                   ".ACGT", temperature);
+        num_fail += context->delG_init_AT != (float) (GLOBAL_init_AT.delH * 1000.0 -
+                        GLOBAL_init_AT.delS * (temperature + ABSOLUTE_ZERO_OFFSET));
+        num_fail += context->delG_init_GC != (float) (GLOBAL_init_GC.delH * 1000.0 -
+                        GLOBAL_init_GC.delS * (temperature + ABSOLUTE_ZERO_OFFSET));
+    }
+    free(context);
+    return report("init_thermo_context() == per-call delG, 0.0 elsewhere", num_fail,
+                  NUM_TEST_CONDITION * 2 * (NUM_NN_CODE +1));
+}
+
+/* check_nn_table:
+ * the failures of table against records, indexed as the old lookup
+ * did: the 4 bases as digits (their place in alphabet) of a number
+ * in base strlen(alphabet), top5 first. Every code index that isn't
+ * one of those 4 bases of alphabet should be 0.0. */
+static int check_nn_table(const float *table, const Therm_Param *records,
+                          const char *alphabet, float temperature)
+{
+    const char *codes = "ACGTI."; // in the order of CODE_A to CODE_DOT
+    int num_base = strlen(alphabet);
+    int num_record = num_base * num_base * num_base * num_base;
+    char *is_record = calloc(NUM_NN_CODE, 1);
+    int digits[4], code[4];
+    int record, code_index, side, index;
+    float delG;
+    int num_fail = 0;
+    for (record = 0; record < num_record; record++)
+    {
+        for (side = 3, index = record; side >= 0; side--, index /= num_base)
+        {
+            digits[side] = index % num_base;
+            code[side] = strchr(codes, alphabet[digits[side]]) - codes;
+        }
+        index = digits[0] * pow(num_base, 3) + digits[1] * pow(num_base, 2) +
+                digits[2] * pow(num_base, 1) + digits[3] * pow(num_base, 0);
+        delG = records[index].delH * 1000.0
+               - (temperature + ABSOLUTE_ZERO_OFFSET) * records[index].delS;
+        code_index = NN_CODE_INDEX(code[0], code[1], code[2], code[3]);
+        num_fail += table[code_index] != delG;
+        is_record[code_index] = 1;
+    }
+    for (code_index = 0; code_index < NUM_NN_CODE; code_index++)
+    {
+        num_fail += !is_record[code_index] && table[code_index] != 0.0;
+    }
+    free(is_record);
+    return num_fail;
+}
+
+
+
+/************************** UTILITIES ROUTINES ******************************/
+
+/* reference_matrix: the sw_matrix filled entry by entry by
+ * compute_entry(), as complete_duplex_matrix() did before the fused
+ * kernel. Release with one free(). */
+static SW_Entry **reference_matrix(char *ref, char *query)
+{
+    int nrow = strlen(query);
+    int ncol = strlen(ref);
+    register int row, col;
+    unsigned char *ref_codes = encode_sequence(ref);
+    unsigned char *query_codes = encode_sequence(query);
+    SW_Entry **sw_matrix = initialise_duplex_matrix(ref_codes, query_codes,
+                                                    nrow, ncol);
+    for (row = 1; row < nrow; row++)
+    {
+        for (col = 1; col < ncol; col++)
+        {
+            sw_matrix[row][col] = compute_entry(sw_matrix, row, col,
+                                                ref_codes, query_codes);
+        }
+    }
+    free(ref_codes);
+    free(query_codes);
+    return sw_matrix;
+}
+/* lowest_end_record: the delG and coordinate find_best_decision()
+ * picks, {0.0, {0, 0, STOP}} if no record is below 0 */
+static Duplex_Hit lowest_end_record(SW_Entry **sw_matrix, int nrow, int ncol)
+{
+    Duplex_Hit hit = {0.0, {0, 0, STOP}};
+    register int row, col;
+    for (row = 0; row < nrow; row++)
+    {
+        for (col = 0; col < ncol; col++)
+        {
+            if (row == nrow -1 || col == ncol -1)
+            {
+                SW_Entry entry = sw_matrix[row][col];
+                hit.delG = fminf(hit.delG, fminf(entry.bind.delG,
+                                 fminf(entry.top_bulge.delG, entry.bottom_bulge.delG)));
+            }
+        }
+    }
+    if (hit.delG < 0.0)
+    {
+        hit.coord = find_best_decision(sw_matrix, nrow, ncol);
+    }
+    return hit;
+}
+
+static int same_record(Decision_Record first, Decision_Record second)
+{
+    return first.delG == second.delG &&
+           first.previous_decision == second.previous_decision &&
+           first.current_decision == second.current_decision &&
+           first.top_loop_len == second.top_loop_len &&
+           first.bottom_loop_len == second.bottom_loop_len;
+}
+
+static int same_hit(Duplex_Hit first, Duplex_Hit second)
+{
+    return first.delG == second.delG && same_coord(first.coord, second.coord);
+}
+
+static int same_coord(Coord first, Coord second)
+{
+    return first.row == second.row && first.col == second.col &&
+           first.current_decision == second.current_decision;
+}
+
+/* random_duplex: a ref and a query of 1 to max_len bases,
+ * one duplex in 3 with inosines */
+static void random_duplex(char *ref, char *query, int max_len)
+{
+    const char *alphabet = (rand() % 3 == 0) ? "ACGTI" : "ACGT";
+    random_sequence(ref, 1 + rand() % max_len, alphabet);
+    random_sequence(query, 1 + rand() % max_len, alphabet);
+}
+
+static void random_sequence(char *seq, int len, const char *alphabet)
+{
+    int num_letter = strlen(alphabet);
+    register int i;
+    for (i = 0; i < len; i++)
+    {
+        seq[i] = alphabet[rand() % num_letter];
+    }
+    seq[len] = '\0';
+}
+
+/* report: print the outcome of a check, return its number of failures */
+static int report(const char *name, int num_fail, int num_test)
+{
+    printf("%-64s %s (%d/%d failed)\n", name, (num_fail == 0) ? "ok" : "FAIL",
+           num_fail, num_test);
+    return num_fail;
+}
@@ -1,5 +1,6 @@
+#include <stdlib.h>
 #include <math.h>
-#include "swnn2.h"
+#include "swnn.h"
 
 /********************** THERMODYNAMICS ROUTINES ****************************/
 float internal_loop_score(int top_loop_len, int bottom_loop_len)
@@ -14,21 +15,24 @@ float bulge_score(int loop_len)
 
 
 
-int _digit_internal(char base)
+/* _digit_internal, _digit_terminal:
+ * the digit of an encoded base in the index of the nn data tables,
+ * -1 if the tables have no record for it. */
+int _digit_internal(unsigned char base)
 {
     int digit;
     switch (base)
     {
-        case 'A':
+        case CODE_A:
              digit = INTERNAL_A;
              break;
-        case 'C':
+        case CODE_C:
              digit = INTERNAL_C;
              break;
-        case 'G':
+        case CODE_G:
              digit = INTERNAL_G;
              break;
-        case 'T':
+        case CODE_T:
              digit = INTERNAL_T;
              break;
         default:
@@ -37,24 +41,24 @@ int _digit_internal(char base)
     return digit;
 }
 
-int _digit_terminal(char base)
+int _digit_terminal(unsigned char base)
 {
     int digit;
     switch (base)
     {
-        case '.':
+        case CODE_DOT:
              digit = TERMINAL_DOT;
              break;
-        case 'A':
+        case CODE_A:
              digit = TERMINAL_A;
              break;
-        case 'C':
+        case CODE_C:
              digit = TERMINAL_C;
              break;
-        case 'G':
+        case CODE_G:
              digit = TERMINAL_G;
              break;
-        case 'T':
+        case CODE_T:
              digit = TERMINAL_T;
              break;
         default:
@@ -63,64 +67,133 @@ int _digit_terminal(char base)
     return digit;
 }
 
+/* _get_index_internal, _get_index_terminal:
+ * the index of nn_config in the nn data tables, -1 if there's no
+ * record for it. Its 4 bases are read as the digits of a number in base NUM_SYS_BASE_INTERNAL (resp.
+ * NUM_SYS_BASE_TERMINAL), top5 being the most significant. */
 int _get_index_internal(Neighbour nn_config)
 {
-    int index = 0;
-    index += _digit_internal(nn_config.top5) * pow(NUM_SYS_BASE_INTERNAL, 3);
-    index += _digit_internal(nn_config.top3) * pow(NUM_SYS_BASE_INTERNAL, 2);
-    index += _digit_internal(nn_config.bottom3) * pow(NUM_SYS_BASE_INTERNAL, 1);
-    index += _digit_internal(nn_config.bottom5) * pow(NUM_SYS_BASE_INTERNAL, 0);
-    return index;
+    int digits[] = {_digit_internal(nn_config.top5), _digit_internal(nn_config.top3),
+                    _digit_internal(nn_config.bottom3), _digit_internal(nn_config.bottom5)};
+    if (digits[0] < 0 || digits[1] < 0 || digits[2] < 0 || digits[3] < 0)
+    {
+        return -1;
+    }
+    return ((digits[0] * NUM_SYS_BASE_INTERNAL + digits[1]) * NUM_SYS_BASE_INTERNAL
+            + digits[2]) * NUM_SYS_BASE_INTERNAL + digits[3];
 }
 
 int _get_index_terminal(Neighbour nn_config)
 {
-    int index = 0;
-    index += _digit_terminal(nn_config.top5) * pow(NUM_SYS_BASE_TERMINAL, 3);
-    index += _digit_terminal(nn_config.top3) * pow(NUM_SYS_BASE_TERMINAL, 2);
-    index += _digit_terminal(nn_config.bottom3) * pow(NUM_SYS_BASE_TERMINAL, 1);
-    index += _digit_terminal(nn_config.bottom5) * pow(NUM_SYS_BASE_TERMINAL, 0);
-    return index;
+    int digits[] = {_digit_terminal(nn_config.top5), _digit_terminal(nn_config.top3),
+                    _digit_terminal(nn_config.bottom3), _digit_terminal(nn_config.bottom5)};
+    if (digits[0] < 0 || digits[1] < 0 || digits[2] < 0 || digits[3] < 0)
+    {
+        return -1;
+    }
+    return ((digits[0] * NUM_SYS_BASE_TERMINAL + digits[1]) * NUM_SYS_BASE_TERMINAL
+            + digits[2]) * NUM_SYS_BASE_TERMINAL + digits[3];
 }
 
 
-float get_delG_internal(Neighbour nn_config)
+/* init_thermo_context:
+ * fill context with the delG of every nn data record at the given
+ * reaction temperature (Celsius) and salt concentration (mMol).
+ * !! no salt correction is applied to the nn data yet, the
+ * !! concentration is only recorded with the tables. */
+void init_thermo_context(Thermo_Context *context,
+                         float temperature, float salt_concentration)
 {
     extern const Therm_Param GLOBAL_nn_data_internal[];
+    extern const Therm_Param GLOBAL_nn_data_terminal[];
+    extern const Therm_Param GLOBAL_init_GC;
+    extern const Therm_Param GLOBAL_init_AT;
+    const unsigned char code_mask = (1 << CODE_BITS) -1;
+    int code_index, index;
+    Neighbour nn_config;
+    context->temperature = temperature;
+    context->salt_concentration = salt_concentration;
+    // every combination of 4 codes, most have no record
+    for (code_index = 0; code_index < NUM_NN_CODE; code_index++)
+    {
+        nn_config.top5 = (code_index >> (3 * CODE_BITS)) & code_mask;
+        nn_config.top3 = (code_index >> (2 * CODE_BITS)) & code_mask;
+        nn_config.bottom3 = (code_index >> CODE_BITS) & code_mask;
+        nn_config.bottom5 = code_index & code_mask;
+        index = _get_index_internal(nn_config);
+        context->delG_internal[code_index] = (index < 0) ? 0.0 :
+            GLOBAL_nn_data_internal[index].delH * 1000.0
+            - (temperature + ABSOLUTE_ZERO_OFFSET) * GLOBAL_nn_data_internal[index].delS;
+        index = _get_index_terminal(nn_config);
+        context->delG_terminal[code_index] = (index < 0) ? 0.0 :
+            GLOBAL_nn_data_terminal[index].delH * 1000.0
+            - (temperature + ABSOLUTE_ZERO_OFFSET) * GLOBAL_nn_data_terminal[index].delS;
+    }
+    context->delG_init_AT = GLOBAL_init_AT.delH * 1000.0
+        - GLOBAL_init_AT.delS * (temperature + ABSOLUTE_ZERO_OFFSET);
+    context->delG_init_GC = GLOBAL_init_GC.delH * 1000.0
+        - GLOBAL_init_GC.delS * (temperature + ABSOLUTE_ZERO_OFFSET);
+}
+
+/* set_thermo_context:
+ * make the delG routines below read context in the calling thread,
+ * context should outlive its use. NULL goes back to the conditions
+ * of GLOBAL_Reaction_Temperature and GLOBAL_Salt_Concentration.
+ * Each thread has its own context in use, and a context is only ever
+ * read, so threads can share one or each use their own. */
+void set_thermo_context(const Thermo_Context *context)
+{
+    GLOBAL_thermo_context = context;
+}
+
+/* thermo_context:
+ * the context in use by the calling thread. The one of the global
+ * reaction conditions is (re)computed, per thread, on first use or
+ * once those have changed. */
+const Thermo_Context *thermo_context(void)
+{
     extern float GLOBAL_Reaction_Temperature;
-    int index = _get_index_internal(nn_config);
-    Therm_Param record = GLOBAL_nn_data_internal[index];
-    return record.delH * 1000.0 \
-           - (GLOBAL_Reaction_Temperature + ABSOLUTE_ZERO_OFFSET) * record.delS;
+    extern float GLOBAL_Salt_Concentration;
+    static __thread Thermo_Context global_context;
+    static __thread int is_initialised = FALSE;
+    if (GLOBAL_thermo_context != NULL)
+    {
+        return GLOBAL_thermo_context;
+    }
+    if (!is_initialised ||
+        global_context.temperature != GLOBAL_Reaction_Temperature ||
+        global_context.salt_concentration != GLOBAL_Salt_Concentration)
+    {
+        init_thermo_context(&global_context, GLOBAL_Reaction_Temperature,
+                            GLOBAL_Salt_Concentration);
+        is_initialised = TRUE;
+    }
+    return &global_context;
+}
+
+
+float get_delG_internal(Neighbour nn_config)
+{
+    return thermo_context()->delG_internal[NN_CODE_INDEX(nn_config.top5, nn_config.top3,
+                                                         nn_config.bottom3, nn_config.bottom5)];
 }
 
 float get_delG_terminal(Neighbour nn_config)
 {
-    extern const Therm_Param GLOBAL_nn_data_terminal[];
-    extern float GLOBAL_Reaction_Temperature;
-    int index = _get_index_terminal(nn_config);
-    Therm_Param record = GLOBAL_nn_data_terminal[index];
-    return record.delH * 1000.0 \
-           - (GLOBAL_Reaction_Temperature + ABSOLUTE_ZERO_OFFSET) * record.delS;
+    return thermo_context()->delG_terminal[NN_CODE_INDEX(nn_config.top5, nn_config.top3,
+                                                         nn_config.bottom3, nn_config.bottom5)];
 }
 
-float init_delG(char base)
+float init_delG(unsigned char base)
 {
-    extern const Therm_Param GLOBAL_init_GC;
-    extern const Therm_Param GLOBAL_init_AT;
-    extern float GLOBAL_Reaction_Temperature;
-    float delG;
-    if (base == 'A' || base == 'T')
+    if (base == CODE_A || base == CODE_T)
     {
-        return GLOBAL_init_AT.delH * 1000.0 - \
-               GLOBAL_init_AT.delS * \
-               (GLOBAL_Reaction_Temperature + ABSOLUTE_ZERO_OFFSET);
-    } else if (base == 'G' || base == 'C')
+        return thermo_context()->delG_init_AT;
+    } else if (base == CODE_G || base == CODE_C)
     {
-        return GLOBAL_init_GC.delH * 1000.0 - \
-               GLOBAL_init_GC.delS * \
-               (GLOBAL_Reaction_Temperature + ABSOLUTE_ZERO_OFFSET);
+        return thermo_context()->delG_init_GC;
     }
+    return 0.0;
 }
         
 
@@ -131,6 +204,7 @@ float init_delG(char base)
 
 float GLOBAL_Reaction_Temperature = 60.0;
 float GLOBAL_Salt_Concentration = 50.0; // mMol
+__thread const Thermo_Context *GLOBAL_thermo_context = NULL;
 
 const Therm_Param GLOBAL_init_GC = {"init_G/C", 0, 0};
 const Therm_Param GLOBAL_init_AT = {"init_A/T", 2.3, 4.1};
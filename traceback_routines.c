@@ -0,0 +1,188 @@
+/************************ PACKED TRACEBACK ROUTINES *************************
+ * Full swinc alignment with the decisions packed into one byte per
+ * sw_matrix entry instead of 3 Decision_Records with a string each.
+ *
+ * The scores only live in a rolling row (as in swalign_linear()), the
+ * byte of an entry records where each of its 3 records came from:
+ *   bits 0-1  previous state of the match/mismatch record (M, I or D)
+ *   bit 2     insert record opened from M (set) or extended from I
+ *   bit 3     delete record opened from M (set) or extended from D
+ * Whether the match record is a match or a mismatch is read back from
+ * the sequences, so it needs no bit.
+ * The choices and the ties are made the same way as in score(), and the
+ * best entry is chosen as in fill_matrix(), so the traceback gives the
+ * alignment print_alignment() is meant to print.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swinc.h"
+
+#define TRACE_M_FROM 0x03
+#define TRACE_I_OPENED 0x04
+#define TRACE_D_OPENED 0x08
+
+enum
+{
+    TRACE_STATE_M = 0,
+    TRACE_STATE_I = 1,
+    TRACE_STATE_D = 2
+};
+
+
+/* align_packed:
+ * return the best alignment of query to ref, see SW_Alignment.
+ * The path is allocated and should be released with free_alignment(). */
+SW_Alignment align_packed(char *ref, char *query, Score_Param score_param)
+{
+    size_t ref_len = strlen(ref);
+    size_t query_len = strlen(query);
+    Arena *arena = create_arena(query_len * ref_len +
+                                sizeof(float) * (ref_len +1) * 3 +
+                                query_len + ref_len + 3 * ARENA_ALIGNMENT);
+    SW_Alignment alignment = align_packed_arena(ref, query, score_param, arena);
+    char *path = allocate(alignment.path_len +1);
+    memcpy(path, alignment.path, alignment.path_len +1);
+    alignment.path = path;
+    free_arena(arena);
+    return alignment;
+}
+
+/* align_packed_arena:
+ * align_packed() with the traceback matrix, the rows and the path
+ * allocated from arena. The path lives until the arena is reset and
+ * should not be given to free_alignment(). */
+SW_Alignment align_packed_arena(char *ref, char *query,
+                                Score_Param score_param, Arena *arena)
+{
+    INSTRUMENT_START(fill_timer);
+    int ref_len = strlen(ref);
+    int query_len = strlen(query);
+    int ncol = ref_len +1;
+    // decisions of the entries off the first row and column
+    unsigned char *trace = arena_alloc(arena, (size_t) query_len * ref_len +1);
+    float *m_row = arena_alloc(arena, sizeof(float) * ncol * 3);
+    float *i_row = m_row + ncol;
+    float *h_row = i_row + ncol;
+    SW_Alignment alignment = {0.0, ref_len, ref_len, 0, 0, 0, NULL};
+    int best_state = TRACE_STATE_M;
+    register int row, col;
+    float diag_h, up_h, left_m, left_d;
+    float match_score, insert_score, delete_score;
+    float extended, opened, best_score;
+    unsigned char decision, diag_state, up_state, state;
+
+    for (col = 0; col < ncol; col++)
+    {
+        m_row[col] = i_row[col] = h_row[col] = 0.0;
+    }
+    for (row = 1; row <= query_len; row++)
+    {
+        if (alignment.score <= 0.0)
+        {// null entry of the first column
+            alignment.query_end = row;
+            alignment.ref_end = 0;
+        }
+        diag_h = left_m = left_d = 0.0;
+        diag_state = TRACE_STATE_M;
+        for (col = 1; col < ncol; col++)
+        {
+            match_score = diag_h + ((ref[col -1] == query[row -1]) ?
+                                    score_param.match_score :
+                                    score_param.mismatch_penalty);
+            decision = diag_state;
+            extended = i_row[col] + score_param.gap_extension_penalty;
+            opened = m_row[col] + score_param.gap_open_penalty;
+            insert_score = extended;
+            if (opened > extended)
+            {
+                insert_score = opened;
+                decision |= TRACE_I_OPENED;
+            }
+            extended = left_d + score_param.gap_extension_penalty;
+            opened = left_m + score_param.gap_open_penalty;
+            delete_score = extended;
+            if (opened > extended)
+            {
+                delete_score = opened;
+                decision |= TRACE_D_OPENED;
+            }
+            trace[(size_t) (row -1) * ref_len + col -1] = decision;
+
+            best_score = match_score;
+            state = TRACE_STATE_M;
+            if (insert_score > best_score)
+            {
+                best_score = insert_score;
+                state = TRACE_STATE_I;
+            }
+            if (delete_score > best_score)
+            {
+                best_score = delete_score;
+                state = TRACE_STATE_D;
+            }
+            if (best_score >= alignment.score)
+            {
+                alignment.score = best_score;
+                alignment.query_end = row;
+                alignment.ref_end = col;
+                best_state = state;
+            }
+
+            up_h = h_row[col];
+            // best record of the entry above is the diagonal of col +1
+            up_state = (m_row[col] >= i_row[col] && m_row[col] >= up_h) ? TRACE_STATE_M :
+                       (i_row[col] >= up_h) ? TRACE_STATE_I : TRACE_STATE_D;
+            m_row[col] = match_score;
+            i_row[col] = insert_score;
+            h_row[col] = best_score;
+            diag_h = up_h;
+            diag_state = up_state;
+            left_m = match_score;
+            left_d = delete_score;
+        }
+    }
+
+    INSTRUMENT_ALIGNMENT(fill_timer, 1, (long long) ref_len * query_len);
+
+    // walk back from the end, writing the path from its back
+    INSTRUMENT_START(traceback_timer);
+    int path_capacity = query_len + ref_len;
+    char *path = arena_alloc(arena, path_capacity +1);
+    char *cursor = path + path_capacity;
+    *cursor = '\0';
+    row = alignment.query_end;
+    col = alignment.ref_end;
+    state = best_state;
+    while (row > 0 && col > 0)
+    {
+        decision = trace[(size_t) (row -1) * ref_len + col -1];
+        switch (state)
+        {
+            case (TRACE_STATE_M):
+                *--cursor = (ref[col -1] == query[row -1]) ? 'M' : 'X';
+                state = decision & TRACE_M_FROM;
+                row--;
+                col--;
+                break;
+            case (TRACE_STATE_I):
+                *--cursor = 'I';
+                state = (decision & TRACE_I_OPENED) ? TRACE_STATE_M : TRACE_STATE_I;
+                row--;
+                break;
+            case (TRACE_STATE_D):
+                *--cursor = 'D';
+                state = (decision & TRACE_D_OPENED) ? TRACE_STATE_M : TRACE_STATE_D;
+                col--;
+                break;
+        }
+    }
+    alignment.query_start = row;
+    alignment.ref_start = col;
+    alignment.path_len = path + path_capacity - cursor;
+    memmove(path, cursor, alignment.path_len +1);
+    alignment.path = path;
+    INSTRUMENT_PHASE(PHASE_TRACEBACK, traceback_timer);
+    return alignment;
+}